@@ -0,0 +1,179 @@
+// decode_trace renders a binary trace from emu.c (-t -B file) as the
+// text trace emu.c prints without -B.  Like annotate_trace, it takes
+// tag,listing arguments, and appends " ;; " and the listing text for
+// lines whose "Module,offset" matches a tag and listing address.
+// With -stores, each line that stored to memory (not by pushing) is
+// followed by one with the address, the old value, and the new.
+//
+//	decode_trace [-stores] trace.bin krn,krn.list ioman,ioman.list
+package main
+
+import "bufio"
+import "encoding/binary"
+import "flag"
+import . "fmt"
+import "io"
+import "os"
+import "regexp"
+import "strings"
+
+const RecordSize = 48
+
+var Stores = flag.Bool("stores", false, "Show what each instruction stored")
+
+var MatchAddrAndBytes = regexp.MustCompile(`^([0-9A-F]{4}) ([0-9A-F]{2,8})`).FindStringSubmatch
+var ReplaceWhite = regexp.MustCompile(`  +`).ReplaceAllString
+
+func GrokLine(line string, tag string, d map[string]string) {
+	m := MatchAddrAndBytes(line)
+	if m != nil {
+		k := tag + "," + m[1]
+		k = strings.ToUpper(k)
+
+		if len(line) > 56 {
+			d[k] = line[56:]
+		}
+	}
+}
+
+// CString is the bytes of b up to the first NUL.
+func CString(b []byte) string {
+	if i := strings.IndexByte(string(b), 0); i >= 0 {
+		return string(b[:i])
+	}
+	return string(b)
+}
+
+// CC renders the condition codes as emu.c's to_bin does.
+func CC(cc byte) string {
+	z := []byte("efhinzvc")
+	for i := range z {
+		if cc&(0x80>>uint(i)) != 0 {
+			z[i] -= 'a' - 'A'
+		}
+	}
+	return string(z)
+}
+
+type Dis struct {
+	Inst, Ops string
+}
+
+type Mod struct {
+	Name string
+}
+
+func main() {
+	flag.Parse()
+	args := flag.Args()
+	if len(args) < 1 {
+		Fprintf(os.Stderr, "usage: decode_trace [-stores] trace.bin [tag,listing...]\n")
+		os.Exit(2)
+	}
+	d := make(map[string]string)
+	for _, a := range args[1:] {
+		ww := strings.Split(a, ",")
+		tag, fname := ww[0], ww[1]
+		r, err := os.Open(fname)
+		if err != nil {
+			panic(fname)
+		}
+		sc := bufio.NewScanner(r)
+		for sc.Scan() {
+			line := sc.Text()
+			GrokLine(line, tag, d)
+		}
+
+		r.Close()
+	}
+
+	f, err := os.Open(args[0])
+	if err != nil {
+		panic(err)
+	}
+	defer f.Close()
+	r := bufio.NewReaderSize(f, 1<<20)
+	w := bufio.NewWriterSize(os.Stdout, 1<<20)
+	defer w.Flush()
+
+	rec := make([]byte, RecordSize)
+	if _, err := io.ReadFull(r, rec); err != nil || string(rec[:8]) != "EMUTRACE" {
+		panic("not an emu.c binary trace: " + args[0])
+	}
+	var order binary.ByteOrder = binary.LittleEndian
+	if order.Uint16(rec[8:]) != 0x1234 {
+		order = binary.BigEndian
+	}
+	if n := order.Uint16(rec[10:]); n != RecordSize {
+		panic(Sprintf("record size %d, want %d", n, RecordSize))
+	}
+	word := func(i int) uint16 { return order.Uint16(rec[i:]) }
+
+	dis := make(map[uint16]Dis)
+	mods := make(map[uint16]Mod)
+	for {
+		if _, err := io.ReadFull(r, rec); err != nil {
+			if err == io.ErrUnexpectedEOF {
+				Fprintf(os.Stderr, "decode_trace: partial record at end\n")
+			}
+			if err == io.EOF || err == io.ErrUnexpectedEOF {
+				return
+			}
+			panic(err)
+		}
+		switch rec[0] {
+		case 'D':
+			dis[word(2)] = Dis{CString(rec[4:10]), CString(rec[10:42])}
+			continue
+		case 'M':
+			mods[word(2)] = Mod{CString(rec[6:])}
+			continue
+		case 'I':
+		default:
+			panic(Sprintf("bad record kind %q", rec[0]))
+		}
+
+		pc := word(4)
+		var line strings.Builder
+		if mod := word(26); mod != 0 {
+			Fprintf(&line, "%s,%04x ", mods[mod].Name, pc-mod)
+		} else {
+			line.WriteString("? ")
+		}
+		oldnew := 'o'
+		if rec[1]&1 != 0 {
+			oldnew = 'N'
+		}
+		Fprintf(&line, "%c %04x ", oldnew, pc)
+		for i := 0; i < 4; i++ {
+			if i < int(rec[2]) {
+				Fprintf(&line, "%02x", rec[6+i])
+			} else {
+				line.WriteString("  ")
+			}
+		}
+		Fprintf(&line, " %-5s %-17s [%02d] ", dis[pc].Inst, dis[pc].Ops, rec[3])
+		Fprintf(&line, "x=%04x y=%04x u=%04x s=%04x a=%02x b=%02x cc=%s dp=%02x",
+			word(14), word(16), word(18), word(20), rec[10], rec[11], CC(rec[12]), rec[13])
+		Fprintf(&line, ", s: %04x %04x, #%d", word(22), word(24), order.Uint64(rec[40:]))
+
+		text := line.String()
+		if len(d) > 0 {
+			tail := ""
+			ww := strings.Split(text, " ")
+			if len(ww) > 0 && len(ww[0]) > 0 {
+				k := strings.ToUpper(ww[0])
+				if v, ok := d[k]; ok {
+					tail = ReplaceWhite(v, " ")
+				}
+			}
+			text += " ;; " + tail
+		}
+		if n := rec[34]; *Stores && n > 0 {
+			width := 2 * int(n)
+			Fprintf(w, "%s\n    [%04x] %0*x -> %0*x\n", text, word(28), width, word(30), width, word(32))
+		} else {
+			Fprintf(w, "%s\n", text)
+		}
+	}
+}
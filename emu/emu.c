@@ -58,6 +58,28 @@
                 -F  Initialize mem to FF.
                 -t  Enable trace.  (Still requires -DTRACE).
                 And more.
+                -b  Report steps per second at exit.
+                -v  Diagnostic level: 1 for device notices, 2 for all I/O;
+                    or by subsystem, e.g. -v disk=2,os9=0,cpu=0.
+                -K  Type the keys in this file, one per keyboard poll
+                    or getchar SWI.
+                -f  Floppy image for drive 1, or N:file for drive N (1-3).
+                -P  Map floppy images privately; do not write them.
+                -O  Write console output (the putchar SWI) to this file.
+                -e  Finish with status 0 when a console line matches this regex.
+                    Without a match, finish with status 4.  Lines are
+                    matched when they end, at CR or LF.
+                -x  Finish with status 1 when a console line matches this regex.
+                -C  Finish with status 3 after this many cycles.
+                -E  With -DTHREADED, check the threaded core's inline
+                    opcodes against instrtable; finish with status 5
+                    at the first mismatch.
+                -B  With -t, write the trace to this file as binary
+                    records, for decode_trace (a Go tool, at the top).
+                -S  Save a snapshot to this file at "os9 $FE", or to
+                    file@N before step N.  If the run finishes before
+                    saving it, finish with status 6 (unless failing).
+                -R  Start from this snapshot instead of an image.
 */
 
 /* Why not always TRACE? */
@@ -66,7 +88,6 @@
 #include <stdio.h>
 #ifdef TERM_CONTROL
 #include <fcntl.h>
-int tflags;
 #endif
 
 #include <stdlib.h>
@@ -82,7 +103,13 @@ int tflags;
 
 
 #include <stdio.h>
-#include <sys/select.h>
+#include <pthread.h>
+#include <poll.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <sys/mman.h>
+#include <regex.h>
 #include <unistd.h>
 #include <sys/time.h>
 #include <sys/types.h>
@@ -92,10 +119,173 @@ typedef int bool;
 #define false 0
 #define true 1
 
+/* Diagnostics, by subsystem.  DIAG(sub, level, ...) prints when the
+   subsystem's level is at least level.  -v N sets the device
+   subsystems (kbd disk irq io) to N: 1 for notices, 2 for every
+   access.  -v name=N,... sets any of them.  The OS9 calls are shown at
+   level 1, with the module list and process dumps at 2.  Build with
+   -DDIAG_MAX=N to compile out every DIAG above level N.
+
+   Diagnostics, dumps and the trace go into a large buffer, which a
+   thread writes to stderr every DIAG_FLUSH_MS or when it is half full,
+   so a busy boot is not a write() per line.  finish(), SIGINT and
+   SIGTERM, DIAG_ASSERT and DiagError (for ERROR lines) flush it. */
+enum { DIAG_KBD, DIAG_DISK, DIAG_IRQ, DIAG_IO, DIAG_OS9, DIAG_CPU, DIAG_NUM };
+static char* diag_names[DIAG_NUM] = {"kbd", "disk", "irq", "io", "os9", "cpu"};
+static int diag_levels[DIAG_NUM] = {0, 0, 0, 0, 2, 1};
+#ifndef DIAG_MAX
+#define DIAG_MAX 2
+#endif
+#define DIAG_ON(sub, level) ((level) <= DIAG_MAX && diag_levels[sub] >= (level))
+#define DIAG(sub, level, ...) do { if (DIAG_ON(sub, level)) DiagPrintf(__VA_ARGS__); } while (0)
+
+#define DIAG_BUF (1<<20)
+#define DIAG_FLUSH_MS 100
+static char diag_bufs[2][DIAG_BUF];
+static int diag_cur, diag_len;
+static pthread_mutex_t diag_mu = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t diag_write_mu = PTHREAD_MUTEX_INITIALIZER;  /* Keeps writes in order. */
+static pthread_cond_t diag_cv = PTHREAD_COND_INITIALIZER;
+
+/* DiagWrite swaps the buffers and writes the full one.  It is called
+   with diag_mu held, which it drops while writing. */
+void DiagWrite() {
+  pthread_mutex_lock(&diag_write_mu);
+  char* p = diag_bufs[diag_cur];
+  int n = diag_len;
+  diag_cur ^= 1;
+  diag_len = 0;
+  pthread_mutex_unlock(&diag_mu);
+  while (n > 0) {
+    int w = write(2, p, n);
+    if (w <= 0) break;
+    p += w;
+    n -= w;
+  }
+  pthread_mutex_unlock(&diag_write_mu);
+  pthread_mutex_lock(&diag_mu);
+}
+
+void DiagPrintf(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+void DiagPrintf(const char* fmt, ...) {
+  va_list ap;
+  pthread_mutex_lock(&diag_mu);
+  for (int tries = 0; tries < 2; tries++) {
+    int room = DIAG_BUF - diag_len;
+    va_start(ap, fmt);
+    int n = vsnprintf(diag_bufs[diag_cur] + diag_len, room, fmt, ap);
+    va_end(ap);
+    if (n < room) {
+      diag_len += n;
+      break;
+    }
+    DiagWrite();  /* Full: write it now, and try again. */
+  }
+  if (diag_len > DIAG_BUF/2) {
+    pthread_cond_signal(&diag_cv);
+  }
+  pthread_mutex_unlock(&diag_mu);
+}
+
+void DiagFlush() {
+  pthread_mutex_lock(&diag_mu);
+  if (diag_len) DiagWrite();
+  pthread_mutex_unlock(&diag_mu);
+}
+
+/* DiagError writes straight to stderr, after what is buffered, for
+   errors that exit. */
+void DiagError(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+void DiagError(const char* fmt, ...) {
+  va_list ap;
+  DiagFlush();
+  va_start(ap, fmt);
+  vfprintf(stderr, fmt, ap);
+  va_end(ap);
+}
+
+/* DIAG_ASSERT flushes before failing, as abort() skips atexit. */
+#define DIAG_ASSERT(c) do { if (!(c)) { DiagFlush(); assert(c); } } while (0)
+
+void* diag_thread(void* unused) {
+  pthread_mutex_lock(&diag_mu);
+  while (1) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_nsec += DIAG_FLUSH_MS * 1000000L;
+    ts.tv_sec += ts.tv_nsec / 1000000000L;
+    ts.tv_nsec %= 1000000000L;
+    pthread_cond_timedwait(&diag_cv, &diag_mu, &ts);
+    if (diag_len) DiagWrite();
+  }
+}
+
+/* SIGINT and SIGTERM are blocked in every thread but this one, so ^C
+   on a hung run keeps its trace.  It sets diag_signal, for the step
+   loop to finish() between instructions (see CheckCycleLimit); if the
+   loop is stuck, say waiting for a key, it flushes and exits itself,
+   unless finish() has started, which will exit when it is done. */
+static sigset_t diag_signals;
+static volatile int diag_signal;
+static int finishing;  /* Claimed by finish() or by this thread. */
+
+void* diag_signal_thread(void* unused) {
+  int sig;
+  if (sigwait(&diag_signals, &sig) == 0) {
+    diag_signal = sig;
+    usleep(500 * 1000);
+    if (__atomic_exchange_n(&finishing, 1, __ATOMIC_ACQ_REL)) return NULL;
+    DiagPrintf("\nSIGNAL %d\n", sig);
+    DiagFlush();
+    _exit(128 + sig);
+  }
+  return NULL;
+}
+
+void StartDiag() {
+  pthread_t t;
+  atexit(DiagFlush);
+
+  /* Block them first, so the threads made from here on inherit it. */
+  sigemptyset(&diag_signals);
+  sigaddset(&diag_signals, SIGINT);
+  sigaddset(&diag_signals, SIGTERM);
+  if (pthread_sigmask(SIG_BLOCK, &diag_signals, NULL) == 0 &&
+      pthread_create(&t, NULL, diag_signal_thread, NULL) == 0) {
+    pthread_detach(t);
+  }
+
+  if (pthread_create(&t, NULL, diag_thread, NULL) == 0) {
+    pthread_detach(t);
+  }  /* Else DiagPrintf still writes when the buffer fills. */
+}
+
+/* SetDiag parses -v: a level for the device subsystems, or name=level,... */
+void SetDiag(char* arg) {
+  if ('0' <= arg[0] && arg[0] <= '9') {
+    diag_levels[DIAG_KBD] = diag_levels[DIAG_DISK] = diag_levels[DIAG_IRQ] = diag_levels[DIAG_IO] = atoi(arg);
+    return;
+  }
+  for (char* item = strtok(arg, ","); item; item = strtok(NULL, ",")) {
+    char* eq = strchr(item, '=');
+    int i;
+    for (i = 0; i < DIAG_NUM; i++) {
+      if (eq && strlen(diag_names[i]) == eq - item && !strncmp(item, diag_names[i], eq - item)) break;
+    }
+    if (i == DIAG_NUM) {
+      DiagError("ERROR: -v wants N or name=N,... with names kbd disk irq io os9 cpu: %s\n", item);
+      exit(2);
+    }
+    diag_levels[i] = atoi(eq+1);
+  }
+}
+
 bool stress_test_with_dir_command;
 
 void DumpAllMemory();
 void Os9AllMemoryModules();
+void finish();
+static FILE* console_out;  /* See batch mode, below. */
 
 int StressTestMaybeGetChar() {
   static int i;
@@ -103,26 +293,110 @@ int StressTestMaybeGetChar() {
   i = (i+1) & 3;
   return c;
 }
+
+/* Keys from stdin are read by input_thread into key_ring, a
+   single-producer single-consumer ring, so the IRQ path only has to
+   compare key_head with key_tail.  With -K file, keys come from the
+   file instead, one per keyboard poll, for reproducible runs. */
+#define KEY_RING 256  /* A power of 2. */
+static unsigned char key_ring[KEY_RING];
+static unsigned int key_head;  /* Written only by input_thread. */
+static unsigned int key_tail;  /* Written only by MaybeGetChar. */
+static int key_eof;
+static char* key_script;
+static long key_script_len, key_script_pos;
+
+void* input_thread(void* unused) {
+  while (1) {
+    char c;
+    int n = read(0, &c, 1);
+    if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+      /* stdin may be non-blocking, from whoever started us. */
+      struct pollfd p = {0, POLLIN, 0};
+      poll(&p, 1, -1);
+      continue;
+    }
+    if (n != 1) {
+      __atomic_store_n(&key_eof, 1, __ATOMIC_RELEASE);
+      return NULL;
+    }
+    unsigned int head = key_head;
+    while (head - __atomic_load_n(&key_tail, __ATOMIC_ACQUIRE) >= KEY_RING) {
+      usleep(1000);  /* Full. */
+    }
+    key_ring[head % KEY_RING] = c;
+    __atomic_store_n(&key_head, head+1, __ATOMIC_RELEASE);
+  }
+}
+
+void StartInput() {
+  pthread_t t;
+  if (pthread_create(&t, NULL, input_thread, NULL)) {
+    DiagError("ERROR: Cannot start input thread\n");
+    exit(2);
+  }
+  pthread_detach(t);
+}
+
+void ReadKeyScript(char* name) {
+  FILE* f = fopen(name, "rb");
+  if (!f) {
+    DiagError("ERROR: Cannot open key script: %s\n", name);
+    exit(2);
+  }
+  fseek(f, 0, SEEK_END);
+  key_script_len = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  key_script = malloc(key_script_len + 1);
+  key_script_len = fread(key_script, 1, key_script_len, f);
+  fclose(f);
+}
+
+/* GetKey waits for the next key, for the getchar SWI.  The keys are
+   the same ones irq() polls for, so -K scripts work for both. */
+int GetKey() {
+  if (stress_test_with_dir_command) {
+    return StressTestMaybeGetChar();
+  }
+  if (key_script) {
+    return (key_script_pos < key_script_len) ? (unsigned char)key_script[key_script_pos++] : EOF;
+  }
+  fflush(console_out);  /* Show any prompt. */
+  unsigned int tail = key_tail;
+  while (__atomic_load_n(&key_head, __ATOMIC_ACQUIRE) == tail) {
+    if (__atomic_load_n(&key_eof, __ATOMIC_ACQUIRE) && key_head == tail) {
+      return EOF;
+    }
+    usleep(1000);
+  }
+  int c = key_ring[tail % KEY_RING];
+  __atomic_store_n(&key_tail, tail+1, __ATOMIC_RELEASE);
+  return c;
+}
+
 int MaybeGetChar() {
   if (stress_test_with_dir_command) {
-  	StressTestMaybeGetChar();
-  }
-
-  int n;
-  char c = 0;
-  static struct timeval tv = {0, 0};
-  fd_set set;
-  FD_ZERO(&set);
-  FD_SET(0, &set);
-  n = select(1, &set, NULL, NULL, &tv);
-  if (n==0) return 0;
-  n = read(0, &c, 1);
-  if (n!=1) {
-    // On Cntrl-D
-    DumpAllMemory();
+    return StressTestMaybeGetChar();
   }
-  assert(n==1);
-  fprintf(stderr, "#MaybeGetChar: GOT {%c} %d.\n", (' '<=c && c<='~') ? c : '?', c);
+
+  char c;
+  if (key_script) {
+    if (key_script_pos >= key_script_len) return 0;
+    c = key_script[key_script_pos++];
+  } else {
+    unsigned int tail = key_tail;
+    if (__atomic_load_n(&key_head, __ATOMIC_ACQUIRE) == tail) {
+      if (__atomic_load_n(&key_eof, __ATOMIC_ACQUIRE) && key_head == tail) {
+        // On Cntrl-D
+        DumpAllMemory();
+        finish();
+      }
+      return 0;
+    }
+    c = key_ring[tail % KEY_RING];
+    __atomic_store_n(&key_tail, tail+1, __ATOMIC_RELEASE);
+  }
+  DIAG(DIAG_KBD, 1, "#MaybeGetChar: GOT {%c} %d.\n", (' '<=c && c<='~') ? c : '?', c);
 
   static int prev_char = 0;
   if (prev_char == ')' && c == 'd') {
@@ -235,7 +509,9 @@ void trace();
 
 static int fdump=0;
 static int tmode = 0;  // Trace enabled?
+static int bmode = 0;  // Report step rate at finish?
 static long steps = 0;
+static struct timeval start_time;
 
 /* Defaults for backwards compatability. */
 static int swi_for_putchar = 2;  /* 1, 2, or 3, for SWI, SWI2, SWI3. */
@@ -325,6 +601,14 @@ static char dops[32];
 /* disassembled instruction len (optional, on demand) */
 static int da_len;
 
+/* Binary trace (-B): the last store by the current instruction, made
+   by TracePageWrite for bytes or STOREWORD for words.  Pushes are not
+   counted; the trace has the top of the stack anyway. */
+static FILE* bt_file;
+static Word bt_wr_addr, bt_wr_old;
+static int bt_wr_len;
+#define STOREWORD(a,n) {if (bt_file) {bt_wr_addr=(a); bt_wr_old=GETWORD(a); bt_wr_len=2;} SETWORD(a,n)}
+
 /* instruction cycles */
 static int cycles;
 unsigned long cycles_sum;
@@ -339,9 +623,53 @@ struct Completion;
 typedef void (*Callback)(struct Completion*);
 struct Completion {
   Callback f;
+  Word pc;  /* Where the OS9 call returns. */
   Byte service;
   Word a, b, c;
-} Os9SysCallCompletion[0x10000];
+};
+
+/* Pending OS9 call completions, by return PC.  The step loop only
+   tests a bit in completion_bits; the few pending completions are
+   searched when a bit is set. */
+#define MAX_COMPLETIONS 64
+struct Completion Os9SysCallCompletion[MAX_COMPLETIONS];
+unsigned int completion_bits[0x10000/32];
+
+#define COMPLETION_PENDING(pc) (completion_bits[(pc)>>5] & (1u<<((pc)&31)))
+
+struct Completion* NewCompletion(Word pc) {
+  struct Completion* free = NULL;
+  int i;
+  for (i=0; i<MAX_COMPLETIONS; i++) {
+    struct Completion* cp = &Os9SysCallCompletion[i];
+    if (cp->f && cp->pc == pc) {
+      return cp;  /* Replaces the older one, as the 64K table did. */
+    }
+    if (!cp->f && !free) free = cp;
+  }
+  if (!free) {
+    DIAG(DIAG_OS9, 1, "HEY, too many pending completions; dropping one at %04x\n", pc);
+    free = &Os9SysCallCompletion[pc % MAX_COMPLETIONS];
+    completion_bits[free->pc>>5] &= ~(1u<<(free->pc&31));
+  }
+  free->pc = pc;
+  completion_bits[pc>>5] |= 1u<<(pc&31);
+  return free;
+}
+
+void RunCompletion(Word pc) {
+  int i;
+  completion_bits[pc>>5] &= ~(1u<<(pc&31));
+  for (i=0; i<MAX_COMPLETIONS; i++) {
+    struct Completion* cp = &Os9SysCallCompletion[i];
+    if (cp->f && cp->pc == pc) {
+      Callback f = cp->f;
+      cp->f = NULL;
+      f(cp);
+      return;
+    }
+  }
+}
 
 void Os9AllMemoryModules();
 void DefaultCompleter(struct Completion* cp);
@@ -572,6 +900,8 @@ char* Os9String(Word w) {
   *p = 0;
   return buf;
 }
+void ConsolePut(Byte ch);
+
 char* PrintableStringThruCrOrMax(Word a, Word max) {
   static char buf[9999];
   int i;
@@ -615,24 +945,26 @@ char* ModuleName(Word a) {
   return Os9String(s);
 }
 void DecodeOs9Opcode(Byte b) {
-  struct Completion* cp = &Os9SysCallCompletion[pcreg+1];
+  struct Completion* cp = NewCompletion(pcreg+1);
   cp->f = DefaultCompleter;
   cp->service = GETBYTE(pcreg)+1;
 
-  Os9AllMemoryModules();
+  if (DIAG_ON(DIAG_OS9, 2)) {
+    Os9AllMemoryModules();
+  }
   char* s = "???";
   switch(b) {
     case 0x00: s = "F$Link   : Link to Module";
-      fprintf(stderr, "HEY, Kernel 0x%02x: %s .... module='%s'\n", b, s, Os9String(xreg));
+      DIAG(DIAG_OS9, 1, "HEY, Kernel 0x%02x: %s .... module='%s'\n", b, s, Os9String(xreg));
       return;
     case 0x01: s = "F$Load   : Load Module from File";
       break;
     case 0x02: s = "F$UnLink : Unlink Module";
-      fprintf(stderr, "HEY, Kernel 0x%02x: %s .... u=%04x magic=%04x module='%s'\n", b, s, ureg, GETWORD(ureg), ModuleName(ureg));
+      DIAG(DIAG_OS9, 1, "HEY, Kernel 0x%02x: %s .... u=%04x magic=%04x module='%s'\n", b, s, ureg, GETWORD(ureg), ModuleName(ureg));
       return;
       break;
     case 0x03: s = "F$Fork   : Start New Process";
-      fprintf(stderr, "HEY, Kernel 0x%02x: %s .... X='%s'\n", b, s, Os9String(xreg));
+      DIAG(DIAG_OS9, 1, "HEY, Kernel 0x%02x: %s .... X='%s'\n", b, s, Os9String(xreg));
       return;
       break;
     case 0x04: s = "F$Wait   : Wait for Child Process to Die";
@@ -660,7 +992,7 @@ void DecodeOs9Opcode(Byte b) {
     case 0x0F: s = "F$PErr   : Print Error";
       break;
     case 0x10: s = "F$PrsNam : Parse Pathlist Name";
-      fprintf(stderr, "HEY, Kernel 0x%02x: %s .... path='%s'\n", b, s, Os9String(xreg));
+      DIAG(DIAG_OS9, 1, "HEY, Kernel 0x%02x: %s .... path='%s'\n", b, s, Os9String(xreg));
       return;
     case 0x11: s = "F$CmpNam : Compare Two Names";
       break;
@@ -682,7 +1014,7 @@ void DecodeOs9Opcode(Byte b) {
     case 0x27: s = "F$VIRQ   : Install/Delete Virtual IRQ";
       break;
     case 0x28: s = "F$SRqMem : System Memory Request";
-      fprintf(stderr, "HEY, Kernel 0x%02x: %s .... size=%02x%02x\n", b, s, *areg, *breg);
+      DIAG(DIAG_OS9, 1, "HEY, Kernel 0x%02x: %s .... size=%02x%02x\n", b, s, *areg, *breg);
       return;
     case 0x29: s = "F$SRtMem : System Memory Return";
       break;
@@ -695,7 +1027,7 @@ void DecodeOs9Opcode(Byte b) {
     case 0x2D: s = "F$NProc  : Start Next Process";
       break;
     case 0x2E: s = "F$VModul : Validate Module";
-      fprintf(stderr, "HEY, Kernel 0x%02x: %s .... D=%04x X=%04x\n", b, s, *dreg, xreg);
+      DIAG(DIAG_OS9, 1, "HEY, Kernel 0x%02x: %s .... D=%04x X=%04x\n", b, s, *dreg, xreg);
       return;
     case 0x2F: s = "F$Find64 : Find Process/Path Descriptor";
       break;
@@ -711,7 +1043,7 @@ void DecodeOs9Opcode(Byte b) {
     // IOMan:
 
     case 0x80: s = "I$Attach : Attach I/O Device";
-      fprintf(stderr, "HEY, Kernel 0x%02x: %s .... u=%04x magic=%04x module='%s'\n", b, s, ureg, GETWORD(ureg), Os9String(ureg+GETWORD(ureg+4)));
+      DIAG(DIAG_OS9, 1, "HEY, Kernel 0x%02x: %s .... u=%04x magic=%04x module='%s'\n", b, s, ureg, GETWORD(ureg), Os9String(ureg+GETWORD(ureg+4)));
       return;
       break;
     case 0x81: s = "I$Detach : Detach I/O Device";
@@ -719,22 +1051,22 @@ void DecodeOs9Opcode(Byte b) {
     case 0x82: s = "I$Dup    : Duplicate Path";
       break;
     case 0x83: s = "I$Create : Create New File";
-      fprintf(stderr, "HEY, Kernel 0x%02x: %s .... X='%s'\n", b, s, Os9String(xreg));
+      DIAG(DIAG_OS9, 1, "HEY, Kernel 0x%02x: %s .... X='%s'\n", b, s, Os9String(xreg));
       return;
       break;
     case 0x84: s = "I$Open   : Open Existing File";
-      fprintf(stderr, "HEY, Kernel 0x%02x: %s .... X='%s'\n", b, s, Os9String(xreg));
+      DIAG(DIAG_OS9, 1, "HEY, Kernel 0x%02x: %s .... X='%s'\n", b, s, Os9String(xreg));
       return;
       break;
     case 0x85: s = "I$MakDir : Make Directory File";
-      fprintf(stderr, "HEY, Kernel 0x%02x: %s .... X='%s'\n", b, s, Os9String(xreg));
+      DIAG(DIAG_OS9, 1, "HEY, Kernel 0x%02x: %s .... X='%s'\n", b, s, Os9String(xreg));
       return;
       break;
     case 0x86: s = "I$ChgDir : Change Default Directory";
-      fprintf(stderr, "HEY, Kernel 0x%02x: %s .... X='%s'\n", b, s, Os9String(xreg));
+      DIAG(DIAG_OS9, 1, "HEY, Kernel 0x%02x: %s .... X='%s'\n", b, s, Os9String(xreg));
       return;
     case 0x87: s = "I$Delete : Delete File";
-      fprintf(stderr, "HEY, Kernel 0x%02x: %s .... X='%s'\n", b, s, Os9String(xreg));
+      DIAG(DIAG_OS9, 1, "HEY, Kernel 0x%02x: %s .... X='%s'\n", b, s, Os9String(xreg));
       return;
       break;
     case 0x88: s = "I$Seek   : Change Current Position";
@@ -746,7 +1078,7 @@ void DecodeOs9Opcode(Byte b) {
     case 0x8B: s = "I$ReadLn : Read Line of ASCII Data";
       break;
     case 0x8C: s = "I$WritLn : Write Line of ASCII Data";
-      fprintf(stderr, "HEY, Kernel 0x%02x: %s .... {{{%s}}}\n", b, s, EscapeStringThruCrOrMax(xreg, yreg));
+      DIAG(DIAG_OS9, 1, "HEY, Kernel 0x%02x: %s .... {{{%s}}}\n", b, s, EscapeStringThruCrOrMax(xreg, yreg));
       {
       	Byte path_num = *areg;
         Word a = 0;
@@ -754,27 +1086,27 @@ void DecodeOs9Opcode(Byte b) {
         Byte path = B(proc + P_PATH+path_num);
         Word pathDBT = W(D_PthDBT);
 	Word q = W(pathDBT + (path>>2));
-        fprintf(stderr, "..writln..  path_num=%x proc=%x path=%x dbt=%x q=%x\n", path_num, proc, path, pathDBT, q);
+        DIAG(DIAG_OS9, 1, "..writln..  path_num=%x proc=%x path=%x dbt=%x q=%x\n", path_num, proc, path, pathDBT, q);
 	if (q) {
 	  Word pd = q + 64*(path&3);
 	  Word dev = W(pd + PD_DEV);
-          fprintf(stderr, "..writln..  pd=%x dev=%x\n", pd, dev);
+          DIAG(DIAG_OS9, 1, "..writln..  pd=%x dev=%x\n", pd, dev);
 	  Word desc = W(dev+V_DESC);
 	  char* name = ModuleName(W(dev+V_DESC));
-          fprintf(stderr, "..writln..  desc=%x=%s\n", desc, name);
+          DIAG(DIAG_OS9, 1, "..writln..  desc=%x=%s\n", desc, name);
 	  if (!strcasecmp(name, "Term")) {
-	    printf("%s", PrintableStringThruCrOrMax(xreg, yreg));
-	    fflush(stdout);
+	    char* p = PrintableStringThruCrOrMax(xreg, yreg);
+	    while (*p) ConsolePut(*p++);
 	  }
 	}
       }
       break;
     case 0x8D: s = "I$GetStt : Get Path Status";
-      fprintf(stderr, "HEY, Kernel 0x%02x: %s .... %s\n", b, s, DecodeOs9GetStat(*areg));
+      DIAG(DIAG_OS9, 1, "HEY, Kernel 0x%02x: %s .... %s\n", b, s, DecodeOs9GetStat(*areg));
       return;
       break;
     case 0x8E: s = "I$SetStt : Set Path Status";
-      fprintf(stderr, "HEY, Kernel 0x%02x: %s .... %s\n", b, s, DecodeOs9GetStat(*areg));
+      DIAG(DIAG_OS9, 1, "HEY, Kernel 0x%02x: %s .... %s\n", b, s, DecodeOs9GetStat(*areg));
       return;
       break;
     case 0x8F: s = "I$Close  : Close Path";
@@ -782,15 +1114,15 @@ void DecodeOs9Opcode(Byte b) {
     case 0x90: s = "I$DeletX : Delete from current exec dir";
       break;
   }
-  fprintf(stderr, "HEY, Kernel 0x%02x: %s\n", b, s);
+  DIAG(DIAG_OS9, 1, "HEY, Kernel 0x%02x: %s\n", b, s);
 }
 
 void DefaultCompleter(struct Completion* cp) {
   if (ccreg&1 /* carry bit indicates error */) {
     Byte errcode = *breg;
-    fprintf(stderr, "HEY, Kernel 0x%02x -> ERROR [%02x] %s\n", cp->service-1, errcode, DecodeOs9Error(errcode));
+    DIAG(DIAG_OS9, 1, "HEY, Kernel 0x%02x -> ERROR [%02x] %s\n", cp->service-1, errcode, DecodeOs9Error(errcode));
   } else {
-    fprintf(stderr, "HEY, Kernel 0x%02x -> okay\n", cp->service-1);
+    DIAG(DIAG_OS9, 1, "HEY, Kernel 0x%02x -> okay\n", cp->service-1);
   }
 }
 
@@ -865,22 +1197,81 @@ Byte disk_track;
 Byte disk_status;
 Byte disk_data;
 Byte disk_control;
-FILE* disk_fd;
 Byte disk_stuff[256];
 int disk_i;
 
+/* Floppy images are mapped into memory, so a sector is a memcpy.
+   With -P they are mapped privately, and writes are thrown away;
+   otherwise they reach the files by msync() in finish().
+   Drives 1, 2 and 3 are drive select bits 0, 1 and 2 of CONTROL;
+   bit 6 is the side, so there is no fourth drive.  drives[0] is
+   what a command finds with no drive selected, and is never open. */
+#define NUM_DRIVES 4
+struct Drive {
+  char* name;
+  Byte* image;
+  long size;
+  int sides;  /* 2 if bigger than 40 single-sided tracks. */
+} drives[NUM_DRIVES];
+int private_disks;
+
+void OpenDrives() {
+  for (int i = 0; i < NUM_DRIVES; i++) {
+    struct Drive* d = &drives[i];
+    if (!d->name) continue;
+    int fd = open(d->name, private_disks ? O_RDONLY : O_RDWR);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0) {
+      DiagError("ERROR: Cannot open file: %s\n", d->name);
+      exit(2);
+    }
+    d->size = st.st_size;
+    d->sides = (d->size > 40*18*256) ? 2 : 1;
+    d->image = mmap(NULL, d->size, PROT_READ|PROT_WRITE,
+                    private_disks ? MAP_PRIVATE : MAP_SHARED, fd, 0);
+    if (d->image == MAP_FAILED) {
+      DiagError("ERROR: Cannot mmap file: %s\n", d->name);
+      exit(2);
+    }
+    close(fd);
+  }
+}
+
+void SyncDrives() {
+  for (int i = 0; i < NUM_DRIVES; i++) {
+    if (drives[i].image && !private_disks) {
+      msync(drives[i].image, drives[i].size, MS_SYNC);
+    }
+  }
+}
+
+/* DiskSector returns the current sector in the selected drive's image. */
+Byte* DiskSector(char* what) {
+  struct Drive* d = &drives[disk_drive];
+  if (!d->image) {
+    DiagError("ERROR: %s: No file for drive %d\n", what, disk_drive);
+    exit(2);
+  }
+  disk_offset = 256 * ((disk_track * d->sides + disk_side) * 18 + disk_sector - 1);
+  if (disk_sector < 1 || disk_side >= d->sides || disk_offset + 256 > d->size) {
+    DiagError("ERROR: %s: No sector %d:%d:%d:%d\n", what, disk_drive, disk_track, disk_side, disk_sector-1);
+    exit(2);
+  }
+  return d->image + disk_offset;
+}
+
 Byte kbd_probe;
 int kbd_cycle;
 
 void nmi() {
-  fprintf(stderr,"HEY, INTERRUPTING with NMI\n");
+  DIAG(DIAG_IRQ, 2, "HEY, INTERRUPTING with NMI\n");
   interrupt(VECTOR_NMI);
   irqs_pending &= ~NMI_PENDING;
 }
 void irq() {
   ++kbd_cycle;
-  fprintf(stderr,"HEY, INTERRUPTING with IRQ (kbd_cycle = %d)\n", kbd_cycle);
-  assert(!(ccreg&CC_INHIBIT_IRQ));
+  DIAG(DIAG_IRQ, 2, "HEY, INTERRUPTING with IRQ (kbd_cycle = %d)\n", kbd_cycle);
+  DIAG_ASSERT(!(ccreg&CC_INHIBIT_IRQ));
 
   if ((kbd_cycle&1) == 0) {
     int ch = MaybeGetChar();
@@ -891,12 +1282,12 @@ void irq() {
     } else {
           kbd_ch = 0;
     }
-    fprintf(stderr,"HEY, getchar -> ch %x %c kbd_ch %x %c (kbd_cycle = %d)\n", ch, ch, kbd_ch, kbd_ch, kbd_cycle);
+    DIAG(DIAG_KBD, 2, "HEY, getchar -> ch %x %c kbd_ch %x %c (kbd_cycle = %d)\n", ch, ch, kbd_ch, kbd_ch, kbd_cycle);
   }
   if ((kbd_cycle&1) == 1) {
     kbd_ch = 0;
   }
-  fprintf(stderr,"HEY, irq -> kbd_ch %x %c (kbd_cycle = %d)\n", kbd_ch, kbd_ch, kbd_cycle);
+  DIAG(DIAG_KBD, 2, "HEY, irq -> kbd_ch %x %c (kbd_cycle = %d)\n", kbd_ch, kbd_ch, kbd_cycle);
 
   interrupt(VECTOR_IRQ);
   irqs_pending &= ~IRQ_PENDING;
@@ -926,9 +1317,9 @@ Byte GetIOByte(Word a) {
       z = 255;
       if (kbd_ch) {
         z = keypress(kbd_probe, kbd_ch);
-        fprintf(stderr, "HEY, KEYBOARD: %02x {%c} -> %02x\n", kbd_probe, kbd_ch, z);
+        DIAG(DIAG_KBD, 2, "HEY, KEYBOARD: %02x {%c} -> %02x\n", kbd_probe, kbd_ch, z);
       } else {
-        fprintf(stderr, "HEY, KEYBOARD: %02x      -> %02x\n", kbd_probe,         z);
+        DIAG(DIAG_KBD, 2, "HEY, KEYBOARD: %02x      -> %02x\n", kbd_probe,         z);
       }
       return z;
 
@@ -941,7 +1332,7 @@ Byte GetIOByte(Word a) {
 
     /* PIA 1 */
     case 0xFF22:
-      fprintf(stderr, "HEY, TODO: Get Io Byte 0x%04x\n", a);
+      DIAG(DIAG_IO, 1, "HEY, TODO: Get Io Byte 0x%04x\n", a);
       return 0;
 
     case 0xFF48:  /* STATREG */
@@ -951,20 +1342,20 @@ Byte GetIOByte(Word a) {
       z = 0;
       if (disk_i < 256) {
         z = disk_stuff[disk_i];
-        fprintf(stderr, "fnord %x -> %x\n", disk_i, z);
+        DIAG(DIAG_DISK, 2, "fnord %x -> %x\n", disk_i, z);
       } else {
         z = 0;
       }
       ++disk_i;
       if (disk_i==257) {
-        fprintf(stderr, "HEY, Read SET NMI_PENDING\n");
+        DIAG(DIAG_DISK, 2, "HEY, Read SET NMI_PENDING\n");
         irqs_pending |= NMI_PENDING;
         z = 0;
         disk_i = 0;
       }
       return z;
     default:
-      fprintf(stderr, "HEY, UNKNOWN GetIOByte: 0x%04x\n", a);
+      DIAG(DIAG_IO, 1, "HEY, UNKNOWN GetIOByte: 0x%04x\n", a);
       // finish();
       return 0;
   }
@@ -973,7 +1364,7 @@ Byte GetIOByte(Word a) {
 void PutIOByte(Word a, Byte b) {
   switch (a) {
     default:
-      fprintf(stderr, "HEY, UNKNOWN PutIOByte: 0x%04x\n", a);
+      DiagPrintf("HEY, UNKNOWN PutIOByte: 0x%04x\n", a);
       finish();
       return;
 
@@ -989,7 +1380,7 @@ void PutIOByte(Word a, Byte b) {
     case 0xFF21:
     case 0xFF22:
     case 0xFF23:
-      fprintf(stderr, "HEY, TODO: Put IO Byte 0x%04x\n", a);
+      DIAG(DIAG_IO, 1, "HEY, TODO: Put IO Byte 0x%04x\n", a);
       return;
 
     case 0xFF40:  /* CONTROL */
@@ -997,43 +1388,22 @@ void PutIOByte(Word a, Byte b) {
       disk_side = (b&0x40) ? 1 : 0;
       disk_drive = (b&1)? 1 : (b&2)? 2: (b&4)? 3: 0;
 
-      fprintf(stderr,"CONTROL: disk_command %x (control %x side %x drive %x)\n", disk_command, disk_control, disk_side, disk_drive);
+      DIAG(DIAG_DISK, 2, "CONTROL: disk_command %x (control %x side %x drive %x)\n", disk_command, disk_control, disk_side, disk_drive);
       if (!b) break;
 
       switch (disk_command) {
         case 0x80:
           prev_disk_command = disk_command;
-          disk_offset = 256 * (disk_sector - 1 + disk_side*18 + disk_track*36);
-          if (disk_drive != 1) {
-                  fprintf(stderr,"ERROR: R: Drive %d not supported\n", disk_drive);
-                  exit(2);
-          }
-          if (!disk_fd) {
-                  fprintf(stderr,"ERROR: R: No file for Disk Read Sector\n");
-                  exit(2);
-          }
-          memset(disk_stuff, 0, 256);
-          fseek(disk_fd, disk_offset, 0);
-          int n = fread(disk_stuff, 1, 256, disk_fd);
-          assert(n==256);
+          memcpy(disk_stuff, DiskSector("R"), 256);
           disk_i = 0;
-          fprintf(stderr, "HEY, READ fnord (Track, Sector-1) %d:%d:%d:%d == %d\n", disk_drive, disk_track, disk_side, disk_sector-1, disk_offset>>8);
+          DIAG(DIAG_DISK, 2, "HEY, READ fnord (Track, Sector-1) %d:%d:%d:%d == %d\n", disk_drive, disk_track, disk_side, disk_sector-1, disk_offset>>8);
           break;
         case 0xA0:
           prev_disk_command = disk_command;
-          disk_offset = 256 * (disk_sector - 1 + disk_side*18 + disk_track*36);
-          if (disk_drive != 1) {
-                  fprintf(stderr,"ERROR: W: Drive %d not supported\n", disk_drive);
-                  exit(2);
-          }
-          if (!disk_fd) {
-                  fprintf(stderr,"ERROR: W: No file for Disk Read Sector\n");
-                  exit(2);
-          }
+          DiskSector("W");  /* Checks the drive and sets disk_offset. */
           memset(disk_stuff, 0, 256);
-          fseek(disk_fd, disk_offset, 0);
           disk_i = 0;
-          fprintf(stderr, "HEY, WRITE fnord (Track, Sector-1) %d:%d:%d:%d == %d\n", disk_drive, disk_track, disk_side, disk_sector-1, disk_offset>>8);
+          DIAG(DIAG_DISK, 2, "HEY, WRITE fnord (Track, Sector-1) %d:%d:%d:%d == %d\n", disk_drive, disk_track, disk_side, disk_sector-1, disk_offset>>8);
           break;
       }
       disk_command = 0;
@@ -1044,7 +1414,7 @@ void PutIOByte(Word a, Byte b) {
         case 0x10:
           disk_track = disk_data;
           disk_status = 0;
-          fprintf(stderr, "HEY, Seek : %d\n", disk_data);
+          DIAG(DIAG_DISK, 2, "HEY, Seek : %d\n", disk_data);
           break;
         case 0x80:  /* Read Sector */
           /* We have set disk_command.  Next control write defines disk & side. */
@@ -1058,17 +1428,17 @@ void PutIOByte(Word a, Byte b) {
           disk_sector = 0;
           disk_i = 0;
           memset(disk_stuff, 0, 256);
-          fprintf(stderr, "HEY, Reset Disk\n");
+          DIAG(DIAG_DISK, 2, "HEY, Reset Disk\n");
           break;
       }
       break;
     case 0xFF49:  /* TRACK */
       disk_track = b;
-      fprintf(stderr, "HEY, Track : %d\n", b);
+      DIAG(DIAG_DISK, 2, "HEY, Track : %d\n", b);
       break;
     case 0xFF4A:  /* SECTOR */
       disk_sector = b;
-      fprintf(stderr, "HEY, Sector-1 : %d\n", b-1);
+      DIAG(DIAG_DISK, 2, "HEY, Sector-1 : %d\n", b-1);
       break;
     case 0xFF4B:  /* DATA */
       if ((prev_disk_command & 0xF0) != 0xA0) {
@@ -1077,7 +1447,7 @@ void PutIOByte(Word a, Byte b) {
       } // else
       if (1) {
         if (disk_i < 256) {
-          fprintf(stderr, "fnord %x %x <- %x\n", prev_disk_command, disk_i, b);
+          DIAG(DIAG_DISK, 2, "fnord %x %x <- %x\n", prev_disk_command, disk_i, b);
           disk_stuff[disk_i] = b;
           ///++disk_i;
         }
@@ -1086,16 +1456,13 @@ void PutIOByte(Word a, Byte b) {
         if (disk_i < 256) {
           ++disk_i;
         }
-        // TODO -- fix writing.
         if (disk_i >= 256) {
-          fprintf(stderr, "HEY, Write SET NMI_PENDING\n");
+          DIAG(DIAG_DISK, 2, "HEY, Write SET NMI_PENDING\n");
           irqs_pending |= NMI_PENDING;
           disk_i = 0;
 
-          // TODO -- fix writing.
-          fwrite(disk_stuff, 1, 256, disk_fd);
-          fflush(disk_fd);
-          fprintf(stderr, "HEY, DID_WRITE fnord (Track, Sector-1) %d:%d:%d:%d == %d\n", disk_drive, disk_track, disk_side, disk_sector-1, disk_offset>>8);
+          memcpy(drives[disk_drive].image + disk_offset, disk_stuff, 256);
+          DIAG(DIAG_DISK, 2, "HEY, DID_WRITE fnord (Track, Sector-1) %d:%d:%d:%d == %d\n", disk_drive, disk_track, disk_side, disk_sector-1, disk_offset>>8);
         }
       }
 
@@ -1124,7 +1491,7 @@ void PutIOByte(Word a, Byte b) {
     case 0xFFD2:
     case 0xFFD3:
     case 0xFFDF:
-      fprintf(stderr, "VDG PutByte OK: %x <- %x\n", a, b);
+      DIAG(DIAG_IO, 2, "VDG PutByte OK: %x <- %x\n", a, b);
       break;
   }
 }
@@ -1145,20 +1512,81 @@ Byte T(Byte ch) {
   }
 }
 
-Byte GETBYTE(Word a) {
+/* Per-page handlers for memory-mapped I/O, set by InitPages from
+   -L/-H.  NULL means the page is plain RAM. */
+typedef Byte (*PageReader)(Word a);
+typedef void (*PageWriter)(Word a, Byte b);
+PageReader page_read[256];
+PageWriter page_write[256];
+
+Byte IoPageRead(Word a) {
   Byte b = mem[a];
   if (low_reg <= a && a < high_reg) {
     b = GetIOByte(a);
-    fprintf(stderr, "HEY, GETBYTE %04x -> %02x : %c %c\n", a, b, H(b), T(b));
+    DIAG(DIAG_IO, 2, "HEY, GETBYTE %04x -> %02x : %c %c\n", a, b, H(b), T(b));
   }
   return b;
 }
+
+void IoPageWrite(Word a, Byte b) {
+  Byte old = mem[a];
+  mem[a] = b;
+  if (low_reg <= a && a < high_reg) {
+    PutIOByte(a, b);
+    DIAG(DIAG_IO, 2, "HEY, PUTBYTE %04x (was %02x) <- %02x\n", a, old, b);
+  }
+}
+
+void DangerPageWrite(Word a, Byte b) {
+  Byte old = mem[a];
+  mem[a] = b;
+  if (a == 0x7bff) {
+    DIAG(DIAG_IO, 1, "HEY, DANGER: %x %x <- %x\n", a, old, b);
+  }
+}
+
+/* With -B, every page goes through TracePageWrite, which notes the
+   store and then calls the page's own writer, kept in traced_write. */
+PageWriter traced_write[256];
+
+void TracePageWrite(Word a, Byte b) {
+  bt_wr_addr = a;
+  bt_wr_old = mem[a];
+  bt_wr_len = 1;
+  PageWriter f = traced_write[a>>8];
+  if (f) f(a, b);
+  else mem[a] = b;
+}
+
+void InitPages() {
+  unsigned int p;
+  for (p = 0; p < 256; p++) {
+    if (low_reg < (p+1)<<8 && p<<8 < high_reg) {
+      page_read[p] = IoPageRead;
+      page_write[p] = IoPageWrite;
+    }
+  }
+  if (DIAG_ON(DIAG_IO, 1) && !page_write[0x7b]) {
+    page_write[0x7b] = DangerPageWrite;
+  }
+  if (bt_file) {
+    for (p = 0; p < 256; p++) {
+      traced_write[p] = page_write[p];
+      page_write[p] = TracePageWrite;
+    }
+  }
+}
+
+Byte GETBYTE(Word a) {
+  PageReader f = page_read[a>>8];
+  return f ? f(a) : mem[a];
+}
 Byte GETBYTE_ea(Byte* ea) {
   if (ea == areg) return *ea;
   if (ea == breg) return *ea;
 
-  assert(mem <= ea);
-  assert(ea < mem+0x10000);
+  DIAG_ASSERT(mem <= ea);
+  DIAG_ASSERT(ea < mem+0x10000);
   Word a = ea - mem;
   Byte z = GETBYTE(a);
   /*
@@ -1170,15 +1598,9 @@ Byte GETBYTE_ea(Byte* ea) {
 }
 
 void PUTBYTE(Word a, Byte b) {
-  Byte old = mem[a];
-  mem[a] = b;
-  if (low_reg <= a && a < high_reg) {
-    PutIOByte(a, b);
-    fprintf(stderr, "HEY, PUTBYTE %04x (was %02x) <- %02x\n", a, old, b);
-  }
-  if (a == 0x7bff) {
-    fprintf(stderr, "HEY, DANGER: %x %x <- %x\n", a, old, b);
-  }
+  PageWriter f = page_write[a>>8];
+  if (f) f(a, b);
+  else mem[a] = b;
 }
 
 void da_inst(char *inst, char *reg, int cyclecount) {
@@ -1212,7 +1634,7 @@ void da_reg(Byte b)
 
 Word illaddr() /* illegal addressing mode, defaults to zero */
 {
- fprintf(stderr, "Illegal Addressing Mode.");
+ DiagPrintf("Illegal Addressing Mode.");
 #ifdef TRACE
   if (tmode) {
     trace();
@@ -1406,7 +1828,7 @@ Byte * eaddr0() /* effective address for NEG..JMP as byte pointer */
  {
   case 0: return mem+zeropage();
   case 1:case 2:case 3: /*canthappen*/
-      fprintf(stderr, "HEY, UNKNOWN eaddr0: %02x\n", ireg);
+      DiagPrintf("HEY, UNKNOWN eaddr0: %02x\n", ireg);
       finish();
 
   case 4: da_inst_cat("a",-2); return areg;
@@ -1440,9 +1862,9 @@ Word eaddr16() /* effective address for 16-bits ops. */
 
 void ill() /* illegal opcode==noop */
 {
- fprintf(stderr,"Illegal Opcode\n");
+ DiagPrintf("Illegal Opcode\n");
  DumpAllMemory();
- fprintf(stderr,"Illegal Opcode\n");
+ DiagPrintf("Illegal Opcode\n");
  finish();
 }
 
@@ -1810,7 +2232,15 @@ void inc()
  r++;
  if(r==0x80)SEV else CLV
  SETNZ8(r)
- *ea=r;
+ // *ea=r;
+ long gap = ea-mem;  // PUTBYTE_ea
+ if (0 <= gap && gap <= 0x10000) {
+   /* for memory */
+   PUTBYTE((Word)gap, r);
+ } else {
+   /* for registers */
+   *ea = r;
+ }
 }
 
 void dec()
@@ -1824,7 +2254,15 @@ void dec()
  r--;
  if(r==0x7f)SEV else CLV
  SETNZ8(r)
- *ea=r;
+ // *ea=r;
+ long gap = ea-mem;  // PUTBYTE_ea
+ if (0 <= gap && gap <= 0x10000) {
+   /* for memory */
+   PUTBYTE((Word)gap, r);
+ } else {
+   /* for registers */
+   *ea = r;
+ }
 }
 
 void tst()
@@ -1904,7 +2342,7 @@ void nop()
 
 void sync_inst()
 {
- fprintf(stderr, "HEY, Waiting, sync_inst.\n");
+ DIAG(DIAG_CPU, 1, "HEY, Waiting, sync_inst.\n");
  Waiting = true;
 }
 
@@ -1915,7 +2353,7 @@ void cwai()
  ccreg &= b;
  pcreg++;
 
- fprintf(stderr, "HEY, Waiting, cwai #$%02x.\n", b);
+ DIAG(DIAG_CPU, 1, "HEY, Waiting, cwai #$%02x.\n", b);
  Waiting = true;
 
  da_inst("cwai",NULL,20);
@@ -2041,7 +2479,7 @@ void DumpAllMemory() {
   int i, j;
   static char buf[200];
   memset(buf, 0, sizeof buf);
-  fprintf(stderr, "\n#DumpAllMemory(\n");
+  DiagPrintf("\n#DumpAllMemory(\n");
   for (i=0; i < 0x10000; i+=32) {
     sprintf(buf, "%04x: ", (unsigned)i);
     for (j=0; j<32; j+=8) {
@@ -2050,45 +2488,45 @@ void DumpAllMemory() {
               mem[i+j+0], mem[i+j+1], mem[i+j+2], mem[i+j+3],
               mem[i+j+4], mem[i+j+5], mem[i+j+6], mem[i+j+7]);
     }
-    fprintf(stderr, "%s ", buf);
+    DiagPrintf("%s ", buf);
     for (j=0; j<32; j++) {
       Byte ch = mem[i+j];
       buf[j] = (' ' <= ch && ch <= '~') ? ch : '.';
     }
     buf[j] = '\0';
-    fprintf(stderr, "%s\n", buf);
+    DiagPrintf("%s\n", buf);
   }
-  fprintf(stderr, "#DumpAllMemory)\n");
+  DiagPrintf("#DumpAllMemory)\n");
 }
 
 
 void DumpPageZero() {
   Word a = 0;
-  fprintf(stderr, "PageZero: FreeBitMap=%x:%x MemoryLimit=%x ModDir=%x RomBase=%x\n",
+  DiagPrintf("PageZero: FreeBitMap=%x:%x MemoryLimit=%x ModDir=%x RomBase=%x\n",
                   W(D_FMBM), W(D_FMBM+2), W(D_MLIM), W(D_ModDir), W(D_Init));
-  fprintf(stderr, "  D_SWI3=%x D_SWI2=%x FIRQ=%x IRQ=%x SWI=%x NMI=%x SvcIRQ=%x Poll=%x\n",
+  DiagPrintf("  D_SWI3=%x D_SWI2=%x FIRQ=%x IRQ=%x SWI=%x NMI=%x SvcIRQ=%x Poll=%x\n",
                   W(D_SWI3), W(D_SWI2), W(D_FIRQ), W(D_IRQ), W(D_SWI), W(D_NMI), W(D_SvcIRQ), W(D_Poll)); 
-  fprintf(stderr, "  BTLO=%x BTHI=%x  IO Free Mem Lo=%x Hi=%x D_DevTbl=%x D_PolTbl=%x D_PthDBT=%x D_Proc=%x\n",
+  DiagPrintf("  BTLO=%x BTHI=%x  IO Free Mem Lo=%x Hi=%x D_DevTbl=%x D_PolTbl=%x D_PthDBT=%x D_Proc=%x\n",
                   W(D_BTLO), W(D_BTHI), W(D_IOML), W(D_IOMH), W(D_DevTbl), W(D_PolTbl), W(D_PthDBT), W(D_Proc)); 
-  fprintf(stderr, "  D_Slice=%x D_TSlice=%x\n",
+  DiagPrintf("  D_Slice=%x D_TSlice=%x\n",
                   W(D_Slice), W(D_TSlice));
 }
 
 void DumpPathDesc(Word a) {
   if (!B(PD_PD)) return;
-  fprintf(stderr, "Path @%x: #=%x mode=%x count=%x dev=%x\n", a, B(PD_PD), B(PD_MOD), B(PD_CNT), W(PD_DEV));
-  fprintf(stderr, "   curr_process=%x caller_reg_stack=%x buffer=%x  dev_type=%x\n",
+  DiagPrintf("Path @%x: #=%x mode=%x count=%x dev=%x\n", a, B(PD_PD), B(PD_MOD), B(PD_CNT), W(PD_DEV));
+  DiagPrintf("   curr_process=%x caller_reg_stack=%x buffer=%x  dev_type=%x\n",
                   B(PD_CPR), B(PD_RGS), B(PD_BUF), B(PD_DTP)); 
   // the Device Table Entry:
   Word dev = W(PD_DEV);
   {
     Word a = dev;
     // ModuleName returns static storage, so only use one of those per fprintf.
-    fprintf(stderr, "   dev: @%x driver_mod=%x=%s ",
+    DiagPrintf("   dev: @%x driver_mod=%x=%s ",
                     dev, W(V_DRIV), ModuleName(W(V_DRIV)));
-    fprintf(stderr, "driver_static_store=%x descriptor_mod=%x=%s ",
+    DiagPrintf("driver_static_store=%x descriptor_mod=%x=%s ",
                     W(V_STAT), W(V_DESC), ModuleName(W(V_DESC)));
-    fprintf(stderr, "file_man=%x=%s use=%d\n",
+    DiagPrintf("file_man=%x=%s use=%d\n",
                     W(V_FMGR), ModuleName(W(V_FMGR)), B(V_USRS));
   }
 }
@@ -2111,14 +2549,14 @@ void DumpAllPathDescs() {
 }
 
 void DumpProcDesc(Word a) {
-  fprintf(stderr, "Process @%x: id=%x pid=%x sid=%x cid=%x\n", a, B(P_ID), B(P_PID), B(P_SID), B(P_CID));
-  fprintf(stderr, "   sp=%x chap=%x Addr=%x PagCnt=%x User=%x Pri=%x Age=%x State=%x\n",
+  DiagPrintf("Process @%x: id=%x pid=%x sid=%x cid=%x\n", a, B(P_ID), B(P_PID), B(P_SID), B(P_CID));
+  DiagPrintf("   sp=%x chap=%x Addr=%x PagCnt=%x User=%x Pri=%x Age=%x State=%x\n",
                   W(P_SP), B(P_CHAP), B(P_ADDR), B(P_PagCnt), W(P_User), B(P_Prior), B(P_Age), B(P_State));
   Word mod = W(P_PModul);
   Word name = mod + GETWORD(mod+4);
-  fprintf(stderr, "   Queue=%x IOQP=%x IOQN=%x PModul='%s' Signal=%x SigVec=%x SigDat=%x\n",
+  DiagPrintf("   Queue=%x IOQP=%x IOQN=%x PModul='%s' Signal=%x SigVec=%x SigDat=%x\n",
                   W(P_Queue), B(P_IOQP), B(P_IOQN), Os9String(name), B(P_Signal), B(P_SigVec), B(P_SigDat)); 
-  fprintf(stderr, "   DIO %x %x %x %x %x %x PATH %x %x %x %x %x %x %x %x %x %x %x %x %x %x %x %x\n",
+  DiagPrintf("   DIO %x %x %x %x %x %x PATH %x %x %x %x %x %x %x %x %x %x %x %x %x %x %x %x\n",
                   W(P_DIO), W(P_DIO+2), W(P_DIO+4),
                   W(P_DIO+6), W(P_DIO+8), W(P_DIO+10),
                   B(P_PATH+0), B(P_PATH+1), B(P_PATH+2), B(P_PATH+3),
@@ -2133,19 +2571,19 @@ void DumpProcDesc(Word a) {
 void DumpProcesses() {
   Word a = 0;  // kernel direct page.
   if (W(D_Proc)) {
-    fprintf(stderr, "D_Proc:\n");
+    DiagPrintf("D_Proc:\n");
     DumpProcDesc(W(D_Proc));
   }
   if (W(D_AProcQ)) {
-    fprintf(stderr, "D_AProcQ: Active:\n");
+    DiagPrintf("D_AProcQ: Active:\n");
     DumpProcDesc(W(D_AProcQ));
   }
   if (W(D_WProcQ)) {
-    fprintf(stderr, "D_WProcQ: Wait:\n");
+    DiagPrintf("D_WProcQ: Wait:\n");
     DumpProcDesc(W(D_WProcQ));
   }
   if (W(D_SProcQ)) {
-    fprintf(stderr, "D_SProcQ: Sleep\n");
+    DiagPrintf("D_SProcQ: Sleep\n");
     DumpProcDesc(W(D_SProcQ));
   }
 }
@@ -2158,16 +2596,194 @@ void Os9AllMemoryModules() {
   DumpPageZero();
   DumpProcesses();
   DumpAllPathDescs();
-  fprintf(stderr, "\n#Os9AllMemoryModules(\n");
+  DiagPrintf("\n#Os9AllMemoryModules(\n");
   for (; i < limit; i += 4) {
     Word mod = GETWORD(i);
     if (mod) {
       Word end = mod + GETWORD(mod+2);
       Word name = mod + GETWORD(mod+4);
-      fprintf(stderr, "%x:%x:<%s> ", mod, end, Os9String(name));
+      DiagPrintf("%x:%x:<%s> ", mod, end, Os9String(name));
     }
   }
-  fprintf(stderr, "\n#Os9AllMemoryModules)\n");
+  DiagPrintf("\n#Os9AllMemoryModules)\n");
+}
+
+/* Batch mode, for running many emulators from a test suite:
+   console output from the putchar SWI, or written to OS9's Term,
+   goes to console_out (-O), and the run finishes as soon as an
+   output line matches the -e regex (exit 0) or the -x regex (exit 1),
+   or when more than -C cycles have run (exit 3).  Lines are matched
+   when they end (at CR or LF, or at 255 characters), so "^Test 1$"
+   cannot match while "Test 10" is still printing, and a prompt with
+   no line end never matches.  With -e, a run that finishes any other
+   way (-Z, input EOF, page 0) exits 4, so it cannot pass for a match.
+   Input comes from -K.  console_out is flushed at each line end,
+   before waiting for a key, and in finish(). */
+static regex_t expect_re, fail_re;
+static int expect_set, fail_set;
+static unsigned long max_cycles;
+static int exit_status;
+static char console_line[256];
+static int console_len;
+
+void CompileRegex(regex_t* re, char* pattern) {
+  if (regcomp(re, pattern, REG_EXTENDED|REG_NOSUB)) {
+    DiagError("ERROR: Bad regex: %s\n", pattern);
+    exit(2);
+  }
+}
+
+/* ConsoleLine matches the finished console_line, and starts again. */
+void ConsoleLine() {
+  if (!console_len) return;
+  console_len = 0;
+  if (fail_set && !regexec(&fail_re, console_line, 0, NULL, 0)) {
+    DiagPrintf("\nFAILED: %s\n", console_line);
+    exit_status = 1;
+    finish();
+  }
+  if (expect_set && !regexec(&expect_re, console_line, 0, NULL, 0)) {
+    DiagPrintf("\nEXPECTED: %s\n", console_line);
+    exit_status = 0;
+    finish();
+  }
+}
+
+void ConsolePut(Byte ch) {
+  putc(ch, console_out);
+  if (ch == '\n' || ch == '\r') {
+    fflush(console_out);
+    ConsoleLine();
+    return;
+  }
+  if (!expect_set && !fail_set) return;
+
+  console_line[console_len++] = ch;
+  console_line[console_len] = 0;
+  if (console_len == sizeof console_line - 1) {
+    ConsoleLine();  /* Overlong line: match it in pieces. */
+  }
+}
+
+/* CheckCycleLimit is called at each IRQ_FREQ steps, so the limit
+   costs nothing per step.  It also finishes after SIGINT or SIGTERM. */
+void CheckCycleLimit() {
+  if (diag_signal) {
+    DiagPrintf("\nSIGNAL %d\n", diag_signal);
+    exit_status = 128 + diag_signal;
+    finish();
+  }
+  if (max_cycles && cycles_sum > max_cycles) {
+    DiagPrintf("\nCYCLE LIMIT %lu\n", max_cycles);
+    exit_status = 3;
+    finish();
+  }
+}
+
+/* Snapshots, so tests can start from a booted OS9 rather than from
+   the image.  -S file@N saves the machine before step N, and -S file
+   when the program does "os9 $FE" (SNAP_SERVICE), which is otherwise
+   not an OS9 call (so SWI2 must not be the putchar SWI: use -o0, as
+   for OS9); the run goes on either way.  -R file starts from
+   the snapshot instead of an image, with steps, -Z and -T counting
+   from the snapshot's step.  Disk images are not in the snapshot, nor
+   are options: restore with the same -L, -H and -f.  A run that
+   finishes without saving one exits 6, unless it was already failing. */
+#define SNAP_SERVICE 0xFE
+static char* snap_name;
+static long snap_step = -1;
+static int snap_saved;
+
+struct Snapshot {
+  char magic[8];         /* "EMUSNAP" */
+  int size;              /* sizeof(struct Snapshot) */
+  Byte cc, dp, a, b;
+  Word x, y, u, s, pc;
+  bool waiting;
+  int irqs_pending;
+  long steps;
+  struct {
+    Word pc;
+    Byte pending, service;
+    Word a, b, c;
+  } completions[MAX_COMPLETIONS];
+  Byte kbd_probe;
+  int kbd_cycle, kbd_ch;
+  Byte prev_disk_command, disk_command, disk_drive, disk_side, disk_sector;
+  Byte disk_track, disk_status, disk_data, disk_control;
+  int disk_offset, disk_i;
+  Byte disk_stuff[256];
+  Byte mem[65536];
+};
+
+void SaveSnapshot() {
+  static struct Snapshot z;  /* Static, for the size. */
+  int i;
+  memset(&z, 0, sizeof z);
+  strcpy(z.magic, "EMUSNAP");
+  z.size = sizeof z;
+  z.cc = ccreg; z.dp = dpreg; z.a = *areg; z.b = *breg;
+  z.x = xreg; z.y = yreg; z.u = ureg; z.s = sreg; z.pc = pcreg;
+  z.waiting = Waiting;
+  z.irqs_pending = irqs_pending;
+  z.steps = steps;
+  for (i = 0; i < MAX_COMPLETIONS; i++) {
+    struct Completion* cp = &Os9SysCallCompletion[i];
+    z.completions[i].pc = cp->pc;
+    z.completions[i].pending = (cp->f != NULL);  /* Always DefaultCompleter. */
+    z.completions[i].service = cp->service;
+    z.completions[i].a = cp->a;
+    z.completions[i].b = cp->b;
+    z.completions[i].c = cp->c;
+  }
+  z.kbd_probe = kbd_probe; z.kbd_cycle = kbd_cycle; z.kbd_ch = kbd_ch;
+  z.prev_disk_command = prev_disk_command; z.disk_command = disk_command;
+  z.disk_drive = disk_drive; z.disk_side = disk_side; z.disk_sector = disk_sector;
+  z.disk_track = disk_track; z.disk_status = disk_status; z.disk_data = disk_data;
+  z.disk_control = disk_control; z.disk_offset = disk_offset; z.disk_i = disk_i;
+  memcpy(z.disk_stuff, disk_stuff, sizeof z.disk_stuff);
+  memcpy(z.mem, mem, sizeof z.mem);
+
+  FILE* f = fopen(snap_name, "wb");
+  if (!f || fwrite(&z, sizeof z, 1, f) != 1 || fclose(f)) {
+    DiagError("ERROR: Cannot write snapshot: %s\n", snap_name);
+    exit(2);
+  }
+  DiagPrintf("SNAPSHOT %s at step %ld\n", snap_name, steps);
+  snap_saved = 1;
+}
+
+void LoadSnapshot(char* name) {
+  static struct Snapshot z;
+  int i;
+  FILE* f = fopen(name, "rb");
+  if (!f || fread(&z, sizeof z, 1, f) != 1 || strcmp(z.magic, "EMUSNAP") || z.size != sizeof z) {
+    DiagError("ERROR: Cannot read snapshot: %s\n", name);
+    exit(2);
+  }
+  fclose(f);
+  ccreg = z.cc; dpreg = z.dp; *areg = z.a; *breg = z.b;
+  xreg = z.x; yreg = z.y; ureg = z.u; sreg = z.s; pcreg = z.pc;
+  Waiting = z.waiting;
+  irqs_pending = z.irqs_pending;
+  steps = z.steps;
+  for (i = 0; i < MAX_COMPLETIONS; i++) {
+    struct Completion* cp = &Os9SysCallCompletion[i];
+    cp->pc = z.completions[i].pc;
+    cp->f = z.completions[i].pending ? DefaultCompleter : NULL;
+    cp->service = z.completions[i].service;
+    cp->a = z.completions[i].a;
+    cp->b = z.completions[i].b;
+    cp->c = z.completions[i].c;
+    if (cp->f) completion_bits[cp->pc>>5] |= 1u<<(cp->pc&31);
+  }
+  kbd_probe = z.kbd_probe; kbd_cycle = z.kbd_cycle; kbd_ch = z.kbd_ch;
+  prev_disk_command = z.prev_disk_command; disk_command = z.disk_command;
+  disk_drive = z.disk_drive; disk_side = z.disk_side; disk_sector = z.disk_sector;
+  disk_track = z.disk_track; disk_status = z.disk_status; disk_data = z.disk_data;
+  disk_control = z.disk_control; disk_offset = z.disk_offset; disk_i = z.disk_i;
+  memcpy(disk_stuff, z.disk_stuff, sizeof disk_stuff);
+  memcpy(mem, z.mem, sizeof mem);
 }
 
 void swi()
@@ -2179,12 +2795,15 @@ void swi()
  da_len = 4;  /* Often an extra info after the SWI opcode */
 
  if (swi_num == swi_for_putchar) {
-  putchar(*breg);
-  fflush(stdout);
+  ConsolePut(*breg);
  } else if (swi_num == swi_for_getchar) {
-  w=getchar();
+  w=GetKey();
   if(w==EOF)SEC else CLC
   *breg=w;
+ } else if (swi_num == 2 && snap_name && GETBYTE(pcreg) == SNAP_SERVICE) {
+  pcreg++;
+  CLC
+  snap_step = steps + 1;  /* After this instruction. */
  } else {
   Word tmp;
   ccreg |= 0x80;
@@ -2214,7 +2833,7 @@ void swi()
     break;
   }
   if (!tmp) {
-    fprintf(stderr, "FATAL: Attempted SWI%d with zero vector\n", swi_num);
+    DiagPrintf("FATAL: Attempted SWI%d with zero vector\n", swi_num);
 #ifdef TRACE
     trace();
 #endif
@@ -2547,13 +3166,15 @@ void subd()
 {
  unsigned long aop,bop,res;
  Word ea;
- if (iflag) da_inst("cmpd",NULL,5);
- else da_inst("subd",NULL,5);
  if(iflag==2) {
         aop=ureg;
         da_inst("cmpu",NULL,5);
  }
- else aop=*dreg & 0xffff;
+ else {
+        aop=*dreg & 0xffff;
+        if (iflag) da_inst("cmpd",NULL,5);
+        else da_inst("subd",NULL,5);
+ }
  ea=eaddr16();
  bop=GETWORD(ea);
  res=aop-bop;
@@ -2623,7 +3244,7 @@ void std()
  ea=eaddr16();
  w=*dreg;
  SETNZ16(w)
- SETWORD(ea,w)
+ STOREWORD(ea,w)
 }
 
 void stx()
@@ -2634,7 +3255,7 @@ void stx()
  ea=eaddr16();
  if (iflag==0) w=xreg; else w=yreg;
  SETNZ16(w)
- SETWORD(ea,w)
+ STOREWORD(ea,w)
 }
 
 void stu()
@@ -2645,7 +3266,7 @@ void stu()
  ea=eaddr16();
  if (iflag==0) w=ureg; else w=sreg;
  SETNZ16(w)
- SETWORD(ea,w)
+ STOREWORD(ea,w)
 }
 
 void (*instrtable[])() = {
@@ -2688,10 +3309,10 @@ void read_image(char* name)
  FILE *image;
  if((image=fopen(name,"rb"))!=NULL) {
   int n = fread(mem+0x100,1,0xff00,image);
-  assert ( n > 1 );
+  DIAG_ASSERT( n > 1 );
   fclose(image);
  } else {
-  fprintf(stderr,"ERROR: Cannot read image file\n");
+  DiagError("ERROR: Cannot read image file\n");
   exit(2);
  }
 }
@@ -2723,9 +3344,9 @@ char *to_bin(Byte b)
 
 void cr() {
    #ifdef TERM_CONTROL
-   fprintf(stderr,"%s","\r\n");         /* CR+LF because raw terminal ... */
+   DiagPrintf("%s","\r\n");         /* CR+LF because raw terminal ... */
    #else
-   fprintf(stderr,"%s","\n");
+   DiagPrintf("%s","\n");
    #endif
 }
 
@@ -2747,12 +3368,12 @@ void where(int addr) {
         while(1) {
           int ch = 127 & GETBYTE(name);
           if ('!' <= ch && ch <= '~') {
-            fprintf(stderr, "%c", ch);
+            DiagPrintf("%c", ch);
           } else {
             break;
           }
           if (GETBYTE(name) & 128) {
-            fprintf(stderr, ",%04x ", addr-mod);
+            DiagPrintf(",%04x ", addr-mod);
             return;
           }
           ++name;
@@ -2760,20 +3381,151 @@ void where(int addr) {
       }
     }
   }
-  fprintf(stderr, "? ");
+  DiagPrintf("? ");
 }
 
 char been_there[0x10000];
+
+/* Binary trace: with -B file, trace() writes fixed-size records
+   instead of text lines, through a large stdio buffer.  The records
+   are in host byte order, after a header record that starts with
+   "EMUTRACE" and the Word 0x1234.  Each step is a BtInst.  A BtDis
+   with the disassembly comes before the first step at each PC, and
+   again when the code there changes; a BtMod with the name comes
+   before the first step in each module.  decode_trace renders them
+   as the text trace. */
+#define BT_RECORD 48
+struct BtInst {          /* kind 'I' */
+  Byte kind, flags, ilen, cycles;
+  Word pc;
+  Byte code[I_MAX];
+  Byte a, b, cc, dp;
+  Word x, y, u, s;
+  Word s0, s1;           /* The words at s and s+2. */
+  Word mod;              /* The module holding pc, or 0. */
+  Word wr_addr, wr_old, wr_new;
+  Byte wr_len;           /* 0, 1 or 2 bytes stored at wr_addr. */
+  Byte pad[5];
+  unsigned long long step;
+};
+#define BT_NEW 1         /* flags: first visit to pc ('N'). */
+struct BtDis {           /* kind 'D' */
+  Byte kind, pad;
+  Word pc;
+  char dinst[6];
+  char dops[32];
+  Byte pad2[6];
+};
+struct BtMod {           /* kind 'M' */
+  Byte kind, pad;
+  Word mod, size;
+  char name[BT_RECORD-6];
+};
+
+static Byte bt_code[0x10000][I_MAX];  /* Code last disassembled at each pc. */
+static Byte bt_dis_done[0x10000];
+static Byte bt_mod_hash[0x10000];     /* Hash of the name last written for a module, or 0. */
+
+void OpenBinTrace(char* name) {
+  static char header[BT_RECORD] = "EMUTRACE";
+  bt_file = fopen(name, "wb");
+  if (!bt_file) {
+    DiagError("ERROR: Cannot create file: %s\n", name);
+    exit(2);
+  }
+  setvbuf(bt_file, NULL, _IOFBF, 4<<20);
+  *(Word*)(header+8) = 0x1234;
+  *(Word*)(header+10) = BT_RECORD;
+  fwrite(header, BT_RECORD, 1, bt_file);
+}
+
+/* BinTraceModule finds the module holding addr, as where() does,
+   and writes its name if it is new there. */
+Word BinTraceModule(Word addr) {
+  Word i;
+  for (i = GETWORD(0x26); i < GETWORD(0x28); i += 4) {
+    Word mod = GETWORD(i);
+    if (!mod) continue;
+    Word size = GETWORD(mod+2);
+    if (!(mod < addr && addr < mod+size)) continue;
+
+    struct BtMod m = {'M'};
+    Word name = mod + GETWORD(mod+4);
+    Byte hash = size;
+    int j;
+    for (j = 0; j < sizeof m.name - 1; j++) {
+      int ch = 127 & GETBYTE(name+j);
+      if (ch < '!' || '~' < ch) break;
+      m.name[j] = ch;
+      hash = hash*31 + ch;
+      if (GETBYTE(name+j) & 128) {
+        if (!hash) hash = 1;
+        if (bt_mod_hash[mod] != hash) {
+          bt_mod_hash[mod] = hash;
+          m.mod = mod;
+          m.size = size;
+          fwrite(&m, BT_RECORD, 1, bt_file);
+        }
+        return mod;
+      }
+    }
+  }
+  return 0;
+}
+
+void BinTrace(int ilen) {
+  Word pc = pcreg_prev;
+  struct BtInst r = {'I'};
+  int i;
+  r.flags = been_there[pc] ? 0 : BT_NEW;
+  been_there[pc] = 1;
+  for (i = 0; i < I_MAX; i++) {
+    r.code[i] = (i < ilen) ? mem[(Word)(pc+i)] : 0;
+  }
+  if (!bt_dis_done[pc] || memcmp(bt_code[pc], r.code, I_MAX)) {
+    struct BtDis d = {'D'};
+    d.pc = pc;
+    strncpy(d.dinst, dinst, sizeof d.dinst);
+    strncpy(d.dops, dops, sizeof d.dops);
+    fwrite(&d, BT_RECORD, 1, bt_file);
+    memcpy(bt_code[pc], r.code, I_MAX);
+    bt_dis_done[pc] = 1;
+  }
+  r.mod = BinTraceModule(pc);
+  r.ilen = ilen;
+  r.cycles = cycles;
+  r.pc = pc;
+  r.a = *areg; r.b = *breg; r.cc = ccreg; r.dp = dpreg;
+  r.x = xreg; r.y = yreg; r.u = ureg; r.s = sreg;
+  r.s0 = mem[sreg]<<8 | mem[(Word)(sreg+1)];
+  r.s1 = mem[(Word)(sreg+2)]<<8 | mem[(Word)(sreg+3)];
+  if (bt_wr_len) {
+    r.wr_len = bt_wr_len;
+    r.wr_addr = bt_wr_addr;
+    r.wr_old = bt_wr_old;
+    r.wr_new = (bt_wr_len == 2) ? GETWORD(bt_wr_addr) : mem[bt_wr_addr];
+    bt_wr_len = 0;
+  }
+  r.step = steps;
+  fwrite(&r, BT_RECORD, 1, bt_file);
+}
+
 void trace()
 {
    int ilen;
    int i;
 
-  if (1) {
+  if (bt_file) {
+   if (da_len) ilen = da_len;
+   else {
+        ilen = pcreg-pcreg_prev; if (ilen < 0) ilen= -ilen;
+   }
+   BinTrace(ilen);
+  } else {
    int save_pcreg_prev = pcreg_prev;
    where(save_pcreg_prev);
    int oldnew = been_there[pcreg_prev] ? 'o' : 'N';
-   fprintf(stderr,"%c %04x ", oldnew, pcreg_prev);
+   DiagPrintf("%c %04x ", oldnew, pcreg_prev);
    been_there[pcreg_prev] = 1;
 
    if (da_len) ilen = da_len;
@@ -2781,15 +3533,15 @@ void trace()
         ilen = pcreg-pcreg_prev; if (ilen < 0) ilen= -ilen;
    }
    for(i=0; i < I_MAX; i++) {
-        if (i < ilen) fprintf(stderr,"%02x",mem[(pcreg_prev+i)&0xffff]);
-        else fprintf(stderr,"  ");
+        if (i < ilen) DiagPrintf("%02x",mem[(pcreg_prev+i)&0xffff]);
+        else DiagPrintf("  ");
    }
-   fprintf(stderr," %-5s %-17s [%02d] ", dinst, dops, cycles);
+   DiagPrintf(" %-5s %-17s [%02d] ", dinst, dops, cycles);
    //if((ireg&0xfe)==0x10)
-   // fprintf(stderr,"%02x ",mem[pcreg]);else fprintf(stderr,"   ");
-   fprintf(stderr,"x=%04x y=%04x u=%04x s=%04x a=%02x b=%02x cc=%s dp=%02x",
+   // DiagPrintf("%02x ",mem[pcreg]);else DiagPrintf("   ");
+   DiagPrintf("x=%04x y=%04x u=%04x s=%04x a=%02x b=%02x cc=%s dp=%02x",
                    xreg,yreg,ureg,sreg,*areg,*breg,to_bin(ccreg), dpreg);
-   fprintf(stderr,", s: %04x %04x, #%ld",
+   DiagPrintf(", s: %04x %04x, #%ld",
         mem[sreg]<<8|mem[sreg+1],
         mem[sreg+2]<<8|mem[sreg+3],
         steps
@@ -2802,7 +3554,182 @@ void trace()
 #endif
 
 
-static char optstring[]="0Ftdi:o:H:L:Z:f:T:X";
+#ifdef THREADED
+
+/* Threaded core: with -DTHREADED the step loop dispatches through a
+   table of GCC label addresses (computed goto), with pcreg and ccreg
+   cached in locals.  Only the common register-only opcodes in FAST_OPS
+   have inline bodies; everything else, and everything while tracing,
+   goes through instrtable.  -E runs each FAST_OPS body and the
+   instrtable handler from the same state and stops on a difference. */
+
+static int emode = 0;  /* Check FAST_OPS against instrtable? */
+
+#define T_NZ(r) (((r) ? 0 : 0x04) | ((r) & 0x80 ? 0x08 : 0))
+#define T_NXORV ((cc&0x08)^(cc&0x02))
+#define T_BR(f) { Byte b = mem[pc++]; if (f) pc += SIGNED(b); cycles += 3; }
+#define T_INC(r) { Byte v = ++(r); cc = (cc & ~0x0E) | (v == 0x80 ? 0x02 : 0) | T_NZ(v); cycles += 2; }
+#define T_DEC(r) { Byte v = --(r); cc = (cc & ~0x0E) | (v == 0x7f ? 0x02 : 0) | T_NZ(v); cycles += 2; }
+#define T_TST(r) { cc = (cc & ~0x0E) | T_NZ(r); cycles += 2; }
+#define T_CLR(r) { (r) = 0; cc = (cc & ~0x0F) | 0x04; cycles += 2; }
+#define T_LDI(r) { Byte v = GETBYTE(pc); pc++; cc = (cc & ~0x0E) | T_NZ(v); (r) = v; cycles += 2; }
+
+#define FAST_OPS(X) \
+  X(0x12, cycles += 2) \
+  X(0x20, T_BR(1)) \
+  X(0x21, T_BR(0)) \
+  X(0x22, T_BR(!(cc&0x05))) \
+  X(0x23, T_BR(cc&0x05)) \
+  X(0x24, T_BR(!(cc&0x01))) \
+  X(0x25, T_BR(cc&0x01)) \
+  X(0x26, T_BR(!(cc&0x04))) \
+  X(0x27, T_BR(cc&0x04)) \
+  X(0x28, T_BR(!(cc&0x02))) \
+  X(0x29, T_BR(cc&0x02)) \
+  X(0x2A, T_BR(!(cc&0x08))) \
+  X(0x2B, T_BR(cc&0x08)) \
+  X(0x2C, T_BR(!T_NXORV)) \
+  X(0x2D, T_BR(T_NXORV)) \
+  X(0x2E, T_BR(!(T_NXORV||cc&0x04))) \
+  X(0x2F, T_BR(T_NXORV||cc&0x04)) \
+  X(0x4A, T_DEC(*areg)) \
+  X(0x4C, T_INC(*areg)) \
+  X(0x4D, T_TST(*areg)) \
+  X(0x4F, T_CLR(*areg)) \
+  X(0x5A, T_DEC(*breg)) \
+  X(0x5C, T_INC(*breg)) \
+  X(0x5D, T_TST(*breg)) \
+  X(0x5F, T_CLR(*breg)) \
+  X(0x86, T_LDI(*areg)) \
+  X(0xC6, T_LDI(*breg))
+
+#define SYNC_OUT {pcreg=pc; ccreg=cc;}
+#define SYNC_IN {pc=pcreg; cc=ccreg;}
+
+/* Called with pcreg after the opcode in ireg. */
+void threaded_check()
+{
+ Word pc = pcreg;
+ Byte cc = ccreg;
+ Byte a0 = *areg, b0 = *breg;
+ int cycles0 = cycles;
+ Word pc1;
+ Byte cc1, a1, b1;
+ int cycles1;
+
+ switch (ireg) {
+#define X(op, body) case op: { body; } break;
+  FAST_OPS(X)
+#undef X
+  default:
+   (*instrtable[ireg])();
+   return;
+ }
+ pc1 = pc; cc1 = cc; a1 = *areg; b1 = *breg; cycles1 = cycles;
+ *areg = a0; *breg = b0; cycles = cycles0;
+ (*instrtable[ireg])();
+ if (pc1 != pcreg || cc1 != ccreg || a1 != *areg || b1 != *breg || cycles1 != cycles) {
+   DiagPrintf("THREADED MISMATCH: op %02x at %04x: fast pc=%04x cc=%02x a=%02x b=%02x cycles=%d; instrtable pc=%04x cc=%02x a=%02x b=%02x cycles=%d\n",
+           ireg, pcreg_prev, pc1, cc1, a1, b1, cycles1, pcreg, ccreg, *areg, *breg, cycles);
+   exit_status = 5;
+   finish();
+ }
+}
+
+/* Same as the step loop in main. */
+void run_threaded(long maxsteps, long tracetrigger)
+{
+ static void *fast[256];
+ Word pc = pcreg;
+ Byte cc = ccreg;
+ int i;
+
+ for (i = 0; i < 256; i++) fast[i] = &&slow;
+#define X(op, body) fast[op] = &&fast_##op;
+ FAST_OPS(X)
+#undef X
+
+ goto top;
+
+next:
+ cycles_sum += cycles;
+#ifdef TRACE
+ if (tmode) {
+   SYNC_OUT
+   trace();
+ }
+#endif
+loop:
+ pcreg_prev = pc;
+ steps++;
+top:
+ if (maxsteps && steps >= maxsteps) {
+   SYNC_OUT
+   return;
+ }
+ if (steps == tracetrigger) {
+   tmode = 1;
+   da_len = 0;
+   bt_wr_len = 0;
+ }
+ if (steps == snap_step) {
+   SYNC_OUT
+   SaveSnapshot();
+ }
+ if (COMPLETION_PENDING(pc)) {
+   SYNC_OUT
+   RunCompletion(pc);
+   SYNC_IN
+ }
+ if (steps % IRQ_FREQ == IRQ_FREQ - 1) {
+   irqs_pending |= IRQ_PENDING;
+   Waiting = false;
+   SYNC_OUT
+   CheckCycleLimit();
+ }
+ if (Waiting) {
+   goto loop;
+ }
+ if (irqs_pending) {
+   if (irqs_pending & NMI_PENDING) {
+     SYNC_OUT
+     nmi();
+     SYNC_IN
+     goto loop;
+   }
+   if ((irqs_pending & IRQ_PENDING) && !(cc & CC_INHIBIT_IRQ)) {
+     SYNC_OUT
+     irq();
+     SYNC_IN
+     goto loop;
+   }
+ }
+ if (pc < 256) {
+   DiagPrintf("Executing in page 0:  %d", pc);
+   SYNC_OUT
+   finish();
+ }
+
+ ireg = mem[pc++];
+ cycles = 0;
+ if (tmode || emode) goto slow;
+ goto *fast[ireg];
+
+slow:
+ SYNC_OUT
+ if (emode && !tmode) threaded_check();
+ else (*instrtable[ireg])();
+ SYNC_IN
+ goto next;
+
+#define X(op, body) fast_##op: { body; } goto next;
+ FAST_OPS(X)
+#undef X
+}
+
+#endif /* THREADED */
+
+static char optstring[]="0FPtbdi:o:v:B:C:H:K:L:O:R:S:Z:e:f:x:T:XE";
 
 int main(int argc,char *argv[])
 {
@@ -2811,7 +3738,9 @@ int main(int argc,char *argv[])
  int zmode = 0, Fmode = 0; // Init to 0, Init to F.
  long maxsteps= 0;
  long tracetrigger= -1;
+ char* restore_name = NULL;
 
+ console_out = stdout;
  while( (c=getopt(argc, argv, optstring)) >=0 ) {
         switch(c) {
           case 'H': {
@@ -2829,6 +3758,9 @@ int main(int argc,char *argv[])
           case 'X':
                 stress_test_with_dir_command = true;
                 break;
+          case 'K':
+                ReadKeyScript(optarg);
+                break;
           case 'Z':
                 maxsteps = atoi(optarg);
                 break;
@@ -2847,6 +3779,22 @@ int main(int argc,char *argv[])
           case 'd':
                 fdump = 1;
                 break;
+          case 'b':
+                bmode = 1;
+                break;
+          case 'v':
+                SetDiag(optarg);
+                break;
+#ifdef TRACE
+          case 'B':
+                OpenBinTrace(optarg);
+                break;
+#endif
+#ifdef THREADED
+          case 'E':
+                emode = 1;
+                break;
+#endif
           case 'i':
                 swi_for_getchar = atoi(optarg);
                 break;
@@ -2854,19 +3802,59 @@ int main(int argc,char *argv[])
                 swi_for_putchar = atoi(optarg);
                 break;
           case 'f':
-                disk_fd = fopen(optarg, "r+");
-                if (!disk_fd) {
-                  fprintf(stderr,"ERROR: Cannot open file: %s\n", optarg);
+                if ('0' <= optarg[0] && optarg[0] <= '9' && optarg[1] == ':') {
+                  if (optarg[0] < '1' || optarg[0] >= '0'+NUM_DRIVES) {
+                    DiagError("ERROR: No drive %c; drives are 1-3\n", optarg[0]);
+                    exit(2);
+                  }
+                  drives[optarg[0]-'0'].name = optarg+2;
+                } else {
+                  drives[1].name = optarg;
+                }
+                break;
+          case 'P':
+                private_disks = 1;
+                break;
+          case 'O':
+                console_out = fopen(optarg, "w");
+                if (!console_out) {
+                  DiagError("ERROR: Cannot create file: %s\n", optarg);
                   exit(2);
                 }
                 break;
+          case 'e':
+                CompileRegex(&expect_re, optarg);
+                expect_set = 1;
+                exit_status = 4;  /* Until it matches. */
+                break;
+          case 'x':
+                CompileRegex(&fail_re, optarg);
+                fail_set = 1;
+                break;
+          case 'C':
+                max_cycles = strtoul(optarg, NULL, 10);
+                break;
+          case 'S': {
+                char* at = strrchr(optarg, '@');
+                if (at) {
+                  *at = 0;
+                  snap_step = atol(at+1);
+                }
+                snap_name = optarg;
+                }
+                break;
+          case 'R':
+                restore_name = optarg;
+                break;
           default:
-                fprintf(stderr,"ERROR: Unknown option\n");
+                DiagError("ERROR: Unknown option\n");
                 exit(2);
         }
  }
 
- if (zmode) {
+ if (restore_name) {
+   /* Memory comes from the snapshot. */
+ } else if (zmode) {
    /* Initialize mem to all zeros. */
    memset(mem, 0x00, sizeof mem);
  } else if (Fmode) {
@@ -2880,17 +3868,29 @@ int main(int argc,char *argv[])
    }
  }
 
- if (optind < argc) {
+ StartDiag();
+ InitPages();
+ OpenDrives();
+ if (!key_script && !stress_test_with_dir_command) {
+   StartInput();
+ }
+
+ if (restore_name) {
+   LoadSnapshot(restore_name);
+   /* -Z, -T and -S@N count from the snapshot's step. */
+   if (maxsteps) maxsteps += steps;
+   if (tracetrigger >= 0) tracetrigger += steps;
+   if (snap_step >= 0) snap_step += steps;
+ } else if (optind < argc) {
    read_image(argv[optind]);
+   pcreg=0x100;
+   sreg=0;
+   dpreg=0;
  }
  else {
-        fprintf(stderr,"ERROR: Missing image name\n");
+        DiagError("ERROR: Missing image name\n");
         exit(2);
  }
-
- pcreg=0x100;
- sreg=0;
- dpreg=0;
  iflag=0;
  /* raw disables SIGINT, brkint reenables it ...
   */
@@ -2899,9 +3899,7 @@ int main(int argc,char *argv[])
      - if not, remove brkint and isig!
    */
   system("stty -echo nl raw brkint isig");
-
-  tflags=fcntl(0,F_GETFL,0);
-  fcntl(0,F_SETFL,tflags|O_NDELAY);
+  /* No O_NDELAY: input_thread reads stdin, off the CPU's path. */
 #endif
 
 #ifdef TRACE
@@ -2909,21 +3907,29 @@ int main(int argc,char *argv[])
 #endif
  cycles_sum = 0;
  pcreg_prev = pcreg;
+ gettimeofday(&start_time, NULL);
 
- for(steps = 0; !maxsteps || steps < maxsteps; ((pcreg_prev=pcreg), steps++)){
+#ifdef THREADED
+ run_threaded(maxsteps, tracetrigger);
+#else
+ for(; !maxsteps || steps < maxsteps; ((pcreg_prev=pcreg), steps++)){
    if (steps == tracetrigger) {
      tmode = 1;
+     da_len = 0;  /* Not reset by untraced steps. */
+     bt_wr_len = 0;
+   }
+   if (steps == snap_step) {
+     SaveSnapshot();
    }
 
-   struct Completion* cp = &Os9SysCallCompletion[pcreg];
-   if (cp->f) {
-     cp->f(cp);
-     cp->f = NULL;
+   if (COMPLETION_PENDING(pcreg)) {
+     RunCompletion(pcreg);
    }
 
    if (steps % IRQ_FREQ == IRQ_FREQ - 1) {
      irqs_pending |= IRQ_PENDING;
      Waiting = false;
+     CheckCycleLimit();
    }
 
   if (Waiting) {
@@ -2943,7 +3949,7 @@ int main(int argc,char *argv[])
   }
 
   if (pcreg < 256) {
-     fprintf(stderr,"Executing in page 0:  %d", pcreg);
+     DiagPrintf("Executing in page 0:  %d", pcreg);
      finish();
   }
 
@@ -2961,7 +3967,8 @@ int main(int argc,char *argv[])
   pcreg_prev = pcreg;
 
  } /* next step */
- fprintf(stderr,"FINISHED %ld STEPS\n", steps);
+#endif
+ DiagPrintf("FINISHED %ld STEPS\n", steps);
  finish();
  return 0;
 }
@@ -2970,13 +3977,33 @@ int main(int argc,char *argv[])
 
 void finish()
 {
+ if (__atomic_exchange_n(&finishing, 1, __ATOMIC_ACQ_REL)) {
+   for (;;) pause();  /* diag_signal_thread is exiting. */
+ }
  cr();
- fprintf(stderr,"Cycles: %lu", cycles_sum);
+ if (snap_name && !snap_saved) {
+   DiagPrintf("NO SNAPSHOT %s at step %ld", snap_name, steps);
+   cr();
+   if (exit_status == 0) exit_status = 6;
+ }
+ DiagPrintf("Cycles: %lu", cycles_sum);
  cr();
+ if (bmode) {
+   struct timeval now;
+   gettimeofday(&now, NULL);
+   double secs = (now.tv_sec - start_time.tv_sec) + (now.tv_usec - start_time.tv_usec) / 1e6;
+   DiagPrintf("Steps: %ld in %.3f s, %.0f steps/s", steps, secs, steps / secs);
+   cr();
+ }
 #if defined(TERM_CONTROL) && ! defined(TRACE)
  ///////////// system("stty -raw -nl echo brkint");
- fcntl(0,F_SETFL,tflags&~O_NDELAY);
 #endif
  if (fdump) dump();
- exit(0);
+ SyncDrives();
+#ifdef TRACE
+ if (bt_file) fclose(bt_file);
+#endif
+ fflush(console_out);
+ DiagFlush();
+ exit(exit_status);
 }
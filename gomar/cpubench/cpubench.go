@@ -0,0 +1,157 @@
+//go:build main
+
+// Cpubench times gomar on small instruction mixes.  Each mix is a loop
+// body, assembled by hand into a boot image that runs it -passes times
+// 65536 and exits with HyperOp 107.  The "page2" mix is the LDY/STY/CMPD
+// traffic that CMOC code is full of; "page1" is the same shape with
+// X and SUBD, for comparison.
+//
+//	go build --tags=main,coco3,level2 -o /tmp/gomar gomar.go
+//	go run --tags=main cpubench/cpubench.go -gomar=/tmp/gomar
+package main
+
+import (
+	"flag"
+	"fmt"
+	"log"
+	"os"
+	"os/exec"
+	"path/filepath"
+	"regexp"
+	"strconv"
+	"time"
+)
+
+var Gomar = flag.String("gomar", "/tmp/gomar", "gomar binary to run")
+var Passes = flag.Int("passes", 40, "times 65536 loops per mix")
+var Runs = flag.Int("runs", 3, "runs per mix; the fastest counts")
+
+type Mix struct {
+	Name string
+	Body []byte
+}
+
+var Mixes = []Mix{
+	{"page2", []byte{
+		0x10, 0xAE, 0x44, // ldy 4,u
+		0x10, 0xAF, 0x46, // sty 6,u
+		0xEC, 0x44, // ldd 4,u
+		0x10, 0xA3, 0x46, // cmpd 6,u
+		0x10, 0x8E, 0x12, 0x34, // ldy #$1234
+		0x10, 0xAF, 0xC4, // sty ,u
+		0x10, 0x83, 0x12, 0x34, // cmpd #$1234
+		0x10, 0x9C, 0xF0, // cmpy <$f0
+		0x10, 0x27, 0x00, 0x00, // lbeq *+4
+	}},
+	{"page1", []byte{
+		0xAE, 0x44, // ldx 4,u
+		0xAF, 0x46, // stx 6,u
+		0xEC, 0x44, // ldd 4,u
+		0xA3, 0x46, // subd 6,u
+		0x8E, 0x12, 0x34, // ldx #$1234
+		0xAF, 0xC4, // stx ,u
+		0x83, 0x12, 0x34, // subd #$1234
+		0x9C, 0xF0, // cmpx <$f0
+		0x27, 0x00, // beq *+2
+	}},
+	{"alu", []byte{
+		0x8B, 0x03, // adda #3
+		0xC9, 0x01, // adcb #1
+		0xE6, 0x44, // ldb 4,u
+		0x6C, 0x45, // inc 5,u
+		0x49,       // rola
+		0x54,       // lsrb
+		0x30, 0x01, // leax 1,x
+		0x8C, 0x00, 0x00, // cmpx #0
+	}},
+}
+
+// Boot assembles body into a loop at $0100 and returns the image.
+func Boot(body []byte, passes int) []byte {
+	b := []byte{
+		0x1A, 0x50, // orcc #$50
+		0x10, 0xCE, 0x80, 0x00, // lds #$8000
+		0xCE, 0x04, 0x00, // ldu #$0400
+		0xCC, 0x00, 0x00, // ldd #0
+		0xFD, 0x03, 0xF0, // std $03f0 (inner count)
+		0xCC, byte(passes >> 8), byte(passes), // ldd #passes
+		0xFD, 0x03, 0xF2, // std $03f2 (outer count)
+	}
+	loop := len(b)
+	b = append(b, body...)
+	b = append(b,
+		0xBE, 0x03, 0xF0, // ldx $03f0
+		0x30, 0x1F, // leax -1,x
+		0xBF, 0x03, 0xF0, // stx $03f0
+	)
+	b = append(b, lbne(len(b), loop)...)
+	b = append(b,
+		0xBE, 0x03, 0xF2, // ldx $03f2
+		0x30, 0x1F, // leax -1,x
+		0xBF, 0x03, 0xF2, // stx $03f2
+	)
+	b = append(b, lbne(len(b), loop)...)
+	return append(b,
+		0xCC, 0x00, 0x00, // ldd #0
+		0x3F, 107, // HyperOp 107: exit
+	)
+}
+
+func lbne(from, to int) []byte {
+	rel := to - (from + 4)
+	return []byte{0x10, 0x26, byte(rel >> 8), byte(rel)}
+}
+
+var paceLine = regexp.MustCompile(`pace: (\d+) cycles, (\d+) steps in`)
+
+func run(boot, disk string) (cycles, steps int64, d time.Duration) {
+	cmd := exec.Command(*Gomar, "-boot", boot, "-disk", disk, "-n")
+	start := time.Now()
+	out, err := cmd.CombinedOutput()
+	d = time.Since(start)
+	if err != nil {
+		log.Fatalf("%s: %v\n%s", *Gomar, err, out)
+	}
+	m := paceLine.FindSubmatch(out)
+	if m == nil {
+		log.Fatalf("%s: no pace report in output", *Gomar)
+	}
+	cycles, _ = strconv.ParseInt(string(m[1]), 10, 64)
+	steps, _ = strconv.ParseInt(string(m[2]), 10, 64)
+	return cycles, steps, d
+}
+
+func main() {
+	flag.Parse()
+	dir, err := os.MkdirTemp("", "cpubench")
+	if err != nil {
+		log.Fatal(err)
+	}
+	defer os.RemoveAll(dir)
+
+	// A boot image needs a disk, which needs 18 sectors per track.
+	disk := filepath.Join(dir, "disk")
+	sector0 := make([]byte, 256)
+	sector0[18] = 18
+	if err := os.WriteFile(disk, sector0, 0644); err != nil {
+		log.Fatal(err)
+	}
+
+	fmt.Printf("%-8s %12s %12s %10s %10s\n", "mix", "steps", "cycles", "Minst/s", "MHz")
+	for _, mix := range Mixes {
+		boot := filepath.Join(dir, mix.Name)
+		if err := os.WriteFile(boot, Boot(mix.Body, *Passes), 0644); err != nil {
+			log.Fatal(err)
+		}
+		var best time.Duration
+		var cycles, steps int64
+		for i := 0; i < *Runs; i++ {
+			c, s, d := run(boot, disk)
+			if best == 0 || d < best {
+				best, cycles, steps = d, c, s
+			}
+		}
+		fmt.Printf("%-8s %12d %12d %10.2f %10.2f\n", mix.Name, steps, cycles,
+			float64(steps)/best.Seconds()/1e6, float64(cycles)/best.Seconds()/1e6)
+	}
+}
@@ -0,0 +1,475 @@
+//go:build main
+
+// Diffbench runs the same random 6809 code in gomar and in emu/emu.c,
+// and compares what they leave behind.
+//
+// Each case is a random straight-line sequence of instructions, chosen
+// so that it only reads and writes the scratch area $4000-$42FF and the
+// stack below $5000, after a prologue that loads random registers and
+// flags.  An epilogue pushes every register, stores S at $43FE, and
+// exits: gomar by HyperOp 107 ("nop ; brn 107"), emu.c by jumping to
+// page 0.  Then registers, scratch memory and stack ($3000-$4FFF) and
+// cycle counts are compared; cycles and steps are counted from an empty
+// case run in each core, since the two stop at different places.
+//
+// With -passes, each case body is also looped passes times 65536 in
+// both cores, and their instructions per second are reported.
+//
+//	go build --tags=main,coco1,level1 -o /tmp/gomar gomar.go
+//	(cd ../emu && make)
+//	go run --tags=main diffbench/diffbench.go -gomar=/tmp/gomar -emu=../emu/emu
+package main
+
+import (
+	"flag"
+	"fmt"
+	"log"
+	"math/rand"
+	"os"
+	"os/exec"
+	"path/filepath"
+	"regexp"
+	"strconv"
+	"time"
+)
+
+var Gomar = flag.String("gomar", "/tmp/gomar", "gomar binary to run")
+var Emu = flag.String("emu", "../emu/emu", "emu.c binary to run")
+var Cases = flag.Int("cases", 200, "random cases to compare")
+var Length = flag.Int("len", 24, "instructions per case")
+var Seed = flag.Int64("seed", 1, "random seed; case i uses seed+i")
+var Passes = flag.Int("passes", 0, "if > 0, also time each core on the first -bench cases looped this many times 65536")
+var Bench = flag.Int("bench", 4, "cases to time with -passes")
+var Verbose = flag.Bool("v", false, "list the instructions of each case")
+
+const (
+	scratch   = 0x4000 // Scratch area, $4000-$42FF.
+	counters  = 0x2FF0 // Loop counters for -passes, out of reach.
+	savedS    = 0x43FE // Where the epilogue stores S.
+	stackTop  = 0x5000
+	dumpStart = 0x3000 // Memory compared, $3000-$4FFF.
+	dumpEnd   = 0x5000
+)
+
+// Inst is one instruction, and how it was spelled.
+type Inst struct {
+	Bytes []byte
+	Say   string
+}
+
+// Gen makes random instructions that stay in the scratch area,
+// as long as X, Y and U start in $4080-$417F and the case is short.
+type Gen struct {
+	*rand.Rand
+}
+
+func (g Gen) byte() byte { return byte(g.Intn(256)) }
+func (g Gen) pick(bb []byte) byte {
+	return bb[g.Intn(len(bb))]
+}
+
+// Ops reading or writing A (add $40 for B), in all four modes:
+// sub cmp sbc and bit ld st eor adc or add.  (St has no immediate.)
+var aluOps = []byte{0x80, 0x81, 0x82, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8A, 0x8B}
+
+// Read-modify-write ops, in direct mode (add $60 for indexed,
+// $70 for extended, $40 for A, $50 for B):
+// neg com lsr ror asr asl rol dec inc tst clr.
+var rmwOps = []byte{0x00, 0x03, 0x04, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0C, 0x0D, 0x0F}
+
+// Word ops, with their immediate forms in the first column of four
+// modes: subd addd cmpx ldd std stx stu; and on pages 2 and 3,
+// cmpd cmpy sty sts cmpu cmps.
+var wordOps = [][]byte{{0x83}, {0xC3}, {0x8C}, {0xCC}, {0xCD}, {0x8F}, {0xCF},
+	{0x10, 0x83}, {0x10, 0x8C}, {0x10, 0x8F}, {0x10, 0xCF}, {0x11, 0x83}, {0x11, 0x8C}}
+
+// Inherent ops: abx daa sex mul nop.
+var inherentOps = []byte{0x3A, 0x19, 0x1D, 0x3D, 0x12}
+
+// indexed returns a postbyte and offset bytes for X, Y or U,
+// not indirect, with offsets that stay near the register.
+func (g Gen) indexed() ([]byte, string) {
+	r := g.Intn(3)
+	name := []string{"x", "y", "u"}[r]
+	rr := byte(r << 5)
+	switch g.Intn(9) {
+	case 0:
+		n := g.Intn(32)
+		return []byte{rr | byte(n)}, F("%d,%s", int8(byte(n<<3))>>3, name)
+	case 1:
+		return []byte{0x80 | rr}, F(",%s+", name)
+	case 2:
+		return []byte{0x81 | rr}, F(",%s++", name)
+	case 3:
+		return []byte{0x82 | rr}, F(",-%s", name)
+	case 4:
+		return []byte{0x83 | rr}, F(",--%s", name)
+	case 5:
+		return []byte{0x84 | rr}, F(",%s", name)
+	case 6:
+		return []byte{0x85 | rr}, F("b,%s", name)
+	case 7:
+		return []byte{0x86 | rr}, F("a,%s", name)
+	default:
+		if g.Intn(2) == 0 {
+			n := g.byte()
+			return []byte{0x88 | rr, n}, F("%d,%s", int8(n), name)
+		}
+		n := int16(int8(g.byte()))
+		return []byte{0x89 | rr, byte(n >> 8), byte(n)}, F(">%d,%s", n, name)
+	}
+}
+
+// operand returns the bytes after an opcode in mode (0 immediate,
+// 1 direct, 2 indexed, 3 extended), and the mode's offset from the
+// immediate opcode.
+func (g Gen) operand(mode int, word bool) ([]byte, byte, string) {
+	switch mode {
+	case 0:
+		if word {
+			w := g.Intn(0x10000)
+			return []byte{byte(w >> 8), byte(w)}, 0x00, F("#$%04x", w)
+		}
+		b := g.byte()
+		return []byte{b}, 0x00, F("#$%02x", b)
+	case 1:
+		b := g.byte()
+		return []byte{b}, 0x10, F("<$%02x", b)
+	case 2:
+		bb, say := g.indexed()
+		return bb, 0x20, say
+	}
+	w := scratch + g.Intn(0x300)
+	return []byte{byte(w >> 8), byte(w)}, 0x30, F("$%04x", w)
+}
+
+func (g Gen) Inst() Inst {
+	switch g.Intn(10) {
+	case 0, 1, 2: // ALU on A or B.
+		op := g.pick(aluOps)
+		if g.Intn(2) == 0 {
+			op += 0x40
+		}
+		mode := g.Intn(4)
+		if op&0x0F == 0x07 && mode == 0 {
+			mode = 1 // No store immediate.
+		}
+		bb, off, say := g.operand(mode, false)
+		return Inst{append([]byte{op + off}, bb...), F("%02x %s", op+off, say)}
+	case 3: // Read-modify-write, in memory or on A or B.
+		op := g.pick(rmwOps)
+		switch g.Intn(5) {
+		case 0:
+			return Inst{[]byte{op + 0x40}, F("%02x", op+0x40)}
+		case 1:
+			return Inst{[]byte{op + 0x50}, F("%02x", op+0x50)}
+		}
+		mode := 1 + g.Intn(3)
+		bb, _, say := g.operand(mode, false)
+		op += []byte{0, 0x00, 0x60, 0x70}[mode]
+		return Inst{append([]byte{op}, bb...), F("%02x %s", op, say)}
+	case 4, 5: // Word ops.
+		ops := wordOps[g.Intn(len(wordOps))]
+		last := ops[len(ops)-1]
+		mode := g.Intn(4)
+		if last&0x0F >= 0x0D && mode == 0 {
+			mode = 1 // No store immediate.
+		}
+		bb, off, say := g.operand(mode, true)
+		code := append(append([]byte{}, ops[:len(ops)-1]...), last+off)
+		return Inst{append(code, bb...), F("% x %s", code, say)}
+	case 6: // Inherent, lea, and register transfers.
+		switch g.Intn(4) {
+		case 0:
+			op := g.pick(inherentOps)
+			return Inst{[]byte{op}, F("%02x", op)}
+		case 1:
+			bb, say := g.indexed()
+			op := byte(0x30) + byte(g.Intn(2)) // leax, leay
+			if g.Intn(3) == 0 {
+				op = 0x33 // leau
+			}
+			return Inst{append([]byte{op}, bb...), F("%02x %s", op, say)}
+		default:
+			op := byte(0x1E) + byte(g.Intn(2))                         // exg, tfr
+			post := g.pick([]byte{0x89, 0x98, 0x12, 0x21, 0x13, 0x31}) // a,b  x,y  x,u
+			if g.Intn(4) == 0 {
+				post = g.pick([]byte{0x01, 0x02, 0x03}) // d -> x, y, u: only tfr.
+				op = 0x1F
+				post = post<<4 | post>>4 // x, y, u -> d
+			}
+			return Inst{[]byte{op, post}, F("%02x %02x", op, post)}
+		}
+	case 7: // Stack.
+		if g.Intn(2) == 0 {
+			mask := g.byte() &^ 0x80         // Not PC.
+			op := g.pick([]byte{0x34, 0x36}) // pshs, pshu
+			if op == 0x36 {
+				mask &^= 0x40 // U is not in its own set.
+			}
+			return Inst{[]byte{op, mask}, F("%02x %02x", op, mask)}
+		}
+		mask := g.byte() & 0x06          // Only a and b, so pointers stay sane.
+		op := g.pick([]byte{0x35, 0x37}) // puls, pulu
+		return Inst{[]byte{op, mask}, F("%02x %02x", op, mask)}
+	case 8: // Flags, keeping I and F set so nothing interrupts.
+		if g.Intn(2) == 0 {
+			b := g.byte() | 0x50
+			return Inst{[]byte{0x1C, b}, F("1c %02x", b)}
+		}
+		b := g.byte()
+		return Inst{[]byte{0x1A, b}, F("1a %02x", b)}
+	}
+	// A branch, short or long, over "inca ; incb".
+	cond := byte(0x20 + g.Intn(16))
+	if g.Intn(3) == 0 && cond != 0x20 && cond != 0x21 {
+		return Inst{[]byte{0x10, cond, 0x00, 0x02, 0x4C, 0x5C}, F("10 %02x +2 ; inca ; incb", cond)}
+	}
+	return Inst{[]byte{cond, 0x02, 0x4C, 0x5C}, F("%02x +2 ; inca ; incb", cond)}
+}
+
+// Case is the registers, flags, scratch memory and body of one case.
+type Case struct {
+	Seed    int64
+	CC, DP  byte
+	D       int
+	X, Y, U int
+	Memory  []byte // $4000-$42FF.
+	Body    []Inst
+}
+
+func NewCase(seed int64, n int) *Case {
+	g := Gen{rand.New(rand.NewSource(seed))}
+	c := &Case{
+		Seed:   seed,
+		CC:     g.byte() | 0x50,
+		DP:     scratch >> 8,
+		D:      g.Intn(0x10000),
+		X:      0x4080 + g.Intn(0x100),
+		Y:      0x4080 + g.Intn(0x100),
+		U:      0x4080 + g.Intn(0x100),
+		Memory: make([]byte, 0x300),
+	}
+	g.Read(c.Memory)
+	for i := 0; i < n; i++ {
+		c.Body = append(c.Body, g.Inst())
+	}
+	return c
+}
+
+// Image assembles the case at $0100, looping passes times 65536
+// if passes > 0.
+func (c *Case) Image(passes int) []byte {
+	b := []byte{
+		0x1A, 0x50, // orcc #$50
+		0x10, 0xCE, stackTop >> 8, stackTop & 0xFF, // lds #stackTop
+		0x86, c.DP, // lda #dp
+		0x1F, 0x8B, // tfr a,dp
+	}
+	if passes > 0 {
+		b = append(b,
+			0xCC, 0x00, 0x00, // ldd #0
+			0xFD, counters>>8, counters&0xFF, // std counters
+			0xCC, byte(passes>>8), byte(passes), // ldd #passes
+			0xFD, counters>>8, (counters+2)&0xFF, // std counters+2
+		)
+	}
+	loop := len(b)
+	b = append(b,
+		0x10, 0xCE, stackTop>>8, stackTop&0xFF, // lds #stackTop
+		0x8E, byte(c.X>>8), byte(c.X), // ldx #X
+		0x10, 0x8E, byte(c.Y>>8), byte(c.Y), // ldy #Y
+		0xCE, byte(c.U>>8), byte(c.U), // ldu #U
+		0x86, c.CC, // lda #cc
+		0x34, 0x02, // pshs a
+		0xCC, byte(c.D>>8), byte(c.D), // ldd #D
+		0x35, 0x01, // puls cc
+	)
+	for _, inst := range c.Body {
+		b = append(b, inst.Bytes...)
+	}
+	if passes > 0 {
+		for _, counter := range []int{counters, counters + 2} {
+			b = append(b,
+				0xBE, byte(counter>>8), byte(counter), // ldx counter
+				0x30, 0x1F, // leax -1,x
+				0xBF, byte(counter>>8), byte(counter), // stx counter
+			)
+			rel := loop - (len(b) + 4)
+			b = append(b, 0x10, 0x26, byte(rel>>8), byte(rel)) // lbne loop
+		}
+	}
+	b = append(b,
+		0x34, 0x7F, // pshs cc,a,b,dp,x,y,u
+		0x10, 0xFF, savedS>>8, savedS&0xFF, // sts savedS
+		0xCC, 0x00, 0x00, // ldd #0
+		0x12, 0x21, 107, // nop ; brn 107: gomar exits.
+		0x7E, 0x00, 0x00, // jmp $0000: emu.c exits.
+	)
+	if len(b) > scratch-0x0100 {
+		log.Fatalf("case %d is too long", c.Seed)
+	}
+	image := make([]byte, scratch-0x0100+len(c.Memory))
+	copy(image, b)
+	copy(image[scratch-0x0100:], c.Memory)
+	return image
+}
+
+// Result is what a core left behind.
+type Result struct {
+	Cycles, Steps int64
+	Time          time.Duration
+	Memory        []byte // $3000-$4FFF.
+}
+
+func (r *Result) Regs() string {
+	s := int(r.Memory[savedS-dumpStart])<<8 | int(r.Memory[savedS+1-dumpStart])
+	if s < dumpStart || s+10 > dumpEnd {
+		return F("s=%04x", s)
+	}
+	f := r.Memory[s-dumpStart : s+10-dumpStart]
+	return F("cc=%02x a=%02x b=%02x dp=%02x x=%02x%02x y=%02x%02x u=%02x%02x s=%04x",
+		f[0], f[1], f[2], f[3], f[4], f[5], f[6], f[7], f[8], f[9], s+10)
+}
+
+var gomarPace = regexp.MustCompile(`pace: (\d+) cycles, (\d+) steps in`)
+var emuCycles = regexp.MustCompile(`Cycles: (\d+)`)
+var emuSteps = regexp.MustCompile(`Steps: (\d+) in`)
+
+func number(re *regexp.Regexp, out []byte, who string) int64 {
+	m := re.FindSubmatch(out)
+	if m == nil {
+		log.Fatalf("%s: no %q in output:\n%s", who, re, out)
+	}
+	n, _ := strconv.ParseInt(string(m[1]), 10, 64)
+	return n
+}
+
+func runCore(dir string, cmd *exec.Cmd, dump string) (out []byte, r *Result) {
+	cmd.Dir = dir
+	os.Remove(dump)
+	start := time.Now()
+	out, err := cmd.CombinedOutput()
+	r = &Result{Time: time.Since(start)}
+	if err != nil {
+		log.Fatalf("%s: %v\n%s", cmd.Path, err, out)
+	}
+	bb, err := os.ReadFile(dump)
+	if err != nil || len(bb) != 0x10000 {
+		log.Fatalf("%s: no memory dump %q: %v", cmd.Path, dump, err)
+	}
+	r.Memory = bb[dumpStart:dumpEnd]
+	return out, r
+}
+
+func RunGomar(dir, image string) *Result {
+	dump := filepath.Join(dir, "gomar.ram")
+	cmd := exec.Command(*Gomar, "-boot", image, "-disk", filepath.Join(dir, "disk"), "-n", "-dump_ram", dump)
+	out, r := runCore(dir, cmd, dump)
+	m := gomarPace.FindSubmatch(out)
+	if m == nil {
+		log.Fatalf("%s: no pace report in output:\n%s", *Gomar, out)
+	}
+	r.Cycles, _ = strconv.ParseInt(string(m[1]), 10, 64)
+	r.Steps, _ = strconv.ParseInt(string(m[2]), 10, 64)
+	return r
+}
+
+func RunEmu(dir, image string) *Result {
+	cmd := exec.Command(*Emu, "-0", "-d", "-b", image)
+	out, r := runCore(dir, cmd, filepath.Join(dir, "dump.v09"))
+	r.Cycles = number(emuCycles, out, *Emu)
+	r.Steps = number(emuSteps, out, *Emu)
+	return r
+}
+
+var F = fmt.Sprintf
+
+func main() {
+	flag.Parse()
+	var err error
+	if *Gomar, err = filepath.Abs(*Gomar); err != nil {
+		log.Fatal(err)
+	}
+	if *Emu, err = filepath.Abs(*Emu); err != nil {
+		log.Fatal(err)
+	}
+	dir, err := os.MkdirTemp("", "diffbench")
+	if err != nil {
+		log.Fatal(err)
+	}
+	defer os.RemoveAll(dir)
+
+	// A boot image needs a disk, which needs 18 sectors per track.
+	sector0 := make([]byte, 256)
+	sector0[18] = 18
+	if err := os.WriteFile(filepath.Join(dir, "disk"), sector0, 0644); err != nil {
+		log.Fatal(err)
+	}
+	image := filepath.Join(dir, "image")
+	write := func(c *Case, passes int) {
+		if err := os.WriteFile(image, c.Image(passes), 0644); err != nil {
+			log.Fatal(err)
+		}
+	}
+
+	// The empty case counts the prologue and epilogue in each core.
+	write(NewCase(*Seed, 0), 0)
+	gomarBase, emuBase := RunGomar(dir, image), RunEmu(dir, image)
+
+	failed := 0
+	for i := 0; i < *Cases; i++ {
+		c := NewCase(*Seed+int64(i), *Length)
+		write(c, 0)
+		g, e := RunGomar(dir, image), RunEmu(dir, image)
+		gc, ec := g.Cycles-gomarBase.Cycles, e.Cycles-emuBase.Cycles
+		gs, es := g.Steps-gomarBase.Steps, e.Steps-emuBase.Steps
+
+		var diffs []string
+		if g.Regs() != e.Regs() {
+			diffs = append(diffs, F("gomar %s\n   emu   %s", g.Regs(), e.Regs()))
+		}
+		for a := range g.Memory {
+			if g.Memory[a] != e.Memory[a] {
+				diffs = append(diffs, F("$%04x: gomar %02x emu %02x", dumpStart+a, g.Memory[a], e.Memory[a]))
+				if len(diffs) > 8 {
+					break
+				}
+			}
+		}
+		if gc != ec || gs != es {
+			diffs = append(diffs, F("gomar %d cycles %d steps, emu %d cycles %d steps", gc, gs, ec, es))
+		}
+		if len(diffs) > 0 {
+			failed++
+		}
+		if len(diffs) > 0 || *Verbose {
+			fmt.Printf("case -seed=%d: cc=%02x d=%04x x=%04x y=%04x u=%04x\n", c.Seed, c.CC, c.D, c.X, c.Y, c.U)
+			for _, inst := range c.Body {
+				fmt.Printf("   %-20s %s\n", F("% x", inst.Bytes), inst.Say)
+			}
+			for _, d := range diffs {
+				fmt.Printf("   %s\n", d)
+			}
+		}
+	}
+	fmt.Printf("%d of %d cases differ\n", failed, *Cases)
+
+	if *Passes > 0 {
+		fmt.Printf("\n%-8s %12s %12s %12s\n", "seed", "steps", "gomar Mi/s", "emu Mi/s")
+		for i := 0; i < *Bench; i++ {
+			c := NewCase(*Seed+int64(i), *Length)
+			write(c, *Passes)
+			g, e := RunGomar(dir, image), RunEmu(dir, image)
+			if g.Steps-gomarBase.Steps != e.Steps-emuBase.Steps {
+				fmt.Printf("case -seed=%d: gomar %d steps, emu %d steps\n", c.Seed, g.Steps, e.Steps)
+			}
+			fmt.Printf("%-8d %12d %12.2f %12.2f\n", c.Seed, g.Steps,
+				float64(g.Steps)/g.Time.Seconds()/1e6, float64(e.Steps)/e.Time.Seconds()/1e6)
+		}
+	}
+
+	if failed > 0 {
+		os.Exit(1)
+	}
+}
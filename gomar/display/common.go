@@ -2,7 +2,9 @@ package display
 
 import (
 	"flag"
+	"io"
 	"sync"
+	"sync/atomic"
 )
 
 var FONT = flag.String("font", "/home/strick/go/src/golang.org/x/image/font/gofont/ttfs/Go-Mono.ttf", ".ttf font file")
@@ -38,17 +40,42 @@ type CocoDisplayParams struct {
 	ColorMap            [16]byte
 }
 
+// ParamsSlot holds the latest CocoDisplayParams.
+// The emulator Publishes without ever blocking;
+// the renderer takes the Latest at its own frame rate.
+type ParamsSlot struct {
+	v atomic.Value
+}
+
+func (s *ParamsSlot) Publish(p *CocoDisplayParams) {
+	s.v.Store(p)
+}
+
+// Latest returns nil until something is Published.
+func (s *ParamsSlot) Latest() *CocoDisplayParams {
+	p, _ := s.v.Load().(*CocoDisplayParams)
+	return p
+}
+
 type Display struct {
 	Mem     []byte
 	Rows    [][]byte
 	NumRows int
 	NumCols int
-	Cocod   <-chan *CocoDisplayParams
+	Cocod   *ParamsSlot
 	Inkey   chan<- byte
 	Sam     *Sam
 	PeekB   func(addr int) byte
 	x, y    int
 	ctrl    bool
+
+	// Used by the headless backend.
+	mu         sync.Mutex
+	raster     *Raster
+	drawn      *CocoDisplayParams
+	y4m        io.Writer
+	y4mW, y4mH int
+	snaps      int
 }
 
 type Sam struct {
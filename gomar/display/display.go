@@ -5,18 +5,15 @@ package display
 import (
 	"bytes"
 	"fmt"
-	"image"
-	"image/color"
 	"log"
 	"math"
-	"runtime"
 	"time"
 
 	"github.com/tfriedel6/canvas"
 	"github.com/tfriedel6/canvas/sdlcanvas"
 )
 
-func NewDisplay(mem []byte, numCols, numRows int, cocod <-chan *CocoDisplayParams, inkey chan<- byte, sam *Sam, peekb func(addr int) byte) *Display {
+func NewDisplay(mem []byte, numCols, numRows int, cocod *ParamsSlot, inkey chan<- byte, sam *Sam, peekb func(addr int) byte) *Display {
 	d := &Display{
 		Mem:     mem, // not used for Basic Text any more
 		Rows:    make([][]byte, numRows),
@@ -62,6 +59,12 @@ func (d *Display) PutChar(b byte) {
 	}
 }
 
+func (d *Display) Snapshot() {
+	log.Printf("Snapshot: only the headless display writes snapshots")
+}
+
+func (d *Display) Close() {}
+
 func (d *Display) Loop() {
 	var coco *CocoDisplayParams
 	var ft *canvas.Font
@@ -151,26 +154,18 @@ func (d *Display) Loop() {
 		d.PutChar(byte(rn))
 	}
 
-	var z *image.RGBA
-	var zxlen, zylen int
+	// Rows are re-rasterized only when PutB has marked them Dirty,
+	// or when the display params change.
+	raster := NewRaster(4)
+	var alphaRows []string
+	var drawn *CocoDisplayParams
 
 	wnd.MainLoop(func() {
 		var err error
 		time.Sleep(20 * time.Millisecond)
 
-	SelectLoop:
-		for {
-			select {
-			case tmp := <-d.Cocod:
-				coco = tmp
-				continue
-			default:
-				break SelectLoop
-			}
-		}
-		if coco == nil {
-			log.Printf("DISPLAY: coco: nil")
-		} else {
+		coco = d.Cocod.Latest()
+		if coco != drawn && coco != nil {
 			log.Printf("DISPLAY: coco: %#v", *coco)
 		}
 
@@ -216,84 +211,50 @@ func (d *Display) Loop() {
 		case coco.Graphics:
 			{
 				// Graphics
-				const N = 4
-				p := coco.VirtOffsetAddr
-				bpr := coco.GraphicsBytesPerRow
-				colorBits := coco.GraphicsColorBits
-
-				xlen := (8 * bpr) / colorBits
-				ylen := coco.LinesPerField
-				if z == nil || xlen != zxlen || ylen != zylen {
-					z = image.NewRGBA(image.Rect(0, 0, N*xlen, N*ylen))
-					zxlen, zylen = xlen, ylen
+				if coco != drawn {
+					Dirty.MarkAll()
 				}
+				raster.DrawGraphics(d.Mem, coco, &Dirty)
 				// For interpreting mouse position:
-				w, h = float64(N*xlen), float64(N*ylen)
-
-				shift := 8 - colorBits
-				mask := ^(byte(0xFF) << uint(colorBits))
-				for y := 0; y < coco.LinesPerField; y++ {
-					endRow := p + bpr
-					m := d.Mem[p]
-					// for x := 0; x < xlen; x++ ///
-					for x := 0; p < endRow; x++ {
-						pixel := (m >> uint(shift)) & mask
-						// log.Printf("DISPLAY: y=%x x=%x p=%x shift=%x mask=%x pixel=%x", y, x, p, shift, mask, pixel)
-						shift -= colorBits
-						if shift < 0 {
-							shift = 8 - colorBits
-							mask = ^(byte(0xFF) << uint(colorBits))
-							p++
-							m = d.Mem[p]
-						}
-						clr := coco.ColorMap[pixel]
-						r := ((clr & 0x20) >> 4) | ((clr & 0x04) >> 2)
-						g := ((clr & 0x10) >> 3) | ((clr & 0x02) >> 1)
-						b := ((clr & 0x08) >> 2) | ((clr & 0x01) >> 0)
-						// log.Printf("DISPLAY:   clr=%x r=%x g=%x b=%", clr, r, g, b)
-						colour := color.RGBA{r << 6, g << 6, b << 6, 255}
-						for j := 0; j < N; j++ {
-							for i := 0; i < N; i++ {
-								z.SetRGBA(x*N+i, y*N+j, colour)
-							}
-						}
-					}
-					if p != endRow {
-						log.Fatalf("p=%x endRow=%x len=%x,%x %x,%x,%x,%x", p, endRow, xlen, ylen, bpr, colorBits, shift, mask)
-					}
-				}
-				cv.DrawImage(z, 0, 0)
-				log.Printf("DISPLAY: Graphics DRAWN.")
+				w, h = float64(raster.Img.Bounds().Dx()), float64(raster.Img.Bounds().Dy())
+				cv.DrawImage(raster.Img, 0, 0)
 			} // end Graphics
 
 		default:
 			{
 				// Alpha
 
+				start, _, bpr := VideoWindow(coco)
 				numRows := coco.LinesPerField / coco.LinesPerCharRow
 				numCols := coco.AlphaCharsPerRow
-				p := coco.VirtOffsetAddr
 				stride := 1
 				if coco.AlphaHasAttrs {
 					stride = 2
 				}
+				if coco != drawn || len(alphaRows) != numRows {
+					alphaRows = make([]string, numRows)
+					Dirty.MarkAll()
+				}
 
 				for y := 0; y < numRows; y++ {
-					var buf bytes.Buffer
-					for x := 0; x < numCols; x++ {
-						ch := d.Mem[p]
-						p += stride
-						if ch == 127 {
-							buf.WriteByte('_')
-						} else if 32 <= ch && ch < 128 {
-							buf.WriteByte(ch)
-						} else {
-							fmt.Fprintf(&buf, "{%d}", ch)
+					if Dirty.Take(y) {
+						p := start + y*bpr
+						var buf bytes.Buffer
+						for x := 0; x < numCols; x++ {
+							ch := d.Mem[p]
+							p += stride
+							if ch == 127 {
+								buf.WriteByte('_')
+							} else if 32 <= ch && ch < 128 {
+								buf.WriteByte(ch)
+							} else {
+								fmt.Fprintf(&buf, "{%d}", ch)
+							}
 						}
+						alphaRows[y] = buf.String()
 					}
-					cv.FillText(buf.String(), 10, float64((y)*30))
+					cv.FillText(alphaRows[y], 10, float64((y)*30))
 				}
-				log.Printf("DISPLAY: Alpha DRAWN.")
 			} // end Alpha
 		} // end switch
 
@@ -308,7 +269,6 @@ func (d *Display) Loop() {
 			cv.Arc(MouseX*w, MouseY*h, 10, 0, math.Pi*2, false)
 			cv.Stroke()
 		}
-
-		runtime.GC()
+		drawn = coco
 	})
 }
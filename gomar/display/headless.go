@@ -0,0 +1,138 @@
+//go:build headless && !display
+
+package display
+
+// Headless display: renders the screen into an image with no window,
+// for scripted runs and benchmarks.  Frames may be streamed to a
+// YUV4MPEG2 file (play with mpv or ffplay, or convert with ffmpeg),
+// and HyperOp 140 writes the current screen as a PNG.
+
+import (
+	"flag"
+	"fmt"
+	"image"
+	"image/color"
+	"image/png"
+	"io"
+	"log"
+	"os"
+	"time"
+)
+
+var FlagHeadlessFps = flag.Float64("headless_fps", 10, "headless frames per second (0: render only for snapshots)")
+var FlagHeadlessScale = flag.Int("headless_scale", 1, "headless pixels per coco pixel")
+var FlagHeadlessPng = flag.String("headless_png", "/tmp/gomar.%04d.png", "headless snapshot filename pattern, given the snapshot number")
+var FlagHeadlessY4m = flag.String("headless_y4m", "", "headless: stream every frame to this .y4m file")
+
+func NewDisplay(mem []byte, numCols, numRows int, cocod *ParamsSlot, inkey chan<- byte, sam *Sam, peekb func(addr int) byte) *Display {
+	d := &Display{
+		Mem:     mem,
+		NumRows: numRows,
+		NumCols: numCols,
+		Cocod:   cocod,
+		Inkey:   inkey,
+		Sam:     sam,
+		PeekB:   peekb,
+		raster:  NewRaster(*FlagHeadlessScale),
+	}
+	if *FlagHeadlessY4m != "" {
+		f, err := os.Create(*FlagHeadlessY4m)
+		if err != nil {
+			log.Fatalf("cannot create -headless_y4m file: %v", err)
+		}
+		d.y4m = f
+	}
+	if *FlagHeadlessFps > 0 {
+		go d.Loop()
+	}
+	return d
+}
+
+// PutChar is a no-op: the headless display shows only video memory.
+func (d *Display) PutChar(b byte) {}
+
+// Close ends the -headless_y4m stream, after any frame being written.
+func (d *Display) Close() {
+	d.mu.Lock()
+	defer d.mu.Unlock()
+	if c, ok := d.y4m.(io.Closer); ok {
+		if err := c.Close(); err != nil {
+			log.Printf("cannot close -headless_y4m: %v", err)
+		}
+	}
+	d.y4m = nil
+}
+
+func (d *Display) Loop() {
+	period := time.Duration(float64(time.Second) / *FlagHeadlessFps)
+	for range time.Tick(period) {
+		d.mu.Lock()
+		img := d.render()
+		if img != nil && d.y4m != nil {
+			d.writeY4m(img)
+		}
+		d.mu.Unlock()
+	}
+}
+
+// render must be called with d.mu held.
+func (d *Display) render() *image.RGBA {
+	coco := d.Cocod.Latest()
+	if coco != nil && (d.raster.Img == nil || coco != d.drawn) {
+		Dirty.MarkAll()
+	}
+	d.drawn = coco
+	return d.raster.Render(d.Mem, coco, d.Sam, d.PeekB, &Dirty)
+}
+
+// Snapshot writes the current screen to the next -headless_png file.
+func (d *Display) Snapshot() {
+	d.mu.Lock()
+	defer d.mu.Unlock()
+	img := d.render()
+	if img == nil {
+		log.Printf("Snapshot: no screen yet")
+		return
+	}
+	filename := fmt.Sprintf(*FlagHeadlessPng, d.snaps)
+	d.snaps++
+	f, err := os.Create(filename)
+	if err != nil {
+		log.Panicf("Snapshot: %v", err)
+	}
+	defer f.Close()
+	if err := png.Encode(f, img); err != nil {
+		log.Panicf("Snapshot: cannot write %q: %v", filename, err)
+	}
+	log.Printf("Snapshot: wrote %q", filename)
+}
+
+// writeY4m appends img as a 4:4:4 frame.  A Y4M stream has one size,
+// fixed by the first frame; later frames are cropped or padded to it.
+func (d *Display) writeY4m(img *image.RGBA) {
+	if d.y4mW == 0 {
+		d.y4mW, d.y4mH = img.Bounds().Dx(), img.Bounds().Dy()
+		// The rate as a fraction, so slow rates like 0.2 fps are not F0:1.
+		rate := int(*FlagHeadlessFps*1000 + 0.5)
+		fmt.Fprintf(d.y4m, "YUV4MPEG2 W%d H%d F%d:1000 Ip A1:1 C444\n", d.y4mW, d.y4mH, rate)
+	}
+	w, h := d.y4mW, d.y4mH
+	frame := make([]byte, 6+3*w*h)
+	copy(frame, "FRAME\n")
+	yp, up, vp := frame[6:6+w*h], frame[6+w*h:6+2*w*h], frame[6+2*w*h:]
+	bounds := img.Bounds()
+	for y := 0; y < h; y++ {
+		for x := 0; x < w; x++ {
+			var c color.RGBA
+			if x < bounds.Dx() && y < bounds.Dy() {
+				c = img.RGBAAt(x, y)
+			}
+			yy, cb, cr := color.RGBToYCbCr(c.R, c.G, c.B)
+			i := y*w + x
+			yp[i], up[i], vp[i] = yy, cb, cr
+		}
+	}
+	if _, err := d.y4m.Write(frame); err != nil {
+		log.Panicf("cannot write -headless_y4m: %v", err)
+	}
+}
@@ -1,13 +1,10 @@
-//go:build !display
+//go:build !display && !headless
 
 package display
 
-func NewDisplay(mem []byte, numCols, numRows int, cocod <-chan *CocoDisplayParams, inkey chan<- byte, sam *Sam, peekb func(addr int) byte) *Display {
-	go func() {
-		for {
-			<-cocod
-		}
-	}()
+func NewDisplay(mem []byte, numCols, numRows int, cocod *ParamsSlot, inkey chan<- byte, sam *Sam, peekb func(addr int) byte) *Display {
 	return nil
 }
 func (mon *Display) PutChar(b byte) {}
+func (mon *Display) Snapshot()      {}
+func (mon *Display) Close()         {}
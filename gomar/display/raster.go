@@ -0,0 +1,341 @@
+package display
+
+import (
+	"image"
+	"image/color"
+	"sync/atomic"
+)
+
+// DirtyRows is a bitmap of screen rows (graphics lines, or alpha
+// character rows) written since the renderer last drew them.
+// The emulator Marks; the renderer Takes.
+type DirtyRows struct {
+	bits [8]uint64 // Up to 512 rows.
+}
+
+// Dirty is shared by the emulator (writes to video RAM in PutB)
+// and the renderer.
+var Dirty DirtyRows
+
+func (d *DirtyRows) Mark(row int) {
+	if row < 0 || row >= 64*len(d.bits) {
+		return
+	}
+	w := &d.bits[row>>6]
+	bit := uint64(1) << uint(row&63)
+	for {
+		old := atomic.LoadUint64(w)
+		if old&bit != 0 || atomic.CompareAndSwapUint64(w, old, old|bit) {
+			return
+		}
+	}
+}
+
+func (d *DirtyRows) MarkAll() {
+	for i := range d.bits {
+		atomic.StoreUint64(&d.bits[i], ^uint64(0))
+	}
+}
+
+// Take reports whether row was dirty, and clears it.
+func (d *DirtyRows) Take(row int) bool {
+	if row < 0 || row >= 64*len(d.bits) {
+		return false
+	}
+	w := &d.bits[row>>6]
+	bit := uint64(1) << uint(row&63)
+	for {
+		old := atomic.LoadUint64(w)
+		if old&bit == 0 || atomic.CompareAndSwapUint64(w, old, old&^bit) {
+			return old&bit != 0
+		}
+	}
+}
+
+// VideoWindow returns the physical start, length, and bytes per row
+// of the video memory that coco displays.  BasicText is drawn through
+// PeekB instead, so it has no window.
+func VideoWindow(coco *CocoDisplayParams) (start, length, bytesPerRow int) {
+	switch {
+	case coco == nil || coco.BasicText:
+		return 0, 0, 1
+	case coco.Graphics:
+		return coco.VirtOffsetAddr, coco.GraphicsBytesPerRow * coco.LinesPerField, coco.GraphicsBytesPerRow
+	default:
+		stride := 1
+		if coco.AlphaHasAttrs {
+			stride = 2
+		}
+		rows := 0
+		if coco.LinesPerCharRow > 0 {
+			rows = coco.LinesPerField / coco.LinesPerCharRow
+		}
+		bpr := stride * coco.AlphaCharsPerRow
+		if bpr == 0 {
+			return 0, 0, 1
+		}
+		return coco.VirtOffsetAddr, bpr * rows, bpr
+	}
+}
+
+// CocoColor converts a GIME palette byte (RGB mode) to color.RGBA.
+func CocoColor(clr byte) color.RGBA {
+	r := ((clr & 0x20) >> 4) | ((clr & 0x04) >> 2)
+	g := ((clr & 0x10) >> 3) | ((clr & 0x02) >> 1)
+	b := ((clr & 0x08) >> 2) | ((clr & 0x01) >> 0)
+	return color.RGBA{r << 6, g << 6, b << 6, 255}
+}
+
+// Raster keeps a scaled RGBA image of the graphics screen,
+// redrawing only rows that are dirty.
+type Raster struct {
+	Img   *image.RGBA
+	Scale int
+
+	xlen, ylen int
+	mode       byte // 'G'raphics, 'A'lpha, or 'B'asic text.
+	colorBits  int
+	colorMap   [16]byte
+	// lut expands one video byte to its 1, 2, 4, or 8 pixels.
+	lut [256][8]color.RGBA
+}
+
+func NewRaster(scale int) *Raster {
+	return &Raster{Scale: scale}
+}
+
+// resize makes Img xlen by ylen (before scaling) in the given mode,
+// and reports whether it had to, meaning every row must be redrawn.
+func (r *Raster) resize(mode byte, xlen, ylen int) bool {
+	if r.Img != nil && mode == r.mode && xlen == r.xlen && ylen == r.ylen {
+		return false
+	}
+	n := r.Scale
+	r.Img = image.NewRGBA(image.Rect(0, 0, n*xlen, n*ylen))
+	r.xlen, r.ylen, r.mode = xlen, ylen, mode
+	r.colorBits = 0 // Force buildLut on return to graphics.
+	return true
+}
+
+func (r *Raster) buildLut(colorBits int, colorMap [16]byte) {
+	var palette [16]color.RGBA
+	for i, clr := range colorMap {
+		palette[i] = CocoColor(clr)
+	}
+	perByte := 8 / colorBits
+	mask := ^(0xFF << uint(colorBits))
+	for v := 0; v < 256; v++ {
+		for i := 0; i < perByte; i++ {
+			shift := 8 - colorBits*(i+1)
+			r.lut[v][i] = palette[((v>>uint(shift))&mask)&15]
+		}
+	}
+	r.colorBits, r.colorMap = colorBits, colorMap
+}
+
+// DrawGraphics brings Img up to date with coco's graphics screen in mem.
+// If the geometry or palette changed, every row is redrawn;
+// otherwise only the rows Taken from dirty.
+func (r *Raster) DrawGraphics(mem []byte, coco *CocoDisplayParams, dirty *DirtyRows) {
+	bpr := coco.GraphicsBytesPerRow
+	colorBits := coco.GraphicsColorBits
+	if bpr == 0 || colorBits == 0 {
+		return
+	}
+	perByte := 8 / colorBits
+	xlen, ylen := bpr*perByte, coco.LinesPerField
+	n := r.Scale
+	full := r.resize('G', xlen, ylen)
+	if colorBits != r.colorBits || coco.ColorMap != r.colorMap {
+		r.buildLut(colorBits, coco.ColorMap)
+		full = true
+	}
+
+	pix := r.Img.Pix
+	stride := r.Img.Stride
+	for y := 0; y < ylen; y++ {
+		if !dirty.Take(y) && !full {
+			continue
+		}
+		p := coco.VirtOffsetAddr + y*bpr
+		if p < 0 || p+bpr > len(mem) {
+			continue
+		}
+		line := pix[n*y*stride : n*y*stride+stride]
+		q := 0
+		for _, m := range mem[p : p+bpr] {
+			px := &r.lut[m]
+			for i := 0; i < perByte; i++ {
+				c := px[i]
+				for k := 0; k < n; k++ {
+					line[q+0] = c.R
+					line[q+1] = c.G
+					line[q+2] = c.B
+					line[q+3] = c.A
+					q += 4
+				}
+			}
+		}
+		for j := 1; j < n; j++ {
+			copy(pix[(n*y+j)*stride:(n*y+j+1)*stride], line)
+		}
+	}
+}
+
+// Render brings Img up to date with whatever mode coco describes,
+// and returns it.  It returns nil if coco is nil or describes nothing.
+func (r *Raster) Render(mem []byte, coco *CocoDisplayParams, sam *Sam, peekb func(addr int) byte, dirty *DirtyRows) *image.RGBA {
+	switch {
+	case coco == nil:
+		return nil
+	case coco.BasicText:
+		r.DrawBasicText(sam, peekb)
+	case coco.Graphics:
+		if coco.GraphicsBytesPerRow == 0 || coco.GraphicsColorBits == 0 {
+			return nil
+		}
+		r.DrawGraphics(mem, coco, dirty)
+	default:
+		if coco.AlphaCharsPerRow == 0 || coco.LinesPerCharRow == 0 {
+			return nil
+		}
+		r.DrawAlpha(mem, coco, dirty)
+	}
+	return r.Img
+}
+
+// cell paints one 8-pixel-wide character cell, lines tall, at (x, y)
+// in unscaled pixels.  glyph columns are as in Font5x8.
+func (r *Raster) cell(x, y, lines int, glyph [5]byte, underline bool, fg, bg color.RGBA) {
+	n := r.Scale
+	pix, stride := r.Img.Pix, r.Img.Stride
+	for j := 0; j < lines; j++ {
+		for i := 0; i < 8; i++ {
+			c := bg
+			if 1 <= i && i <= 5 && j < 8 && glyph[i-1]&(1<<uint(j)) != 0 {
+				c = fg
+			}
+			if underline && j == lines-1 {
+				c = fg
+			}
+			for v := 0; v < n; v++ {
+				q := (n*(y+j)+v)*stride + 4*n*(x+i)
+				for u := 0; u < n; u++ {
+					pix[q+0], pix[q+1], pix[q+2], pix[q+3] = c.R, c.G, c.B, c.A
+					q += 4
+				}
+			}
+		}
+	}
+}
+
+// fillRect paints a w by h rectangle at (x, y), in unscaled pixels.
+func (r *Raster) fillRect(x, y, w, h int, c color.RGBA) {
+	n := r.Scale
+	pix, stride := r.Img.Pix, r.Img.Stride
+	for v := n * y; v < n*(y+h); v++ {
+		for q := v*stride + 4*n*x; q < v*stride+4*n*(x+w); q += 4 {
+			pix[q+0], pix[q+1], pix[q+2], pix[q+3] = c.R, c.G, c.B, c.A
+		}
+	}
+}
+
+func glyphOf(ch byte) [5]byte {
+	if ch < 32 || ch > 126 {
+		return [5]byte{0x7F, 0x41, 0x41, 0x41, 0x7F} // Box for unprintables.
+	}
+	return Font5x8[ch-32]
+}
+
+// DrawAlpha renders the GIME text screen, redrawing only dirty
+// character rows (unless the geometry or palette changed).
+// With attributes, the foreground is palette 8-15 and the background 0-7;
+// without, the GIME uses palette 12 on 13.
+func (r *Raster) DrawAlpha(mem []byte, coco *CocoDisplayParams, dirty *DirtyRows) {
+	start, _, bpr := VideoWindow(coco)
+	lines := coco.LinesPerCharRow
+	numRows := coco.LinesPerField / lines
+	numCols := coco.AlphaCharsPerRow
+	full := r.resize('A', 8*numCols, lines*numRows)
+	if coco.ColorMap != r.colorMap {
+		r.colorMap = coco.ColorMap
+		full = true
+	}
+	var palette [16]color.RGBA
+	for i, clr := range coco.ColorMap {
+		palette[i] = CocoColor(clr)
+	}
+
+	for y := 0; y < numRows; y++ {
+		if !dirty.Take(y) && !full {
+			continue
+		}
+		p := start + y*bpr
+		if p < 0 || p+bpr > len(mem) {
+			continue
+		}
+		for x := 0; x < numCols; x++ {
+			fg, bg := palette[12], palette[13]
+			underline := false
+			ch := mem[p]
+			if coco.AlphaHasAttrs {
+				a := mem[p+1]
+				fg, bg = palette[8+(a>>3)&7], palette[a&7]
+				underline = a&0x40 != 0
+				p += 2
+			} else {
+				p++
+			}
+			r.cell(8*x, lines*y, lines, glyphOf(ch&0x7F), underline, fg, bg)
+		}
+	}
+}
+
+// vdgColors are the eight VDG semigraphics colors.
+var vdgColors = [8]color.RGBA{
+	{0, 255, 0, 255},     // green
+	{255, 255, 0, 255},   // yellow
+	{0, 0, 255, 255},     // blue
+	{255, 0, 0, 255},     // red
+	{255, 255, 224, 255}, // buff
+	{0, 255, 255, 255},   // cyan
+	{255, 0, 255, 255},   // magenta
+	{255, 128, 0, 255},   // orange
+}
+
+// DrawBasicText renders the 32x16 VDG screen at SAM Fx<<9, through peekb.
+// It is not tracked by DirtyRows, so it is all redrawn every time.
+func (r *Raster) DrawBasicText(sam *Sam, peekb func(addr int) byte) {
+	const lines = 12
+	r.resize('B', 8*32, lines*16)
+	dark := color.RGBA{0, 64, 0, 255}
+	black := color.RGBA{0, 0, 0, 255}
+	startAddr := int(sam.Fx) << 9
+	for y := 0; y < 16; y++ {
+		for x := 0; x < 32; x++ {
+			b := peekb(startAddr + y*32 + x)
+			if b&0x80 != 0 {
+				// Semigraphics 4: bits 3,2 over bits 1,0.
+				c := vdgColors[(b>>4)&7]
+				for q := 0; q < 4; q++ {
+					clr := black
+					if b&(8>>uint(q)) != 0 {
+						clr = c
+					}
+					r.fillRect(8*x+4*(q&1), lines*y+lines/2*(q>>1), 4, lines/2, clr)
+				}
+				continue
+			}
+			ch := (b & 63) + 64 // 0-31 are @ to _
+			if b&32 != 0 {
+				ch = (b & 31) + 32 // 32-63 are space to ?
+			}
+			fg, bg := dark, vdgColors[0] // Normal: dark on green.
+			if b&0x40 == 0 {
+				fg, bg = vdgColors[0], dark // Inverse video.
+			}
+			r.fillRect(8*x, lines*y, 8, 2, bg)
+			r.cell(8*x, lines*y+2, lines-2, glyphOf(ch), false, fg, bg)
+		}
+	}
+}
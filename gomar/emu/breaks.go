@@ -0,0 +1,245 @@
+package emu
+
+// Breakpoints and watchpoints by physical address.  Each is one bit,
+// tested once per step (for the PC) or per PutB (for the address
+// written), so they cost nothing much and need no trace build.
+//
+// -break and -watch_mem take comma-separated places:
+//
+//	$7e123        a physical address, in hex
+//	krn+01a0      an offset in a module, by name or full id
+//	shell:_main   a symbol in a module, from -linker_maps DIR/shell.map
+//
+// Places in modules move as modules come and go, so they are found
+// again at each RTI, which ends every system call and interrupt.
+// -watch entries (module+offset:reg:message) are breakpoints that log
+// a register.  The gdb stub (gdb.go) adds its own places.
+
+import (
+	"bufio"
+	"flag"
+	"log"
+	"os"
+	"path/filepath"
+	"regexp"
+	"strconv"
+	"strings"
+)
+
+var FlagBreak = flag.String("break", "", "Log registers when the PC reaches these places: $phys,module+offset,module:symbol,...")
+var FlagWatchMem = flag.String("watch_mem", "", "Log writes to these places: $phys,module+offset,module:symbol,...")
+var FlagBreakTrace = flag.Bool("break_trace", false, "Start tracing at a -break or -watch_mem hit")
+var FlagLinkerMaps = flag.String("linker_maps", "", "dir with lwlink maps (<module>.map) for module:symbol places")
+
+var Breakpoints bool  // Some PC bits may be set.
+var Watchpoints bool  // Some write bits may be set.
+var BreakModules bool // Some places are in modules.
+
+var breakBits, watchBits [len(mem) / 64]uint64
+
+// A place is a -break, -watch_mem, or -watch location.
+type place struct {
+	Spec   string
+	Module string // Empty for a physical address.
+	Offset Word
+	Phys   []int  // Where it was last found.
+	Watch  *Watch // For -watch breakpoints.
+	Gdb    bool   // Set by the gdb stub.
+}
+
+var breakPlaces, watchPlaces []*place
+
+func InitBreaks() {
+	for _, s := range strings.Split(*FlagBreak, ",") {
+		if s != "" {
+			breakPlaces = append(breakPlaces, parsePlace(s))
+		}
+	}
+	for _, w := range Watches {
+		p := parsePlace(strings.Replace(w.Where, `"`, "", -1))
+		p.Watch = w
+		breakPlaces = append(breakPlaces, p)
+	}
+	for _, s := range strings.Split(*FlagWatchMem, ",") {
+		if s != "" {
+			watchPlaces = append(watchPlaces, parsePlace(s))
+		}
+	}
+	Breakpoints = len(breakPlaces) > 0
+	Watchpoints = len(watchPlaces) > 0
+	for _, p := range append(breakPlaces, watchPlaces...) {
+		BreakModules = BreakModules || p.Module != ""
+	}
+	ResolveBreaks()
+}
+
+func parsePlace(s string) *place {
+	p := &place{Spec: s}
+	if strings.HasPrefix(s, "$") {
+		phys, err := strconv.ParseUint(s[1:], 16, 32)
+		if err != nil || phys >= uint64(len(mem)) {
+			log.Fatalf("bad physical address in place %q", s)
+		}
+		p.Phys = []int{int(phys)}
+		return p
+	}
+	if i := strings.IndexByte(s, '+'); i > 0 {
+		offset, err := strconv.ParseUint(s[i+1:], 16, 16)
+		if err != nil {
+			log.Fatalf("bad module offset in place %q", s)
+		}
+		p.Module, p.Offset = strings.ToLower(s[:i]), Word(offset)
+		return p
+	}
+	if i := strings.IndexByte(s, ':'); i > 0 {
+		p.Module = strings.ToLower(s[:i])
+		p.Offset = linkerSymbol(p.Module, s[i+1:])
+		return p
+	}
+	log.Fatalf("place %q is not $phys, module+offset, or module:symbol", s)
+	return nil
+}
+
+var matchMapSymbol = regexp.MustCompile(`^Symbol: ([^ ]+) [(].+[)] = ([[:xdigit:]]+)`)
+
+// linkerSymbol finds symbol in the lwlink map of module.
+func linkerSymbol(module, symbol string) Word {
+	if *FlagLinkerMaps == "" {
+		log.Fatalf("place %s:%s needs -linker_maps", module, symbol)
+	}
+	filename := filepath.Join(*FlagLinkerMaps, strings.Split(module, ".")[0]+".map")
+	fd, err := os.Open(filename)
+	if err != nil {
+		log.Fatalf("cannot open linker map: %v", err)
+	}
+	defer fd.Close()
+	sc := bufio.NewScanner(fd)
+	for sc.Scan() {
+		if m := matchMapSymbol.FindStringSubmatch(sc.Text()); m != nil && m[1] == symbol {
+			x, _ := strconv.ParseUint(m[2], 16, 16)
+			return Word(x)
+		}
+	}
+	log.Fatalf("symbol %q not in %q", symbol, filename)
+	return 0
+}
+
+func setBit(bits []uint64, phys int)   { bits[phys>>6] |= 1 << uint(phys&63) }
+func clearBit(bits []uint64, phys int) { bits[phys>>6] &^= 1 << uint(phys&63) }
+
+// resolvePlaces finds places in modules again, and sets their bits.
+func resolvePlaces(places []*place, bits []uint64) {
+	for _, p := range places {
+		if p.Module == "" {
+			setBit(bits, p.Phys[0])
+			continue
+		}
+		for _, phys := range p.Phys {
+			clearBit(bits, phys)
+		}
+		p.Phys = p.Phys[:0]
+		ModuleRegions(func(r ModRegion) bool {
+			if p.Offset < r.Offset || int(p.Offset-r.Offset) >= r.Size {
+				return false
+			}
+			id := strings.ToLower(r.Id())
+			if id == p.Module || strings.Split(id, ".")[0] == p.Module {
+				p.Phys = append(p.Phys, r.Phys+int(p.Offset-r.Offset))
+			}
+			return false
+		})
+	}
+	// Set after clearing, in case places share an address.
+	for _, p := range places {
+		for _, phys := range p.Phys {
+			setBit(bits, phys)
+		}
+	}
+}
+
+// rebuildBits sets the bits of all places from scratch.
+func rebuildBits() {
+	breakBits, watchBits = [len(breakBits)]uint64{}, [len(watchBits)]uint64{}
+	ResolveBreaks()
+}
+
+// ResolveBreaks is called after each RTI, when BreakModules.
+func ResolveBreaks() {
+	resolvePlaces(breakPlaces, breakBits[:])
+	resolvePlaces(watchPlaces, watchBits[:])
+}
+
+func placesAt(places []*place, phys int) []*place {
+	var z []*place
+	for _, p := range places {
+		for _, q := range p.Phys {
+			if q == phys {
+				z = append(z, p)
+			}
+		}
+	}
+	return z
+}
+
+// BreakCheck is called before each step, when Breakpoints.
+func BreakCheck() {
+	phys := MapAddr(pcreg, true)
+	if breakBits[phys>>6]&(1<<uint(phys&63)) == 0 {
+		if GdbAttached {
+			GdbCheck(false)
+		}
+		return
+	}
+	gdbHit := false
+	for _, p := range placesAt(breakPlaces, phys) {
+		if p.Gdb {
+			gdbHit = true
+			continue
+		}
+		if w := p.Watch; w != nil {
+			var val Word
+			switch w.Register {
+			case "d":
+				val = dreg
+			case "x":
+				val = xreg
+			case "y":
+				val = yreg
+			case "u":
+				val = ureg
+			case "s":
+				val = sreg
+			}
+			log.Printf("@WATCH@ %s == %04x == %q", w.Where, val, w.Message)
+			continue
+		}
+		log.Printf("BREAK %s pc=%04x (%06x) d=%04x %s", p.Spec, pcreg, phys, dreg, Regs())
+	}
+	breakTrace()
+	if GdbAttached {
+		GdbCheck(gdbHit)
+	}
+}
+
+// WatchCheck is called by PutB, when Watchpoints.
+func WatchCheck(addr Word, phys int, old, x byte) {
+	if watchBits[phys>>6]&(1<<uint(phys&63)) == 0 {
+		return
+	}
+	module, offset := MemoryModuleOf(pcreg_prev)
+	for _, p := range placesAt(watchPlaces, phys) {
+		if p.Gdb {
+			gdbWatchHit = int(addr)
+			continue
+		}
+		log.Printf("WATCH %s %04x (%06x) <- %02x (was %02x) at pc=%04x %q+%04x", p.Spec, addr, phys, x, old, pcreg_prev, module, offset)
+	}
+	breakTrace()
+}
+
+func breakTrace() {
+	if *FlagBreakTrace {
+		*FlagTraceAfter = 1
+		SetVerbosityBits(*FlagTraceVerbosity)
+	}
+}
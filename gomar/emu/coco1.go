@@ -34,6 +34,9 @@ func B(addr Word) byte {
 	} else {
 		z = mem[addr]
 	}
+	if Heatmap {
+		HeatRead(int(addr))
+	}
 	if TraceMem {
 		L("\t\t\t\tGetB %04x -> %02x : %c %c", addr, z, H(z), T(z))
 	}
@@ -55,6 +58,12 @@ func PeekB(addr Word) byte {
 // PutB is fundamental func to set byte.  Hack register access into here.
 func PutB(addr Word, x byte) {
 	old := mem[addr]
+	if Heatmap {
+		HeatWrite(int(addr))
+	}
+	if Watchpoints {
+		WatchCheck(addr, int(addr), old, x)
+	}
 	if enableRom && 0x8000 <= addr && addr < 0xFF00 {
 		L("ROM MODE inhibits write")
 	} else {
@@ -195,6 +195,22 @@ func ExplainBits(b byte, meanings []string) string {
 	return buf.String()
 }
 
+// IsVideoRegister tells if a write to a changes CocoDisplayParams:
+// VDG mode (PIA1 port B), SAM video bits, or GIME video & palette.
+func IsVideoRegister(a Word) bool {
+	switch {
+	case 0xFF20 <= a && a < 0xFF40 && (a&3) == 2:
+		return true
+	case 0xFFC0 <= a && a <= 0xFFD3:
+		return true
+	case 0xFF98 <= a && a <= 0xFF9F:
+		return true
+	case 0xFFB0 <= a && a <= 0xFFBF:
+		return true
+	}
+	return false
+}
+
 func PutIOByte(a Word, b byte) {
 	L("io PutIOByte %x <-- %02x", a, b)
 	PutIOByteI(a, b)
@@ -203,6 +219,10 @@ func PutIOByteI(a Word, b byte) {
 	PokeB(a, b)
 	Ld("#PutIOByte: $%04x <- $%02x", a, b)
 
+	if IsVideoRegister(a) {
+		VideoParamsChanged = true
+	}
+
 	if 0xFF90 <= a && a < 0xFFC0 {
 		PutGimeIOByte(a, b)
 		return
@@ -255,6 +255,9 @@ func B(addr Word) byte {
 	} else {
 		z = PeekB(addr)
 	}
+	if Heatmap {
+		HeatRead(mapped)
+	}
 	if TraceMem {
 		L("\t\t\t\tGetB (%06x) %04x -> %02x : %c %c", mapped, addr, z, H(z), T(z))
 	}
@@ -306,6 +309,15 @@ func PutB(addr Word, x byte) {
 
 	old := mem[mapped]
 	mem[mapped] = x
+	if Heatmap {
+		HeatWrite(mapped)
+	}
+	if Watchpoints {
+		WatchCheck(addr, mapped, old, x)
+	}
+	if off := mapped - VideoLo; 0 <= off && off < VideoLen {
+		display.Dirty.Mark(off / VideoBytesPerRow)
+	}
 	if TraceMem {
 		Ld("\t\t\t\tPutB (%06x) %04x <- %02x (was %02x)", mapped, addr, x, old)
 	}
@@ -4,6 +4,8 @@
 package emu
 
 import (
+	"github.com/strickyak/doing_os9/gomar/vnet"
+
 	"fmt"
 	"log"
 	"net"
@@ -16,7 +18,8 @@ type socket struct {
 	txRing Word
 	rxRing Word
 	uconn  *net.UDPConn
-	tconn  *net.TCPConn
+	vconn  *vnet.UDPConn // instead of uconn, with --vnet
+	tconn  net.Conn
 	queue  chan []byte
 }
 
@@ -71,6 +74,10 @@ func wizReset() {
 			s.uconn.Close()
 			s.uconn = nil
 		}
+		if s.vconn != nil {
+			s.vconn.Close()
+			s.vconn = nil
+		}
 		if s.tconn != nil {
 			s.tconn.Close()
 			s.tconn = nil
@@ -78,7 +85,7 @@ func wizReset() {
 	}
 }
 
-func OpenTCP(localHostPort string, remoteHostPort string) *net.TCPConn {
+func OpenTCP(localHostPort string, remoteHostPort string) net.Conn {
 	laddy, err := net.ResolveTCPAddr("tcp", localHostPort)
 	if err != nil {
 		log.Panicf("WIZ: cannot ResolveTCPAddr: %v", err)
@@ -180,11 +187,17 @@ func wizSendUDP(sock *socket) {
 		wizMem[base+0x0e],
 		wizMem[base+0x0f],
 		wizWord(base+0x10))
-	addy, err := net.ResolveUDPAddr("udp", hostport)
-	if err != nil {
-		log.Panicf("cannot ResolveUDPAddr: %v", err)
+	var cc int
+	var err error
+	if sock.vconn != nil {
+		cc, err = sock.vconn.WriteTo(buf, wizDestAddr(base))
+	} else {
+		addy, rerr := net.ResolveUDPAddr("udp", hostport)
+		if rerr != nil {
+			log.Panicf("cannot ResolveUDPAddr: %v", rerr)
+		}
+		cc, err = sock.uconn.WriteToUDP(buf, addy)
 	}
-	cc, err := sock.uconn.WriteToUDP(buf, addy)
 	if err != nil {
 		log.Panicf("Cannot WriteToUDP: len $%x: err %v ", len(buf), err)
 	}
@@ -295,8 +308,24 @@ func wizRecvUDP(sock *socket) {
 
 	wizLog("UDP RECV socket %x", sock.k)
 	buf := make([]byte, 1500)
-	size, peer, err := sock.uconn.ReadFromUDP(buf)
-	wizLog("UDP RECV socket %x got size $%x peer %v err %v", sock.k, size, peer, err)
+	var a4 [4]byte
+	var port uint16
+	var size int
+	var err error
+	if sock.vconn != nil {
+		var peer vnet.Addr
+		size, peer, err = sock.vconn.ReadFrom(buf)
+		wizLog("UDP RECV socket %x got size $%x vnet peer %v err %v", sock.k, size, peer, err)
+		a4, port = peer.IP, peer.Port
+	} else {
+		var peer *net.UDPAddr
+		size, peer, err = sock.uconn.ReadFromUDP(buf)
+		wizLog("UDP RECV socket %x got size $%x peer %v err %v", sock.k, size, peer, err)
+		if err == nil {
+			addrPort := peer.AddrPort()
+			a4, port = addrPort.Addr().As4(), addrPort.Port()
+		}
+	}
 	if err != nil {
 		panic(err)
 	}
@@ -315,11 +344,6 @@ func wizRecvUDP(sock *socket) {
 	wizLog("UDP RECV: begin=%x end=%x gap=%x ... rxRing=%x", begin, end, gap, rxRing)
 	AssertGT(gap, Word(size+UDP_RX_HEADER_SIZE))
 
-	addrPort := peer.AddrPort()
-	port := addrPort.Port()
-	addr := addrPort.Addr()
-	a4 := addr.As4()
-
 	wizMem[rxRing+(0x7ff&(begin+0))] = a4[0]
 	wizMem[rxRing+(0x7ff&(begin+1))] = a4[1]
 	wizMem[rxRing+(0x7ff&(begin+2))] = a4[2]
@@ -359,8 +383,12 @@ func wizPutCommand(a Word, b byte) {
 				}
 			case 2: /*UDP*/
 				{
-					hostport := fmt.Sprintf(":%d", wizWord(base+0x04))
-					sock.uconn = OpenUDP(hostport)
+					if *FlagVnet {
+						sock.vconn = OpenVnetUDP(wizWord(base + 0x04))
+					} else {
+						hostport := fmt.Sprintf(":%d", wizWord(base+0x04))
+						sock.uconn = OpenUDP(hostport)
+					}
 					wizMem[3+base] = 0x22 // Status is SOCK_UDP.
 					wizLog("UDP OPEN socket %x", sock.k)
 				}
@@ -380,7 +408,11 @@ func wizPutCommand(a Word, b byte) {
 				wizMem[base+0x0F],
 				wizWord(base+0x10))
 			wizLog("TCP CONNECT socket %x local %q remote %q", sock.k, local, remote)
-			sock.tconn = OpenTCP(local, remote)
+			if *FlagVnet {
+				sock.tconn = OpenVnetTCP(wizWord(base+0x04), wizDestAddr(base))
+			} else {
+				sock.tconn = OpenTCP(local, remote)
+			}
 
 			putWizWord(base+0x22 /*tx rd*/, sock.txRing)
 			putWizWord(base+0x24 /*tx wr*/, sock.txRing)
@@ -402,6 +434,10 @@ func wizPutCommand(a Word, b byte) {
 				sock.uconn.Close()
 				sock.uconn = nil
 			}
+			if sock.vconn != nil {
+				sock.vconn.Close()
+				sock.vconn = nil
+			}
 			if sock.tconn != nil {
 				sock.tconn.Close()
 				sock.tconn = nil
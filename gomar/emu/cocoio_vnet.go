@@ -0,0 +1,73 @@
+//go:build cocoio
+
+package emu
+
+import (
+	"github.com/strickyak/doing_os9/gomar/vnet"
+
+	"flag"
+	"log"
+	"net"
+	"strings"
+)
+
+// With --vnet, the emulated Wiznet talks to an in-process vnet.Switch
+// instead of host UDP and TCP sockets.
+
+var FlagVnet = flag.Bool("vnet", false, "CocoIO uses an in-process virtual network, not host sockets")
+var FlagVnetLatency = flag.Duration("vnet_latency", 0, "vnet: default per-link latency")
+var FlagVnetLoss = flag.Float64("vnet_loss", 0, "vnet: default per-link datagram loss probability (0.0 to 1.0)")
+var FlagVnetSeed = flag.Int64("vnet_seed", 1, "vnet: random seed for loss decisions")
+var FlagVnetTftp = flag.String("vnet_tftp", "", "vnet: serve TFTP from ip:dir, e.g. 10.2.2.2:/tmp/tftpboot")
+
+// VnetSwitch is created on first use.  Other stand-in services may
+// attach to it before the guest opens its first socket.
+var VnetSwitch *vnet.Switch
+
+func Vnet() *vnet.Switch {
+	if VnetSwitch == nil {
+		VnetSwitch = vnet.NewSwitch(*FlagVnetSeed)
+		VnetSwitch.DefaultLink = vnet.Link{
+			Latency: *FlagVnetLatency,
+			Loss:    *FlagVnetLoss,
+		}
+		VnetSwitch.Verbose = V['w']
+		if *FlagVnetTftp != "" {
+			v := strings.SplitN(*FlagVnetTftp, ":", 2)
+			if len(v) != 2 {
+				log.Fatalf("--vnet_tftp wants ip:dir, got %q", *FlagVnetTftp)
+			}
+			vnet.ServeTFTP(VnetSwitch.Attach(vnet.ParseIP(v[0])), v[1])
+		}
+	}
+	return VnetSwitch
+}
+
+// VnetHost is this card's host on the switch, at its Source IP Address.
+func VnetHost() *vnet.Host {
+	return Vnet().Attach(vnet.IP{wizMem[0x0F], wizMem[0x10], wizMem[0x11], wizMem[0x12]})
+}
+
+func wizDestAddr(base Word) vnet.Addr {
+	return vnet.Addr{
+		IP:   vnet.IP{wizMem[base+0x0C], wizMem[base+0x0D], wizMem[base+0x0E], wizMem[base+0x0F]},
+		Port: uint16(wizWord(base + 0x10)),
+	}
+}
+
+func OpenVnetUDP(port Word) *vnet.UDPConn {
+	conn, err := VnetHost().ListenUDP(uint16(port))
+	if err != nil {
+		log.Panicf("WIZ: cannot vnet ListenUDP: %v", err)
+	}
+	return conn
+}
+
+func OpenVnetTCP(localPort Word, remote vnet.Addr) net.Conn {
+	conn, err := VnetHost().DialTCP(uint16(localPort), remote)
+	if err != nil {
+		log.Panicf("WIZ: cannot vnet DialTCP to %v: %v", remote, err)
+	}
+	wizLog("OpenVnetTcp: success: %v", remote)
+	return conn
+}
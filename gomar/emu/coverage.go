@@ -0,0 +1,148 @@
+package emu
+
+// Code coverage by physical address.  With -cover=DIR, every step
+// sets a bit for the physical address of its opcode.  At exit the bits
+// are mapped back to the modules in memory (see ModuleRegions), and
+// for each module with a -borges listing (like the ones cmocly writes)
+// DIR/<module>.info gets an lcov record per source file, with a DA
+// line for every listed instruction.  Modules no longer in memory at
+// exit are not reported.
+
+import (
+	"bufio"
+	"flag"
+	"fmt"
+	"log"
+	"os"
+	"path/filepath"
+	"sort"
+	"strings"
+
+	"github.com/strickyak/doing_os9/gomar/listings"
+)
+
+var FlagCover = flag.String("cover", "", "Write lcov coverage of modules with -borges listings into this dir")
+
+var Coverage bool // Coverage bits are being set.
+
+var coverBits [len(mem) / 64]uint64
+
+// A ModRegion is a physically contiguous piece of a module in memory.
+type ModRegion struct {
+	Id     func() string // Computed on demand; it reads the module.
+	Offset Word          // Of Phys, in the module.
+	Phys   int
+	Size   int
+}
+
+func InitCoverage() {
+	Coverage = *FlagCover != ""
+	if Coverage {
+		if err := os.MkdirAll(*FlagCover, 0755); err != nil {
+			log.Fatalf("cannot create -cover dir: %v", err)
+		}
+	}
+}
+
+// CoverMark notes an instruction at physical address phys.
+func CoverMark(phys int) {
+	if phys < len(mem) {
+		coverBits[phys>>6] |= 1 << uint(phys&63)
+	}
+}
+
+func covered(phys int) bool {
+	return phys < len(mem) && coverBits[phys>>6]&(1<<uint(phys&63)) != 0
+}
+
+// WriteCoverage writes the -cover lcov files.
+func WriteCoverage() {
+	if !Coverage {
+		return
+	}
+	// Offsets covered in each module; a module may be in memory twice.
+	hits := make(map[string]map[uint]bool)
+	ModuleRegions(func(r ModRegion) bool {
+		var offsets map[uint]bool
+		for i := 0; i < r.Size; i++ {
+			if covered(r.Phys + i) {
+				if offsets == nil {
+					id := strings.ToLower(r.Id())
+					if hits[id] == nil {
+						hits[id] = make(map[uint]bool)
+					}
+					offsets = hits[id]
+				}
+				offsets[uint(r.Offset)+uint(i)] = true
+			}
+		}
+		return false
+	})
+
+	var ids []string
+	for id := range hits {
+		ids = append(ids, id)
+	}
+	sort.Strings(ids)
+	for _, id := range ids {
+		if *listings.Borges == "" {
+			log.Printf("cover: %s: %d instructions", id, len(hits[id]))
+			continue
+		}
+		src := listings.Load(id)
+		if src.Err != nil {
+			log.Printf("cover: %s: %d instructions, no listing", id, len(hits[id]))
+			continue
+		}
+		writeLcov(id, src, hits[id])
+	}
+}
+
+func writeLcov(id string, src *listings.ModSrc, offsets map[uint]bool) {
+	// lines[file][line] is true if any instruction on it ran.
+	lines := make(map[string]map[int]bool)
+	for offset, where := range src.Lines {
+		if lines[where.File] == nil {
+			lines[where.File] = make(map[int]bool)
+		}
+		lines[where.File][where.Line] = lines[where.File][where.Line] || offsets[offset]
+	}
+
+	filename := filepath.Join(*FlagCover, id+".info")
+	f, err := os.Create(filename)
+	if err != nil {
+		log.Panicf("cannot create coverage file: %v", err)
+	}
+	w := bufio.NewWriter(f)
+	var files []string
+	for file := range lines {
+		files = append(files, file)
+	}
+	sort.Strings(files)
+	found, hit := 0, 0
+	for _, file := range files {
+		var nums []int
+		for n := range lines[file] {
+			nums = append(nums, n)
+		}
+		sort.Ints(nums)
+		fmt.Fprintf(w, "TN:%s\nSF:%s\n", strings.Split(id, ".")[0], file)
+		lh := 0
+		for _, n := range nums {
+			count := 0
+			if lines[file][n] {
+				count = 1
+				lh++
+			}
+			fmt.Fprintf(w, "DA:%d,%d\n", n, count)
+		}
+		fmt.Fprintf(w, "LH:%d\nLF:%d\nend_of_record\n", lh, len(nums))
+		found += len(nums)
+		hit += lh
+	}
+	if err := w.Flush(); err != nil {
+		log.Panicf("cannot write coverage file: %v", err)
+	}
+	f.Close()
+	log.Printf("cover: %s: %d of %d lines -> %q", id, hit, found, filename)
+}
@@ -2,6 +2,8 @@ package emu
 
 // See credits.go
 
+//go:generate go run --tags=main opgen/opgen.go
+
 import (
 	"github.com/strickyak/doing_os9/gomar/display"
 	"github.com/strickyak/doing_os9/gomar/sym"
@@ -32,6 +34,7 @@ var FlagMaxSteps = flag.Uint64("max", 0, "")
 var FlagClock = flag.Uint64("clock", 5*1000*1000, "")
 var FlagBasicText = flag.Bool("basic_text", false, "")
 var FlagUserResetVector = flag.Bool("use_reset_vector", false, "")
+var FlagDumpRam = flag.String("dump_ram", "", "At exit, write the 64K logical address space to this file (like emu.c's dump.v09)")
 
 var FlagWatch = flag.String("watch", "", "Sequence of module:addr:reg:message,...")
 var FlagTriggerPc = flag.Uint64("trigger_pc", 0xC00D, "")
@@ -87,23 +90,11 @@ func Z(w *bytes.Buffer, format string, args ...interface{}) {
 
 type Word uint16
 
-// EA is Effective Address, which may be a Word or a special value for a register.
+// EA is an Effective Address in memory, as traced.  It is wider than
+// a Word so the trace can mark "no address".  Register operands never
+// have an EA: the handlers in ops_gen.go access them directly.
 type EA uint32
 
-// 16 bit (0x08 bit clear)
-const DRegEA EA = 0x10000000
-const XRegEA EA = 0x10000001
-const YRegEA EA = 0x10000002
-const URegEA EA = 0x10000003
-const SRegEA EA = 0x10000004
-const PCRegEA EA = 0x10000005
-
-// 8 bit (0x08 bit set)
-const ARegEA EA = 0x10000008
-const BRegEA EA = 0x10000009
-const CCRegEA EA = 0x1000000A
-const DPRegEA EA = 0x1000000B
-
 var SymbolLine = regexp.MustCompile(`^Symbol: _(.*) = ([0-9A-F]+)`)
 
 type LinkerRec struct {
@@ -159,13 +150,12 @@ func CoreDump(filename string) {
 		w.WriteByte(B(Word(i)))
 		// w.WriteByte(EA(i).GetB())
 	}
-	for i := DRegEA; i <= PCRegEA; i++ {
-		word := EA(i).GetW()
+	for _, word := range []Word{dreg, xreg, yreg, ureg, sreg, pcreg} {
 		w.WriteByte(byte(word >> 8))
 		w.WriteByte(byte(word >> 0))
 	}
-	w.WriteByte(CCRegEA.GetB())
-	w.WriteByte(DPRegEA.GetB())
+	w.WriteByte(CC())
+	w.WriteByte(dpreg)
 	w.Flush()
 	fd.Close()
 }
@@ -178,24 +168,23 @@ func FatalCoreDump() {
 
 	fmt.Printf(" ... Wrote %q ... Begin Frame Chain\n", NAME)
 
-	fp := EA(URegEA.GetW())
+	fp := ureg
 	codeOffset := (int(fp)/0x2000)*0x2000 + 0x2000
-	p := EA(SRegEA.GetW())
+	p := sreg
 	fmt.Printf("S: $%04x  U: $%04x\n", p, fp)
 	gap := int(fp) - int(p)
 	firstGap := true
 	for 0 <= gap && gap <= 64 {
 		fmt.Printf("\n@$%04x: ", int(p))
 		for p < fp {
-			fmt.Printf("%02x ", EA(p).GetB())
+			fmt.Printf("%02x ", MemB(p))
 			p += 1
 		}
 
 		if false && firstGap {
 			firstGap = false
 		} else if LinkerMap != nil {
-			fp2 := EA(fp + 2)
-			pc := fp2.GetW()
+			pc := MemW(fp + 2)
 
 			found := sort.Search(len(LinkerMap), func(i int) bool {
 				return (codeOffset+LinkerMap[i].Addr > int(pc))
@@ -212,7 +201,7 @@ func FatalCoreDump() {
 			}
 		}
 
-		fp = EA(fp.GetW())
+		fp = MemW(fp)
 		gap = int(fp) - int(p)
 	}
 	fmt.Printf("\nEnd Frame Chain\n")
@@ -220,14 +209,50 @@ func FatalCoreDump() {
 	log.Fatalf("EMULATOR CORE DUMPED: %q", NAME)
 }
 
-func TfrReg(b byte) EA {
-	if 6 == b || b == 7 || b > 11 {
-		log.Panicf("Bad TfrReg byte: 0x%x", b)
+// TFR and EXG register numbers: 0-5 are D X Y U S PC, 8-11 are A B CC DP.
+var tfrRegW = [6]*Word{&dreg, &xreg, &yreg, &ureg, &sreg, &pcreg}
+
+func tfrCheck(n byte) {
+	if 6 == n || n == 7 || n > 11 {
+		log.Panicf("Bad TfrReg byte: 0x%x", n)
+	}
+}
+
+func tfrGetB(n byte) byte {
+	switch n {
+	case 8:
+		return GetAReg()
+	case 9:
+		return GetBReg()
+	case 10:
+		return CC()
+	default:
+		return dpreg
+	}
+}
+
+func tfrPutB(n byte, x byte) {
+	switch n {
+	case 8:
+		PutAReg(x)
+	case 9:
+		PutBReg(x)
+	case 10:
+		SetCC(x)
+	default:
+		dpreg = x
 	}
-	return DRegEA + EA(b)
 }
 
-var CocodChan chan *display.CocoDisplayParams
+// CocodSlot carries display params to the renderer.
+// VideoParamsChanged is set by writes to GIME/VDG/SAM video registers,
+// and cleared when fresh params are published.
+var CocodSlot display.ParamsSlot
+var VideoParamsChanged = true
+
+// Physical video memory window of the published params.
+// PutB marks display.Dirty rows for writes inside it.
+var VideoLo, VideoLen, VideoBytesPerRow int = 0, 0, 1
 var Disp *display.Display
 
 var fdump int
@@ -241,8 +266,7 @@ var ccreg, dpreg byte
 var xreg, yreg, ureg, sreg, pcreg Word
 var dreg Word
 
-var iflag byte /* flag to indicate prebyte $10 or $11 */
-var ireg byte  /* Instruction register */
+var ireg byte /* Instruction register */
 var pcreg_prev Word
 
 var mem [0x40 * 0x2000]byte
@@ -266,6 +290,10 @@ var irqs_pending byte
 
 var instructionTable []func()
 
+// Pages 2 and 3, after the $10 and $11 prebytes.  Opcodes the 6809
+// does not define there run as on page 1.
+var page2Table, page3Table [256]func()
+
 // For using page 0 for system variables.
 func SysMemW(a Word) Word {
 	/*
@@ -326,6 +354,9 @@ func SignExtend(a byte) Word {
 
 // W is fundamental func to get Word.
 func W(addr Word) Word {
+	if Heatmap {
+		HeatWord(addr)
+	}
 	hi := B(addr)
 	lo := B(addr + 1)
 	return HiLo(hi, lo)
@@ -339,91 +370,35 @@ func PeekW(addr Word) Word {
 
 // PutW is fundamental func to set Word.
 func PutW(addr, x Word) {
+	if Heatmap {
+		HeatWord(addr)
+	}
 	PutB(addr, Hi(x))
 	PutB(addr+1, Lo(x))
 }
 
-func (addr EA) GetB() byte {
-	if (addr & 0xFFFF0000) != 0 {
-		switch addr {
-		case ARegEA:
-			return GetAReg()
-		case BRegEA:
-			return GetBReg()
-		case CCRegEA:
-			return ccreg
-		case DPRegEA:
-			return dpreg
-		default:
-			log.Panicf("bad B_ea EA: 0x%x", addr)
-			return 0
-		}
-	} else {
-		x := B(Word(addr))
-		TraceByte(addr, x)
-		return x
-	}
+// MemB, MemPutB, MemW, and MemPutW access operands in memory,
+// noting them for the trace.
+func MemB(addr Word) byte {
+	x := B(addr)
+	TraceByte(EA(addr), x)
+	return x
 }
 
-func (addr EA) PutB(x byte) {
-	if (addr & 0xFFFF0000) != 0 {
-		switch addr {
-		case ARegEA:
-			PutAReg(x)
-		case BRegEA:
-			PutBReg(x)
-		case CCRegEA:
-			ccreg = x
-		case DPRegEA:
-			dpreg = x
-		default:
-			log.Panicf("bad PutB_ea EA: 0x%x", addr)
-		}
-	} else {
-		TraceByte(addr, x)
-		PutB(Word(addr), x)
-	}
-}
-
-func (addr EA) RegPtrW() *Word {
-	switch addr {
-	case DRegEA:
-		return &dreg
-	case XRegEA:
-		return &xreg
-	case YRegEA:
-		return &yreg
-	case URegEA:
-		return &ureg
-	case SRegEA:
-		return &sreg
-	case PCRegEA:
-		return &pcreg
-	default:
-		log.Panicf("Unknown RegPtr EA: 0x%x", addr)
-		return nil
-	}
+func MemPutB(addr Word, x byte) {
+	TraceByte(EA(addr), x)
+	PutB(addr, x)
 }
 
-func (addr EA) GetW() Word {
-	if (addr & 0xFFFF0000) != 0 {
-		p := addr.RegPtrW()
-		return *p
-	} else {
-		x := W(Word(addr))
-		TraceWord(addr, x)
-		return x
-	}
+func MemW(addr Word) Word {
+	x := W(addr)
+	TraceWord(EA(addr), x)
+	return x
 }
 
-func (addr EA) PutW(x Word) {
-	if (addr & 0xFFFF0000) != 0 {
-		p := addr.RegPtrW()
-		*p = x
-	} else {
-		TraceWord(addr, x)
-		PutW(Word(addr), x)
-	}
+func MemPutW(addr Word, x Word) {
+	TraceWord(EA(addr), x)
+	PutW(addr, x)
 }
 
 func ImmByte() byte {
@@ -1117,7 +1092,7 @@ func ModuleName(module_loc Word) string {
 func Regs() string {
 	var buf bytes.Buffer
 	Z(&buf, "a=%02x b=%02x x=%04x:%04x y=%04x:%04x u=%04x:%04x s=%04x:%04x,%04x cc=%s dp=%02x #%d",
-		GetAReg(), GetBReg(), xreg, PeekW(xreg), yreg, PeekW(yreg), ureg, PeekW(ureg), sreg, PeekW(sreg), PeekW(sreg+2), ccbits(ccreg), dpreg, Steps)
+		GetAReg(), GetBReg(), xreg, PeekW(xreg), yreg, PeekW(yreg), ureg, PeekW(ureg), sreg, PeekW(sreg), PeekW(sreg+2), ccbits(CC()), dpreg, Steps)
 	return buf.String()
 }
 
@@ -1356,6 +1331,7 @@ func DecodeOs9Opcode(b byte) (string, bool) {
 		path := GetAReg()
 		if nando || IsTermPath(path) {
 			p = PrintableMemory(xreg, yreg)
+			TapOutput(p)
 			if nando {
 				fmt.Printf("[%q]", p)
 			} else {
@@ -1372,6 +1348,7 @@ func DecodeOs9Opcode(b byte) (string, bool) {
 			path := GetAReg()
 			if nando || IsTermPath(path) {
 				str := PrintableStringThruEOS(xreg, yreg)
+				TapOutput(str)
 				if nando {
 					fmt.Printf("%q", str)
 				} else {
@@ -1416,6 +1393,10 @@ const KB_CTRL = `.................................|.~...^[]..{_}\........`
 
 func keypress(probe byte, ch byte) byte {
 	shifted, controlled := false, false
+	if 0 < ch && ch < 32 && ch != '\r' && ch != 033 {
+		ch += 64 // Control letter: press the letter with CTRL.
+		controlled = true
+	}
 	sense := byte(0)
 	probe = ^probe
 	for j := uint(0); j < 8; j++ {
@@ -1460,7 +1441,7 @@ func interrupt(vector_addr Word) {
 		PushByte(dpreg)
 		PushWord(dreg)
 	}
-	PushByte(ccreg)
+	PushByte(CC())
 	if vector_addr == VECTOR_FIRQ {
 		// Fast IRQ.
 		ccreg &= ^byte(CC_ENTIRE)
@@ -1471,6 +1452,9 @@ func interrupt(vector_addr Word) {
 	// All IRQs.
 	ccreg |= (CC_INHIBIT_FIRQ | CC_INHIBIT_IRQ)
 	pcreg = W(vector_addr)
+	if ProcTracing {
+		ProcInterrupt(vector_addr)
+	}
 }
 
 var prev_disk_command byte
@@ -1586,61 +1570,61 @@ func T(ch byte) byte {
 
 // Now follow the posbyte addressing modes. //
 
-func illaddr() EA { // illegal addressing mode, defaults to zero //
+func illaddr() Word { // illegal addressing mode, defaults to zero //
 	log.Panicf("Illegal Addressing Mode")
 	panic(0)
 }
 
 var dixreg = []string{"x", "y", "u", "s"}
 
-func ainc() EA {
+func ainc() Word {
 	Dis_ops(",", dixreg[idx], 2)
 	Dis_ops("+", "", 0)
 	regPtr := ixregs[idx]
 	z := *regPtr
 	(*regPtr)++
-	return EA(z)
+	return z
 }
 
-func ainc2() EA {
+func ainc2() Word {
 	Dis_ops(",", dixreg[idx], 3)
 	Dis_ops("++", "", 0)
 	regPtr := ixregs[idx]
 	z := *regPtr
 	(*regPtr) += 2
-	return EA(z)
+	return z
 }
 
-func adec() EA {
+func adec() Word {
 	Dis_ops(",-", dixreg[idx], 2)
 	regPtr := ixregs[idx]
 	(*regPtr)--
-	return EA(*regPtr)
+	return *regPtr
 }
 
-func adec2() EA {
+func adec2() Word {
 	Dis_ops(",--", dixreg[idx], 3)
 	regPtr := ixregs[idx]
 	(*regPtr) -= 2
-	return EA(*regPtr)
+	return *regPtr
 }
 
-func plus0() EA {
+func plus0() Word {
 	Dis_ops(",", dixreg[idx], 0)
-	return EA(*ixregs[idx])
+	return *ixregs[idx]
 }
 
-func plusa() EA {
+func plusa() Word {
 	Dis_ops("a,", dixreg[idx], 1)
-	return EA((*ixregs[idx]) + SignExtend(GetAReg()))
+	return *ixregs[idx] + SignExtend(GetAReg())
 }
 
-func plusb() EA {
+func plusb() Word {
 	Dis_ops("b,", dixreg[idx], 1)
-	return EA((*ixregs[idx]) + SignExtend(GetBReg()))
+	return *ixregs[idx] + SignExtend(GetBReg())
 }
 
-func plusn() EA {
+func plusn() Word {
 	off := ""
 	b := ImmByte()
 	/* negative offsets alway decimal, otherwise hex */
@@ -1650,73 +1634,76 @@ func plusn() EA {
 		off = F("$%02x,", b)
 	}
 	Dis_ops(off, dixreg[idx], 1)
-	return EA((*ixregs[idx]) + SignExtend(b))
+	return *ixregs[idx] + SignExtend(b)
 }
 
-func plusnn() EA {
+func plusnn() Word {
 	w := ImmWord()
 	off := F("$%04x,", w)
 	Dis_ops(off, dixreg[idx], 4)
-	return EA(*ixregs[idx] + w)
+	return *ixregs[idx] + w
 }
 
-func plusd() EA {
+func plusd() Word {
 	Dis_ops("d,", dixreg[idx], 4)
-	return EA(*ixregs[idx] + dreg)
+	return *ixregs[idx] + dreg
 }
 
-func npcr() EA {
+func npcr() Word {
 	b := ImmByte()
 	off := F("$%04x,pcr", (pcreg+SignExtend(b))&0xffff)
 	Dis_ops(off, "", 1)
-	return EA(pcreg + SignExtend(b))
+	return pcreg + SignExtend(b)
 }
 
-func nnpcr() EA {
+func nnpcr() Word {
 	w := ImmWord()
 	off := F("$%04x,pcr", (pcreg+w)&0xffff)
 	Dis_ops(off, "", 5)
-	return EA(pcreg + w)
+	return pcreg + w
 }
 
-func direct() EA {
+func direct() Word {
 	w := ImmWord()
 	off := F("$%04x", w)
 	Dis_ops(off, "", 3)
-	return EA(w)
+	return w
 }
 
-func zeropage() EA {
+func zeropage() Word {
 	b := ImmByte()
 	off := F("$%02x", b)
 	Dis_ops(off, "", 2)
-	return EA(HiLo(dpreg, b))
+	return HiLo(dpreg, b)
 }
 
-func immediate() EA {
+func immediate() Word {
 	off := F("#$%02x", B(pcreg))
 	Dis_ops(off, "", 0)
 	z := pcreg
 	pcreg++
-	return EA(z)
+	return z
 }
 
-func immediate2() EA {
+func immediate2() Word {
 	z := pcreg
 	off := F("#$%04x", (Word(B(pcreg))<<8)|Word(B(pcreg+1)))
 	Dis_ops(off, "", 0)
 	pcreg += 2
-	return EA(z)
+	return z
 }
 
-var pbtable = []func() EA{
+var pbtable = []func() Word{
 	ainc, ainc2, adec, adec2,
 	plus0, plusb, plusa, illaddr,
 	plusn, plusnn, illaddr, plusd,
 	npcr, nnpcr, illaddr, direct}
 
-func postbyte() EA {
+func postbyte() Word {
 	pb := ImmByte()
+	if Stats {
+		statPostbyte[pb]++
+	}
 	idx = ((pb & 0x60) >> 5)
 	if (pb & 0x80) != 0 {
 		if (pb & 0x10) != 0 {
@@ -1724,10 +1711,10 @@ func postbyte() EA {
 		}
 		temp := (pbtable[pb&0x0f])()
 		if (pb & 0x10) != 0 {
-			temp = EA(temp.GetW())
+			temp = MemW(temp)
 			Dis_ops("]", "", 0)
 		}
-		return EA(temp)
+		return temp
 	} else {
 		temp := Word(pb & 0x1f)
 		if (temp & 0x10) != 0 {
@@ -1742,124 +1729,121 @@ func postbyte() EA {
 			off = F("%d,", temp)
 		}
 		Dis_ops(off, dixreg[idx], 1)
-		return EA(*ixregs[idx] + temp)
+		return *ixregs[idx] + temp
 	}
 }
 
-func eaddr0() EA { // effective address for NEG..JMP //
-	switch (ireg & 0x70) >> 4 {
-	case 0:
-		return zeropage()
-	case 1, 2, 3: //canthappen//
-		log.Panicf("UNKNOWN eaddr0: %02x\n", ireg)
-		return 0
-	case 4:
-		Dis_inst_cat("a", -2)
-		return ARegEA
-	case 5:
-		Dis_inst_cat("b", -2)
-		return BRegEA
-	case 6:
-		Dis_inst_cat("", 2)
-		return postbyte()
-	case 7:
-		return direct()
-	}
-	panic("notreached")
-}
-
-func eaddr8() EA { // effective address for 8-bits ops. //
-	switch (ireg & 0x30) >> 4 {
-	case 0:
-		return immediate()
-	case 1:
-		return zeropage()
-	case 2:
-		Dis_inst_cat("", 2)
-		return postbyte()
-	case 3:
-		return direct()
-	}
-	panic("notreached")
-}
-
-func eaddr16() EA { // effective address for 16-bits ops. //
-	switch (ireg & 0x30) >> 4 {
-	case 0:
-		Dis_inst_cat("", -1)
-		return immediate2()
-	case 1:
-		Dis_inst_cat("", -1)
-		return zeropage()
-	case 2:
-		Dis_inst_cat("", 1)
-		return postbyte()
-	case 3:
-		Dis_inst_cat("", -1)
-		return direct()
-	}
-	panic("notreached")
-}
-
 func ill() {
 	log.Panicf("Illegal Opcode: 0x%x", ireg)
 }
 
-// macros to set status flags //
-func SEC() { ccreg |= 0x01 }
-func CLC() { ccreg &= 0xfe }
-func SEZ() { ccreg |= 0x04 }
-func CLZ() { ccreg &= 0xfb }
-func SEN() { ccreg |= 0x08 }
-func CLN() { ccreg &= 0xf7 }
-func SEV() { ccreg |= 0x02 }
-func CLV() { ccreg &= 0xfd }
-func SEH() { ccreg |= 0x20 }
-func CLH() { ccreg &= 0xdf }
+// Condition codes are computed lazily.  ALU handlers record their
+// result (for N and Z) and operands (for H, V and C) in two slots,
+// and the bits are folded into ccreg only when something needs them:
+// a branch, an instruction using the carry, a push, TFR or EXG of CC,
+// an interrupt, or a trace.  Read CC with CC(), write it with SetCC().
+// The NZ slot and the HVC slot are independent, so setting N and Z
+// leaves an earlier add's H, V and C lazy.  But SE*/CL* of H, V or C
+// must flush the HVC slot first (through Carry), so "SETNZ8(r); CLV()"
+// does compute the earlier add's carry.
 
-// set N and Z flags depending on 8 or 16 bit result //
-func SETNZ8(b byte) {
-	if b != 0 {
-		CLZ()
+const (
+	lazyNone = iota
+	lazy8    // 8-bit result or operation
+	lazy16   // 16-bit result or operation
+)
+
+var nzLazy byte // lazyNone, lazy8, or lazy16.
+var nzRes Word
+
+var hvcLazy byte // lazy8: H, V, C as SETSTATUS; lazy16: V, C as SETSTATUSD.
+var hvcA, hvcB, hvcRes uint32
+
+func flushNZ() {
+	var z, n byte
+	if nzLazy == lazy8 {
+		z = byte(nzRes) // Only the low byte counts.
+		n = byte(nzRes) >> 4 & 0x08
 	} else {
-		SEZ()
+		z = byte(nzRes) | byte(nzRes>>8)
+		n = byte(nzRes>>12) & 0x08
 	}
-	if (b & 0x80) != 0 {
-		SEN()
-	} else {
-		CLN()
+	if z == 0 {
+		n |= 0x04
 	}
+	ccreg = (ccreg &^ 0x0C) | n
+	nzLazy = lazyNone
 }
-func SETNZ16(b Word) {
-	if b != 0 {
-		CLZ()
-	} else {
-		SEZ()
-	}
-	if (b & 0x8000) != 0 {
-		SEN()
+
+func flushHVC() {
+	a, b, res := hvcA, hvcB, hvcRes
+	if hvcLazy == lazy8 {
+		h := byte((a^b^res)&0x10) << 1
+		v := byte((a^b^res^(res>>1))&0x80) >> 6
+		c := byte(res>>8) & 0x01
+		ccreg = (ccreg &^ 0x23) | h | v | c
 	} else {
-		CLN()
+		v := byte((((res >> 1) ^ a ^ b ^ res) & 0x8000) >> 14)
+		c := byte(res>>16) & 0x01
+		ccreg = (ccreg &^ 0x03) | v | c
 	}
+	hvcLazy = lazyNone
 }
 
-func SETSTATUS(a byte, b byte, res Word) {
-	if ((a ^ b ^ byte(res)) & 0x10) != 0 {
-		SEH()
-	} else {
-		CLH()
+// CC returns the condition codes, folding in any lazy flags.
+func CC() byte {
+	if nzLazy != lazyNone {
+		flushNZ()
 	}
-	if ((a ^ b ^ byte(res) ^ byte(res>>1)) & 0x80) != 0 {
-		SEV()
-	} else {
-		CLV()
+	if hvcLazy != lazyNone {
+		flushHVC()
 	}
-	if (res & 0x100) != 0 {
-		SEC()
-	} else {
-		CLC()
+	return ccreg
+}
+
+// SetCC overwrites all the condition codes, dropping lazy flags.
+func SetCC(b byte) {
+	ccreg = b
+	nzLazy, hvcLazy = lazyNone, lazyNone
+}
+
+// Carry returns the C bit, 0 or 1.
+func Carry() byte {
+	if hvcLazy != lazyNone {
+		flushHVC()
+	}
+	return ccreg & 0x01
+}
+
+// macros to set status flags //
+func SEC() { Carry(); ccreg |= 0x01 }
+func CLC() { Carry(); ccreg &= 0xfe }
+func SEV() { Carry(); ccreg |= 0x02 }
+func CLV() { Carry(); ccreg &= 0xfd }
+func SEH() { Carry(); ccreg |= 0x20 }
+func CLH() { Carry(); ccreg &= 0xdf }
+func SEZ() { zn(); ccreg |= 0x04 }
+func CLZ() { zn(); ccreg &= 0xfb }
+func SEN() { zn(); ccreg |= 0x08 }
+func CLN() { zn(); ccreg &= 0xf7 }
+
+func zn() {
+	if nzLazy != lazyNone {
+		flushNZ()
 	}
-	SETNZ8(byte(res))
+}
+
+// set N and Z flags depending on 8 or 16 bit result //
+func SETNZ8(b byte) {
+	nzLazy, nzRes = lazy8, Word(b)
+}
+func SETNZ16(b Word) {
+	nzLazy, nzRes = lazy16, b
+}
+
+func SETSTATUS(a byte, b byte, res Word) {
+	hvcLazy, hvcA, hvcB, hvcRes = lazy8, uint32(a), uint32(b), uint32(res)
+	nzLazy, nzRes = lazy8, res
 }
 
 func CondB(b bool, x, y byte) byte {
@@ -1891,137 +1875,73 @@ func CondS(b bool, x, y string) string {
 	}
 }
 
-func AOrB(aIfZero byte) EA {
-	if aIfZero == 0 {
-		return ARegEA
-	} else {
-		return BRegEA
-	}
-}
-
-func add() {
-	var aop, bop, res Word
-	Dis_inst("add", CondS(0 != (ireg&0x40), "b", "a"), 2)
-	accum := AOrB(ireg & 0x40)
-	aop = Word(accum.GetB())
-	bop = Word(eaddr8().GetB())
-	res = (aop) + (bop)
-	SETSTATUS(byte(aop), byte(bop), res)
-	accum.PutB(byte(res))
-}
-
-func sbc() {
-	var aop, bop, res Word
-	Dis_inst("sbc", CondS(0 != (ireg&0x40), "b", "a"), 2)
-	accum := AOrB(ireg & 0x40)
-	aop = Word(accum.GetB())
-	bop = Word(eaddr8().GetB())
-	res = aop - bop - Word(ccreg&0x01)
-	SETSTATUS(byte(aop), byte(bop), res)
-	accum.PutB(byte(res))
-}
-
-func sub() {
-	var aop, bop, res Word
-	Dis_inst("sub", CondS(0 != (ireg&0x40), "b", "a"), 2)
-	accum := AOrB(ireg & 0x40)
-	aop = Word(accum.GetB())
-	bop = Word(eaddr8().GetB())
-	res = aop - bop
-	SETSTATUS(byte(aop), byte(bop), res)
-	accum.PutB(byte(res))
-}
-
-func adc() {
-	var aop, bop, res Word
-	Dis_inst("adc", CondS(0 != (ireg&0x40), "b", "a"), 2)
-	accum := AOrB(ireg & 0x40)
-	aop = Word(accum.GetB())
-	bop = Word(eaddr8().GetB())
-	res = aop + bop + Word(ccreg&0x01)
-	SETSTATUS(byte(aop), byte(bop), res)
-	accum.PutB(byte(res))
-}
-
-func cmp() {
-	var aop, bop, res Word
-	Dis_inst("cmp", CondS(0 != (ireg&0x40), "b", "a"), 2)
-	accum := AOrB(ireg & 0x40)
-	aop = Word(accum.GetB())
-	bop = Word(eaddr8().GetB())
-	res = aop - bop
-	SETSTATUS(byte(aop), byte(bop), res)
-}
-
-func and() {
-	var aop, bop, res byte
-	Dis_inst("and", CondS(0 != (ireg&0x40), "b", "a"), 2)
-	accum := AOrB(ireg & 0x40)
-	aop = (accum.GetB())
-	bop = (eaddr8().GetB())
-	res = aop & bop
-	SETNZ8(res)
-	CLV()
-	accum.PutB(res)
-}
-func or() {
-	var aop, bop, res byte
-	Dis_inst("or", CondS(0 != (ireg&0x40), "b", "a"), 2)
-	accum := AOrB(ireg & 0x40)
-	aop = (accum.GetB())
-	bop = (eaddr8().GetB())
-	res = aop | bop
+// The op cores below compute results and condition codes; the
+// handlers in ops_gen.go fetch and store their operands.
+
+func addOp(a, b byte) byte {
+	res := Word(a) + Word(b)
+	SETSTATUS(a, b, res)
+	return byte(res)
+}
+
+func sbcOp(a, b byte) byte {
+	res := Word(a) - Word(b) - Word(Carry())
+	SETSTATUS(a, b, res)
+	return byte(res)
+}
+
+func subOp(a, b byte) byte {
+	res := Word(a) - Word(b)
+	SETSTATUS(a, b, res)
+	return byte(res)
+}
+
+func adcOp(a, b byte) byte {
+	res := Word(a) + Word(b) + Word(Carry())
+	SETSTATUS(a, b, res)
+	return byte(res)
+}
+
+func cmpOp(a, b byte) {
+	SETSTATUS(a, b, Word(a)-Word(b))
+}
+
+func andOp(a, b byte) byte {
+	res := a & b
 	SETNZ8(res)
 	CLV()
-	accum.PutB(res)
-}
-func eor() {
-	var aop, bop, res byte
-	Dis_inst("eor", CondS(0 != (ireg&0x40), "b", "a"), 2)
-	accum := AOrB(ireg & 0x40)
-	aop = (accum.GetB())
-	bop = (eaddr8().GetB())
-	res = aop ^ bop
+	return res
+}
+
+func orOp(a, b byte) byte {
+	res := a | b
 	SETNZ8(res)
 	CLV()
-	accum.PutB(res)
-}
-func bit() {
-	var aop, bop, res byte
-	Dis_inst("bit", CondS(0 != (ireg&0x40), "b", "a"), 2)
-	accum := AOrB(ireg & 0x40)
-	aop = (accum.GetB())
-	bop = (eaddr8().GetB())
-	res = aop & bop
+	return res
+}
+
+func eorOp(a, b byte) byte {
+	res := a ^ b
 	SETNZ8(res)
 	CLV()
+	return res
 }
 
-func ld() {
-	Dis_inst("ld", CondS(0 != (ireg&0x40), "b", "a"), 2)
-	accum := AOrB(ireg & 0x40)
-	res := eaddr8().GetB()
-	SETNZ8(res)
+func bitOp(a, b byte) {
+	SETNZ8(a & b)
 	CLV()
-	accum.PutB(res)
 }
 
-func st() {
-	Dis_inst("st", CondS(0 != (ireg&0x40), "b", "a"), 2)
-	accum := AOrB(ireg & 0x40)
-	res := accum.GetB()
-	eaddr8().PutB(res)
-	SETNZ8(res)
+func ldOp(b byte) byte {
+	SETNZ8(b)
 	CLV()
+	return b
 }
 
-func jsr() {
-	Dis_inst("jsr", "", 5)
-	Dis_len(-pcreg)
-	w := eaddr8()
-	Dis_len_incr(pcreg + 1)
-	PushWord(pcreg)
-	pcreg = Word(w)
+func stOp(b byte) byte {
+	SETNZ8(b)
+	CLV()
+	return b
 }
 
 func bsr() {
@@ -2034,40 +1954,30 @@ func bsr() {
 	Dis_ops(off, "", 0)
 }
 
-func neg() {
-	var a, r Word
-
-	{
-		t := W(pcreg)
-		if t == 0 {
-			log.Panicf("Executing 0000 instruction at pcreg=%04x", pcreg-1)
-			// log.Printf("Warning: Executing 0000 instruction at pcreg=%04x", pcreg-1)
-		}
+// zeroInstCheck stops on opcode 00 00, which is NEG <$00 but is
+// more likely running off into cleared memory.
+func zeroInstCheck() {
+	if W(pcreg) == 0 {
+		log.Panicf("Executing 0000 instruction at pcreg=%04x", pcreg-1)
+		// log.Printf("Warning: Executing 0000 instruction at pcreg=%04x", pcreg-1)
 	}
+}
 
-	a = 0
-	Dis_inst("neg", "", 4)
-	ea := eaddr0()
-	a = Word(ea.GetB())
-	r = -a
-	SETSTATUS(0, byte(a), r)
-	ea.PutB(byte(r))
+func negOp(b byte) byte {
+	r := -Word(b)
+	SETSTATUS(0, b, r)
+	return byte(r)
 }
 
-func com() {
-	Dis_inst("com", "", 4)
-	ea := eaddr0()
-	r := ^(ea.GetB())
+func comOp(b byte) byte {
+	r := ^b
 	SETNZ8(r)
 	SEC()
 	CLV()
-	ea.PutB(r)
+	return r
 }
 
-func lsr() {
-	Dis_inst("lsr", "", 4)
-	ea := eaddr0()
-	r := ea.GetB()
+func lsrOp(r byte) byte {
 	if (r & 0x01) != 0 {
 		SEC()
 	} else {
@@ -2080,14 +1990,11 @@ func lsr() {
 	}
 	r >>= 1
 	SETNZ8(r)
-	ea.PutB(r)
+	return r
 }
 
-func ror() {
-	c := (ccreg & 0x01) << 7
-	Dis_inst("ror", "", 4)
-	ea := eaddr0()
-	r := ea.GetB()
+func rorOp(r byte) byte {
+	c := Carry() << 7
 	if (r & 0x01) != 0 {
 		SEC()
 	} else {
@@ -2095,13 +2002,10 @@ func ror() {
 	}
 	r = (r >> 1) + c
 	SETNZ8(r)
-	ea.PutB(r)
+	return r
 }
 
-func asr() {
-	Dis_inst("asr", "", 4)
-	ea := eaddr0()
-	r := ea.GetB()
+func asrOp(r byte) byte {
 	if (r & 0x01) != 0 {
 		SEC()
 	} else {
@@ -2117,25 +2021,17 @@ func asr() {
 		r |= 0x80
 	}
 	SETNZ8(r)
-	ea.PutB(r)
+	return r
 }
 
-func asl() {
-	var a, r Word
-
-	Dis_inst("asl", "", 4)
-	ea := eaddr0()
-	a = Word(ea.GetB())
-	r = a << 1
-	SETSTATUS(byte(a), byte(a), r)
-	ea.PutB(byte(r))
+func aslOp(a byte) byte {
+	r := Word(a) << 1
+	SETSTATUS(a, a, r)
+	return byte(r)
 }
 
-func rol() {
-	c := (ccreg & 0x01)
-	Dis_inst("rol", "", 4)
-	ea := eaddr0()
-	r := ea.GetB()
+func rolOp(r byte) byte {
+	c := Carry()
 	if (r & 0x80) != 0 {
 		SEC()
 	} else {
@@ -2148,13 +2044,10 @@ func rol() {
 	}
 	r = (r << 1) + c
 	SETNZ8(r)
-	ea.PutB(r)
+	return r
 }
 
-func inc() {
-	Dis_inst("inc", "", 4)
-	ea := eaddr0()
-	r := ea.GetB()
+func incOp(r byte) byte {
 	r++
 	if r == 0x80 {
 		SEV()
@@ -2162,13 +2055,10 @@ func inc() {
 		CLV()
 	}
 	SETNZ8(r)
-	ea.PutB(r)
+	return r
 }
 
-func dec() {
-	Dis_inst("dec", "", 4)
-	ea := eaddr0()
-	r := ea.GetB()
+func decOp(r byte) byte {
 	r--
 	if r == 0x7f {
 		SEV()
@@ -2176,59 +2066,48 @@ func dec() {
 		CLV()
 	}
 	SETNZ8(r)
-	ea.PutB(r)
+	return r
 }
 
-func tst() {
-	Dis_inst("tst", "", 4)
-	ea := eaddr0()
-	r := ea.GetB()
+func tstOp(r byte) {
 	SETNZ8(r)
 	CLV()
 }
 
-func jmp() {
-	Dis_len(-pcreg)
-	Dis_inst("jmp", "", 1)
-	ea := eaddr0()
-	Dis_len_incr(pcreg + 1)
-	pcreg = Word(ea)
-}
-
-func clr() {
-	Dis_inst("clr", "", 4)
-	ea := eaddr0()
-	ea.PutB(0)
+func clrOp() byte {
 	CLN()
 	CLV()
 	SEZ()
 	CLC()
+	return 0
 }
 
+// flag0 and flag1 are the $10 and $11 prebytes, which select
+// the instructions of pages 2 and 3.
 func flag0() {
-	if iflag != 0 { // in case flag already set by previous flag instr don't recurse //
-		pcreg--
-		return
-	}
-	iflag = 1
 	ireg = B(pcreg)
 	pcreg++
 	Dis_inst("", "", 1)
-	(instructionTable[ireg])()
-	iflag = 0
+	if Stats {
+		statOps[1][ireg]++
+	}
+	page2Table[ireg]()
 }
 
 func flag1() {
-	if iflag != 0 { // in case flag already set by previous flag instr don't recurse //
-		pcreg--
-		return
-	}
-	iflag = 2
 	ireg = B(pcreg)
 	pcreg++
 	Dis_inst("", "", 1)
-	(instructionTable[ireg])()
-	iflag = 0
+	if Stats {
+		statOps[2][ireg]++
+	}
+	page3Table[ireg]()
+}
+
+// reflag is a prebyte after a prebyte.  Back up, so the second one
+// starts the next instruction.
+func reflag() {
+	pcreg--
 }
 
 func nop() {
@@ -2242,7 +2121,7 @@ func sync_inst() {
 
 func cwai() {
 	b := B(pcreg) // Immediate operand //
-	ccreg &= b
+	SetCC(CC() & b)
 	pcreg++
 
 	L("Waiting, cwai #$%02x.", b)
@@ -2276,13 +2155,14 @@ func daa() {
 	var a Word
 	Dis_inst("daa", "", 2)
 	a = Word(GetAReg())
-	if (ccreg & 0x20) != 0 {
+	cc := CC()
+	if (cc & 0x20) != 0 {
 		a += 6
 	}
 	if (a & 0x0f) > 9 {
 		a += 6
 	}
-	if (ccreg & 0x01) != 0 {
+	if (cc & 0x01) != 0 {
 		a += 0x60
 	}
 	if (a & 0xf0) > 0x90 {
@@ -2299,7 +2179,7 @@ func orcc() {
 	off := F("#$%02x", b)
 	Dis_inst("orcc", "", 3)
 	Dis_ops(off, "", 0)
-	ccreg |= b
+	SetCC(CC() | b)
 }
 
 func andcc() {
@@ -2307,7 +2187,7 @@ func andcc() {
 	off := F("#$%02x", b)
 	Dis_inst("andcc", "", 3)
 	Dis_ops(off, "", 0)
-	ccreg &= b
+	SetCC(CC() & b)
 }
 
 func mul() {
@@ -2372,7 +2252,9 @@ func rti() {
 		Dis_inst("rti", "", 15)
 	}
 	Dis_len(1)
-	PullByte(&ccreg)
+	var cc byte
+	PullByte(&cc)
+	SetCC(cc)
 	if entire != 0 {
 		PullWord(&dreg)
 		PullByte(&dpreg)
@@ -2381,10 +2263,19 @@ func rti() {
 		PullWord(&ureg)
 	}
 	PullWord(&pcreg)
+	if ProcTracing {
+		ProcCheck()
+	}
+	if BreakModules {
+		ResolveBreaks()
+	}
 
 	back3 := B(pcreg - 3)
 	back2 := B(pcreg - 2)
 	back1 := B(pcreg - 1)
+	if back1 == sym.I_ReadLn && back2 == 0x3f && back3 == 0x10 && *FlagKeyScript != "" {
+		PasteReadLnReturned()
+	}
 	if back3 == 0x10 && back2 == 0x3f && describe != "" {
 		if (ccreg & 1 /* carry bit indicates error */) != 0 {
 			errcode := GetBReg()
@@ -2445,15 +2336,9 @@ func rti() {
 	}
 }
 
-var swi_name = []string{"swi", "swi2", "swi3"}
-
-func swi() {
-	Dis_inst(swi_name[iflag], "", 5)
-	Dis_len(3 /* Often an extra byte after the SWI opcode */)
-
-	ccregOrig, sregOrig := ccreg, sreg
-
-	ccreg |= 0x80
+// swiPush stacks the entire state, as SWI, SWI2, and SWI3 do.
+func swiPush() {
+	SetCC(CC() | 0x80)
 	PushWord(pcreg)
 	PushWord(ureg)
 	PushWord(yreg)
@@ -2461,76 +2346,92 @@ func swi() {
 	PushByte(dpreg)
 	PushWord(dreg)
 	PushByte(ccreg)
+}
 
-	var handler Word
-	switch iflag {
-	case 0: /* SWI */
-		L("SWI")
-		if true {
-			// Intercept HyperOp on SWI
-			op := PeekB(pcreg)
-			pcreg++
-			L("HyperOp %d.", op)
-			HyperOp(op)
-			ccreg, sreg = ccregOrig, sregOrig
-		} else {
-			// Normal SWI.
-			ccreg |= 0xd0
-			handler = W(0xfffa)
-		}
-		return
-	case 1: /* SWI2 */
-		describe, returns := DecodeOs9Opcode(B(pcreg))
-		proc := W0(sym.D_Proc)
-		pid := B0(proc + sym.P_ID)
-		pmodul := W0(proc + sym.P_PModul)
-		moduleName := Os9String(pmodul + W(pmodul+4))
-
-		luser := 0
-		if Level == 1 && dpreg != 0 {
-			luser = 1
-		}
-		if Level == 2 && MmuTask != 0 {
-			luser = 1
-		}
+func swi() {
+	Dis_inst("swi", "", 5)
+	Dis_len(3 /* Often an extra byte after the SWI opcode */)
 
-		L("{proc=%x%q} OS9KERNEL%d: %s", pid, moduleName, luser, describe)
-		L("\tregs: %s", Regs())
-		L("\t%s", ExplainMMU())
+	ccregOrig, sregOrig := CC(), sreg
+	swiPush()
 
-		stack := MapAddr(sreg, true /*quiet*/)
-		if returns {
-			Os9Description[stack] = describe
-		} else {
-			Os9Description[stack] = ""
-		}
+	L("SWI")
+	if true {
+		// Intercept HyperOp on SWI
+		op := PeekB(pcreg)
+		pcreg++
+		L("HyperOp %d.", op)
+		HyperOp(op)
+		SetCC(ccregOrig)
+		sreg = sregOrig
+	} else {
+		// Normal SWI.
+		ccreg |= 0xd0
+		pcreg = W(0xfffa)
+	}
+}
 
-		handler = W(0xfff4)
-	case 2: /* SWI3 */
-		handler = W(0xfff2)
-	default:
-		log.Panicf("bad swi iflag=: %d", iflag)
+func swi2() {
+	Dis_inst("swi2", "", 5)
+	Dis_len(3 /* Often an extra byte after the SWI opcode */)
+
+	swiPush()
+
+	describe, returns := DecodeOs9Opcode(B(pcreg))
+	proc := W0(sym.D_Proc)
+	pid := B0(proc + sym.P_ID)
+	pmodul := W0(proc + sym.P_PModul)
+	moduleName := Os9String(pmodul + W(pmodul+4))
+
+	luser := 0
+	if Level == 1 && dpreg != 0 {
+		luser = 1
+	}
+	if Level == 2 && MmuTask != 0 {
+		luser = 1
 	}
 
-	if paranoid {
-		if handler < 256 {
-			log.Panicf("FATAL: Attempted SWI%d with small handler: 0x%04x", handler)
-		}
-		if handler >= 0xFF00 {
-			log.Panicf("FATAL: Attempted SWI%d with large handler: 0x%04x", handler)
-		}
+	L("{proc=%x%q} OS9KERNEL%d: %s", pid, moduleName, luser, describe)
+	L("\tregs: %s", Regs())
+	L("\t%s", ExplainMMU())
+	if ProcTracing {
+		ProcSyscall(proc, moduleName, describe)
 	}
 
-	syscall := B(pcreg)
-	handled := false
+	stack := MapAddr(sreg, true /*quiet*/)
+	if returns {
+		Os9Description[stack] = describe
+	} else {
+		Os9Description[stack] = ""
+	}
 
-	if hyp && iflag == 1 {
-		handled = Os9HypervisorCall(syscall)
+	handler := swiHandler(2, 0xfff4)
+	syscall := B(pcreg)
+	if hyp && Os9HypervisorCall(syscall) {
+		return
 	}
+	pcreg = handler
+}
 
-	if !handled {
-		pcreg = handler
+func swi3() {
+	Dis_inst("swi3", "", 5)
+	Dis_len(3 /* Often an extra byte after the SWI opcode */)
+
+	swiPush()
+	pcreg = swiHandler(3, 0xfff2)
+}
+
+func swiHandler(n int, vector Word) Word {
+	handler := W(vector)
+	if paranoid {
+		if handler < 256 {
+			log.Panicf("FATAL: Attempted SWI%d with small handler: 0x%04x", n, handler)
+		}
+		if handler >= 0xFF00 {
+			log.Panicf("FATAL: Attempted SWI%d with large handler: 0x%04x", n, handler)
+		}
 	}
+	return handler
 }
 
 const (
@@ -2567,6 +2468,7 @@ func Os9HypervisorCall(syscall byte) bool {
 	case sym.I_Open:
 	case sym.I_Read:
 	case sym.I_ReadLn:
+		handled = PasteReadLn()
 	case sym.I_Seek:
 	case sym.I_SetStt:
 	case sym.I_Write:
@@ -2584,17 +2486,18 @@ func tfr() {
 	Dis_inst("tfr", "", 7)
 	b := ImmByte()
 	Dis_reg(b)
-	src := TfrReg(15 & (b >> 4))
-	dst := TfrReg(15 & b)
+	src, dst := 15&(b>>4), 15&b
+	tfrCheck(src)
+	tfrCheck(dst)
 	if (src & 8) != (dst & 8) {
 		log.Panicf("tfr with inconsistent sizes; src=%d dst=%d", src, dst)
 	}
 	if (src & 8) == 0 {
 		// 16 bit
-		dst.PutW(src.GetW())
+		*tfrRegW[dst] = *tfrRegW[src]
 	} else {
 		// 8 bit
-		dst.PutB(src.GetB())
+		tfrPutB(dst, tfrGetB(src))
 	}
 }
 
@@ -2602,63 +2505,72 @@ func exg() {
 	Dis_inst("exg", "", 8)
 	b := ImmByte()
 	Dis_reg(b)
-	r1 := TfrReg(15 & (b >> 4))
-	r2 := TfrReg(15 & b)
+	r1, r2 := 15&(b>>4), 15&b
+	tfrCheck(r1)
+	tfrCheck(r2)
+	if (r1 & 8) != (r2 & 8) {
+		log.Panicf("exg with inconsistent sizes; r1=%d r2=%d", r1, r2)
+	}
 	if (b & 0x80) == 0 {
 		// 16 bit
-		t1, t2 := r1.GetW(), r2.GetW()
-		r1.PutW(t2)
-		r2.PutW(t1)
+		p1, p2 := tfrRegW[r1], tfrRegW[r2]
+		*p1, *p2 = *p2, *p1
 	} else {
 		// 8 bit
-		t1, t2 := r1.GetB(), r2.GetB()
-		r1.PutB(t2)
-		r2.PutB(t1)
+		t1, t2 := tfrGetB(r1), tfrGetB(r2)
+		tfrPutB(r1, t2)
+		tfrPutB(r2, t1)
 	}
 }
 
 func br(f bool) {
-	var dest Word
+	b := ImmByte()
+	dest := pcreg + SignExtend(b)
+	if Stats {
+		CountBranch(false, f)
+	}
+	if f {
+		pcreg = dest
+	}
+	Dis_len(2)
+	off := F("$%04x", dest&0xffff)
+	Dis_ops(off, "", 0)
+}
 
-	if 0 == iflag {
-		b := ImmByte()
-		dest = pcreg + SignExtend(b)
-		if f {
-			pcreg += SignExtend(b)
-		}
-		Dis_len(2)
-	} else {
-		w := ImmWord()
-		dest = pcreg + w
-		if f {
-			pcreg += w
-		}
-		Dis_len(3)
+func lbr(f bool) {
+	w := ImmWord()
+	dest := pcreg + w
+	if Stats {
+		CountBranch(true, f)
 	}
+	if f {
+		pcreg = dest
+	}
+	Dis_len(3)
 	off := F("$%04x", dest&0xffff)
 	Dis_ops(off, "", 0)
 }
 
 func NXORV() bool {
-	return ((ccreg & 0x08) ^ (ccreg & 0x02)) != 0
-}
-func IFLAG() bool {
-	return iflag != 0
+	cc := CC()
+	return ((cc & 0x08) ^ (cc & 0x02)) != 0
 }
 
+// The conditional branches (bhi, lbhi, ...) are in ops_gen.go.
+
 func bra() {
-	if iflag == 0 && B(pcreg) == 0xFE {
+	if B(pcreg) == 0xFE {
 		// ddt Mon May 29 01:20:26 PM PDT 2023
 		// DoDumpAllMemoryPhys()
 		DumpAllMemory()
 		log.Panic("Panic: SELFi-BRANCH at pc=$%04x", pcreg-1)
 	}
-	Dis_inst(CondS(IFLAG(), "l", ""), "bra", CondI(IFLAG(), 5, 3))
+	Dis_inst("", "bra", 3)
 	br(true)
 }
 
 func brn() {
-	Dis_inst(CondS(IFLAG(), "l", ""), "brn", CondI(IFLAG(), 5, 3))
+	Dis_inst("", "brn", 3)
 	br(false)
 
 	// The magic sequence "NOP ; BRN #offset" (i.e. $12 $21 offset)
@@ -2671,74 +2583,15 @@ func brn() {
 	}
 }
 
-func bhi() {
-	Dis_inst(CondS(IFLAG(), "l", ""), "bhi", CondI(IFLAG(), 5, 3))
-	br(0 == (ccreg & 0x05))
-}
-
-func bls() {
-	Dis_inst(CondS(IFLAG(), "l", ""), "bls", CondI(IFLAG(), 5, 3))
-	br(0 != ccreg&0x05)
-}
-
-func bcc() {
-	Dis_inst(CondS(IFLAG(), "l", ""), "bcc", CondI(IFLAG(), 5, 3))
-	br(0 == (ccreg & 0x01))
-}
-
-func bcs() {
-	Dis_inst(CondS(IFLAG(), "l", ""), "bcs", CondI(IFLAG(), 5, 3))
-	br(0 != ccreg&0x01)
-}
-
-func bne() {
-	Dis_inst(CondS(IFLAG(), "l", ""), "bne", CondI(IFLAG(), 5, 3))
-	br(0 == (ccreg & 0x04))
-}
-
-func beq() {
-	Dis_inst(CondS(IFLAG(), "l", ""), "beq", CondI(IFLAG(), 5, 3))
-	br(0 != ccreg&0x04)
-}
-
-func bvc() {
-	Dis_inst(CondS(IFLAG(), "l", ""), "bvc", CondI(IFLAG(), 5, 3))
-	br(0 == (ccreg & 0x02))
-}
-
-func bvs() {
-	Dis_inst(CondS(IFLAG(), "l", ""), "bvs", CondI(IFLAG(), 5, 3))
-	br(0 != ccreg&0x02)
-}
-
-func bpl() {
-	Dis_inst(CondS(IFLAG(), "l", ""), "bpl", CondI(IFLAG(), 5, 3))
-	br(0 == (ccreg & 0x08))
-}
-
-func bmi() {
-	Dis_inst(CondS(IFLAG(), "l", ""), "bmi", CondI(IFLAG(), 5, 3))
-	br(0 != ccreg&0x08)
-}
-
-func bge() {
-	Dis_inst(CondS(IFLAG(), "l", ""), "bge", CondI(IFLAG(), 5, 3))
-	br(!NXORV())
-}
-
-func blt() {
-	Dis_inst(CondS(IFLAG(), "l", ""), "blt", CondI(IFLAG(), 5, 3))
-	br(NXORV())
-}
-
-func bgt() {
-	Dis_inst(CondS(IFLAG(), "l", ""), "bgt", CondI(IFLAG(), 5, 3))
-	br(!(NXORV() || 0 != ccreg&0x04))
+// lbra10 is $10 $20, the page 2 spelling of LBRA ($16).
+func lbra10() {
+	Dis_inst("l", "bra", 5)
+	lbr(true)
 }
 
-func ble() {
-	Dis_inst(CondS(IFLAG(), "l", ""), "ble", CondI(IFLAG(), 5, 3))
-	br(NXORV() || 0 != ccreg&0x04)
+func lbrn() {
+	Dis_inst("l", "brn", 5)
+	lbr(false)
 }
 
 func leax() {
@@ -2816,7 +2669,7 @@ func pshs() {
 		PushByte(GetAReg())
 	}
 	if (b & 0x01) != 0 {
-		PushByte(ccreg)
+		PushByte(CC())
 	}
 }
 
@@ -2826,7 +2679,9 @@ func puls() {
 	Dis_len(2)
 	bit_count(b)
 	if (b & 0x01) != 0 {
-		PullByte(&ccreg)
+		var t byte
+		PullByte(&t)
+		SetCC(t)
 	}
 	if (b & 0x02) != 0 {
 		var t byte
@@ -2885,7 +2740,7 @@ func pshu() {
 		PushUByte(GetAReg())
 	}
 	if (b & 0x01) != 0 {
-		PushUByte(ccreg)
+		PushUByte(CC())
 	}
 }
 
@@ -2895,7 +2750,9 @@ func pulu() {
 	Dis_len(2)
 	bit_count(b)
 	if (b & 0x01) != 0 {
-		PullUByte(&ccreg)
+		var t byte
+		PullUByte(&t)
+		SetCC(t)
 	}
 	if (b & 0x02) != 0 {
 		var t byte
@@ -2925,151 +2782,41 @@ func pulu() {
 }
 
 func SETSTATUSD(a, b, res uint32) {
-	if (res & 0x10000) != 0 {
-		SEC()
-	} else {
-		CLC()
+	if hvcLazy == lazy8 {
+		flushHVC() // Keep its H, which 16-bit ops leave alone.
 	}
-	if (((res >> 1) ^ a ^ b ^ res) & 0x8000) != 0 {
-		SEV()
-	} else {
-		CLV()
-	}
-	SETNZ16(Word(res))
+	hvcLazy, hvcA, hvcB, hvcRes = lazy16, a, b, res
+	nzLazy, nzRes = lazy16, Word(res)
 }
 
-func addd() {
-	var aop, bop, res uint32
-	Dis_inst("addd", "", 5)
-	aop = uint32(dreg)
-	ea := eaddr16()
-	bop = uint32(ea.GetW())
-	res = aop + bop
+func subdOp(w Word) {
+	aop, bop := uint32(dreg), uint32(w)
+	res := aop - bop
 	SETSTATUSD(aop, bop, res)
 	dreg = Word(res)
 }
 
-func subd() {
-	var aop, bop, res uint32
-	if iflag != 0 {
-		Dis_inst("cmpd", "", 5)
-	} else {
-		Dis_inst("subd", "", 5)
-	}
-	if iflag == 2 {
-		aop = uint32(ureg)
-		Dis_inst("cmpu", "", 5)
-	} else {
-		aop = uint32(dreg)
-	}
-	ea := eaddr16()
-	bop = uint32(ea.GetW())
-	res = aop - bop
-	SETSTATUSD(aop, bop, res)
-	if iflag == 0 {
-		dreg = Word(res)
-	}
-}
-
-func cmpx() {
-	var aop, bop, res uint32
-	switch iflag {
-	case 0:
-		Dis_inst("cmpx", "", 5)
-		aop = uint32(xreg)
-	case 1:
-		Dis_inst("cmpy", "", 5)
-		aop = uint32(yreg)
-	case 2:
-		Dis_inst("cmps", "", 5)
-		aop = uint32(sreg)
-	}
-	ea := eaddr16()
-	bop = uint32(ea.GetW())
-	res = aop - bop
+func adddOp(w Word) {
+	aop, bop := uint32(dreg), uint32(w)
+	res := aop + bop
 	SETSTATUSD(aop, bop, res)
+	dreg = Word(res)
 }
 
-func ldd() {
-	Dis_inst("ldd", "", 4)
-	ea := eaddr16()
-	w := ea.GetW()
-	SETNZ16(w)
-	dreg = w
-}
-
-func ldx() {
-	if iflag != 0 {
-		Dis_inst("ldy", "", 4)
-	} else {
-		Dis_inst("ldx", "", 4)
-	}
-	ea := eaddr16()
-	w := ea.GetW()
-	SETNZ16(w)
-	if iflag == 0 {
-		xreg = w
-	} else {
-		yreg = w
-	}
-}
-
-func ldu() {
-	if iflag != 0 {
-		Dis_inst("lds", "", 4)
-	} else {
-		Dis_inst("ldu", "", 4)
-	}
-	ea := eaddr16()
-	w := ea.GetW()
-	SETNZ16(w)
-	if iflag == 0 {
-		ureg = w
-	} else {
-		sreg = w
-	}
-}
-
-func std() {
-	Dis_inst("std", "", 4)
-	ea := eaddr16()
-	w := dreg
-	SETNZ16(w)
-	ea.PutW(w)
+// cmp16Op is CMPD, CMPX, CMPY, CMPU, and CMPS.
+func cmp16Op(a, b Word) {
+	aop, bop := uint32(a), uint32(b)
+	SETSTATUSD(aop, bop, aop-bop)
 }
 
-func stx() {
-	if iflag != 0 {
-		Dis_inst("sty", "", 4)
-	} else {
-		Dis_inst("stx", "", 4)
-	}
-	ea := eaddr16()
-	var w Word
-	if iflag == 0 {
-		w = xreg
-	} else {
-		w = yreg
-	}
+func ld16Op(w Word) Word {
 	SETNZ16(w)
-	ea.PutW(w)
+	return w
 }
 
-func stu() {
-	if iflag == 0 {
-		Dis_inst("stu", "", 4)
-	} else {
-		Dis_inst("sts", "", 4)
-	}
-	ea := eaddr16()
-	var w Word
-	if iflag == 0 {
-		w = ureg
-	} else {
-		w = sreg
-	}
+func st16Op(w Word) Word {
 	SETNZ16(w)
-	ea.PutW(w)
+	return w
 }
 
 func ccbits(b byte) string {
@@ -3091,38 +2838,66 @@ func ccbits(b byte) string {
 
 func init() {
 	instructionTable = []func(){
-		neg, ill, ill, com, lsr, ill, ror, asr,
-		asl, rol, dec, ill, inc, tst, jmp, clr,
+		neg_dp, ill, ill, com_dp, lsr_dp, ill, ror_dp, asr_dp,
+		asl_dp, rol_dp, dec_dp, ill, inc_dp, tst_dp, jmp_dp, clr_dp,
 		flag0, flag1, nop, sync_inst, ill, ill, lbra, lbsr,
 		ill, daa, orcc, ill, andcc, sex, exg, tfr,
 		bra, brn, bhi, bls, bcc, bcs, bne, beq,
 		bvc, bvs, bpl, bmi, bge, blt, bgt, ble,
 		leax, leay, leas, leau, pshs, puls, pshu, pulu,
 		ill, rts, abx, rti, cwai, mul, ill, swi,
-		neg, ill, ill, com, lsr, ill, ror, asr,
-		asl, rol, dec, ill, inc, tst, ill, clr,
-		neg, ill, ill, com, lsr, ill, ror, asr,
-		asl, rol, dec, ill, inc, tst, ill, clr,
-		neg, ill, ill, com, lsr, ill, ror, asr,
-		asl, rol, dec, ill, inc, tst, jmp, clr,
-		neg, ill, ill, com, lsr, ill, ror, asr,
-		asl, rol, dec, ill, inc, tst, jmp, clr,
-		sub, cmp, sbc, subd, and, bit, ld, st,
-		eor, adc, or, add, cmpx, bsr, ldx, stx,
-		sub, cmp, sbc, subd, and, bit, ld, st,
-		eor, adc, or, add, cmpx, jsr, ldx, stx,
-		sub, cmp, sbc, subd, and, bit, ld, st,
-		eor, adc, or, add, cmpx, jsr, ldx, stx,
-		sub, cmp, sbc, subd, and, bit, ld, st,
-		eor, adc, or, add, cmpx, jsr, ldx, stx,
-		sub, cmp, sbc, addd, and, bit, ld, st,
-		eor, adc, or, add, ldd, std, ldu, stu,
-		sub, cmp, sbc, addd, and, bit, ld, st,
-		eor, adc, or, add, ldd, std, ldu, stu,
-		sub, cmp, sbc, addd, and, bit, ld, st,
-		eor, adc, or, add, ldd, std, ldu, stu,
-		sub, cmp, sbc, addd, and, bit, ld, st,
-		eor, adc, or, add, ldd, std, ldu, stu,
+		neg_a, ill, ill, com_a, lsr_a, ill, ror_a, asr_a,
+		asl_a, rol_a, dec_a, ill, inc_a, tst_a, ill, clr_a,
+		neg_b, ill, ill, com_b, lsr_b, ill, ror_b, asr_b,
+		asl_b, rol_b, dec_b, ill, inc_b, tst_b, ill, clr_b,
+		neg_idx, ill, ill, com_idx, lsr_idx, ill, ror_idx, asr_idx,
+		asl_idx, rol_idx, dec_idx, ill, inc_idx, tst_idx, jmp_idx, clr_idx,
+		neg_ext, ill, ill, com_ext, lsr_ext, ill, ror_ext, asr_ext,
+		asl_ext, rol_ext, dec_ext, ill, inc_ext, tst_ext, jmp_ext, clr_ext,
+		suba_imm, cmpa_imm, sbca_imm, subd_imm, anda_imm, bita_imm, lda_imm, sta_imm,
+		eora_imm, adca_imm, ora_imm, adda_imm, cmpx_imm, bsr, ldx_imm, stx_imm,
+		suba_dp, cmpa_dp, sbca_dp, subd_dp, anda_dp, bita_dp, lda_dp, sta_dp,
+		eora_dp, adca_dp, ora_dp, adda_dp, cmpx_dp, jsr_dp, ldx_dp, stx_dp,
+		suba_idx, cmpa_idx, sbca_idx, subd_idx, anda_idx, bita_idx, lda_idx, sta_idx,
+		eora_idx, adca_idx, ora_idx, adda_idx, cmpx_idx, jsr_idx, ldx_idx, stx_idx,
+		suba_ext, cmpa_ext, sbca_ext, subd_ext, anda_ext, bita_ext, lda_ext, sta_ext,
+		eora_ext, adca_ext, ora_ext, adda_ext, cmpx_ext, jsr_ext, ldx_ext, stx_ext,
+		subb_imm, cmpb_imm, sbcb_imm, addd_imm, andb_imm, bitb_imm, ldb_imm, stb_imm,
+		eorb_imm, adcb_imm, orb_imm, addb_imm, ldd_imm, std_imm, ldu_imm, stu_imm,
+		subb_dp, cmpb_dp, sbcb_dp, addd_dp, andb_dp, bitb_dp, ldb_dp, stb_dp,
+		eorb_dp, adcb_dp, orb_dp, addb_dp, ldd_dp, std_dp, ldu_dp, stu_dp,
+		subb_idx, cmpb_idx, sbcb_idx, addd_idx, andb_idx, bitb_idx, ldb_idx, stb_idx,
+		eorb_idx, adcb_idx, orb_idx, addb_idx, ldd_idx, std_idx, ldu_idx, stu_idx,
+		subb_ext, cmpb_ext, sbcb_ext, addd_ext, andb_ext, bitb_ext, ldb_ext, stb_ext,
+		eorb_ext, adcb_ext, orb_ext, addb_ext, ldd_ext, std_ext, ldu_ext, stu_ext,
+	}
+
+	copy(page2Table[:], instructionTable)
+	copy(page3Table[:], instructionTable)
+	for _, t := range []*[256]func(){&page2Table, &page3Table} {
+		t[0x10], t[0x11] = reflag, reflag
+	}
+	copy(page2Table[0x20:], []func(){
+		lbra10, lbrn, lbhi, lbls, lbcc, lbcs, lbne, lbeq,
+		lbvc, lbvs, lbpl, lbmi, lbge, lblt, lbgt, lble,
+	})
+	page2Table[0x3F] = swi2
+	page3Table[0x3F] = swi3
+	pageModes(&page2Table, 0x83, cmpd_imm, cmpd_dp, cmpd_idx, cmpd_ext)
+	pageModes(&page2Table, 0x8C, cmpy_imm, cmpy_dp, cmpy_idx, cmpy_ext)
+	pageModes(&page2Table, 0x8E, ldy_imm, ldy_dp, ldy_idx, ldy_ext)
+	pageModes(&page2Table, 0x8F, sty_imm, sty_dp, sty_idx, sty_ext)
+	pageModes(&page2Table, 0xCE, lds_imm, lds_dp, lds_idx, lds_ext)
+	pageModes(&page2Table, 0xCF, sts_imm, sts_dp, sts_idx, sts_ext)
+	pageModes(&page3Table, 0x83, cmpu_imm, cmpu_dp, cmpu_idx, cmpu_ext)
+	pageModes(&page3Table, 0x8C, cmps_imm, cmps_dp, cmps_idx, cmps_ext)
+}
+
+// pageModes sets the four addressing modes of an op, starting at its
+// immediate opcode.
+func pageModes(t *[256]func(), op byte, modes ...func()) {
+	for i, f := range modes {
+		t[op+byte(i)*0x10] = f
 	}
 }
 
@@ -3173,6 +2948,30 @@ func PeekBWithInt(addr int) byte {
 	return PeekB(Word(addr))
 }
 
+// ExitReports writes the reports due when the emulator stops.
+func ExitReports() {
+	PaceFinalReport()
+	WriteStats()
+	WriteCoverage()
+	ProcFinalReport()
+	WriteHeatmap()
+	WriteDumpRam()
+	Disp.Close()
+}
+
+func WriteDumpRam() {
+	if *FlagDumpRam == "" {
+		return
+	}
+	bb := make([]byte, 0x10000)
+	for i := range bb {
+		bb[i] = PeekB(Word(i))
+	}
+	if err := ioutil.WriteFile(*FlagDumpRam, bb, 0644); err != nil {
+		log.Panicf("cannot write -dump_ram file: %v", err)
+	}
+}
+
 func Main() {
 	CompileWatches()
 	SetVerbosityBits(*FlagInitialVerbosity)
@@ -3180,8 +2979,7 @@ func Main() {
 	keystrokes := make(chan byte, 0)
 	go InputRoutine(keystrokes)
 
-	CocodChan := make(chan *display.CocoDisplayParams, 50)
-	Disp = display.NewDisplay(mem[:], 80, 25, CocodChan, keystrokes, &sam, PeekBWithInt)
+	Disp = display.NewDisplay(mem[:], 80, 25, &CocodSlot, keystrokes, &sam, PeekBWithInt)
 
 	Ld("(begin roms)")
 	if *FlagBootImageFilename != "" {
@@ -3309,24 +3107,31 @@ func Main() {
 
 	sreg = 0x8000
 	dpreg = 0
-	iflag = 0
 
 	Dis_len(0)
 	cycles_sum = 0
 
+	InitPace()
+	InitStats()
+	InitCoverage()
+	InitProcs()
+	InitHeatmap()
+	InitBreaks()
+	InitGdb()
 	defer func() {
+		ExitReports()
 		Finish()
 	}()
 
 	if *FlagBasicText {
-		CocodChan <- GetCocoDisplayParams()
+		PublishDisplayParams()
 	}
 
 	max := uint64(MaxUint64)
 	if *FlagMaxSteps > 0 {
 		max = *FlagMaxSteps
 	}
-	stepsUntilTimer := *FlagClock
+	stepsUntilTimer := TimerSteps()
 	early := true
 
 	for Steps = uint64(0); Steps < max; Steps++ {
@@ -3336,15 +3141,21 @@ func Main() {
 
 		pcreg_prev = pcreg
 
-		if stepsUntilTimer == 0 {
+		if (Steps & (PaceCheckSteps - 1)) == 0 {
+			PaceCheck()
+		}
+
+		if stepsUntilTimer == 0 || PaceTimerDue {
 			DoMemoryDumps()
 			FireTimerInterrupt()
-			stepsUntilTimer = *FlagClock
+			stepsUntilTimer = TimerSteps()
+			PaceTimerDue = false
 		} else {
 			stepsUntilTimer--
 		}
 
 		if Waiting {
+			cycles_sum += PaceIdleCycles
 			continue
 		}
 
@@ -3356,14 +3167,16 @@ func Main() {
 			if (irqs_pending&IRQ_PENDING) != 0 && !(ccreg&CC_INHIBIT_IRQ != 0) {
 
 				irq(keystrokes)
-				CocodChan <- GetCocoDisplayParams()
+				if VideoParamsChanged {
+					PublishDisplayParams()
+				}
 				continue
 			}
 		}
 
 		if *FlagBasicText {
-			if (Steps & 255) == 0 {
-				CocodChan <- GetCocoDisplayParams()
+			if (Steps&255) == 0 && VideoParamsChanged {
+				PublishDisplayParams()
 				// ShowBasicText() // do it on RTS and PULS, instead.
 			}
 		}
@@ -3371,6 +3184,9 @@ func Main() {
 		// Take one step.
 		cycles = 0
 
+		if Breakpoints {
+			BreakCheck()
+		}
 		ireg = B(pcreg)
 		if pcreg == Word(*FlagTriggerPc) && ireg == byte(*FlagTriggerOp) {
 			*FlagTraceAfter = 1
@@ -3380,6 +3196,13 @@ func Main() {
 			// DoDumpAllMemory()
 		}
 		pcreg++
+		if Stats {
+			statOps[0][ireg]++
+			statTask[MmuTask&1]++
+		}
+		if Coverage {
+			CoverMark(MapAddr(pcreg_prev, true))
+		}
 
 		// Process instruction
 		HandleBtBug()
@@ -3401,6 +3224,14 @@ func Main() {
 	}
 }
 
+func PublishDisplayParams() {
+	VideoParamsChanged = false
+	p := GetCocoDisplayParams()
+	VideoLo, VideoLen, VideoBytesPerRow = display.VideoWindow(p)
+	display.Dirty.MarkAll()
+	CocodSlot.Publish(p)
+}
+
 func ParanoidAsserts() {
 	if pcreg < 0x005E /* D.BtDbg */ {
 		log.Panicf("PC in page 0: 0x%x", pcreg)
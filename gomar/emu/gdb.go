@@ -0,0 +1,394 @@
+package emu
+
+// GDB remote serial protocol stub.  With -gdb=localhost:PORT (or a
+// Unix socket path), gomar waits for a debugger before the first step,
+// then stops wherever the debugger asks.  Breakpoints (Z0, Z1) and
+// write watchpoints (Z2) go in the -break and -watch_mem bitmaps, at
+// the physical address their logical address has in the current task.
+// Memory reads and writes also use the current task.
+//
+// Registers, in "g" order: cc a b dp (8 bits) x y u s pc (16 bits),
+// big-endian, as in MAME's m6809 stub.
+//
+//	(gdb) target remote localhost:2159
+//	(gdb) monitor mmu | procs | paths | regs
+//
+// With no debugger attached, the stub costs nothing.
+
+import (
+	"bufio"
+	"bytes"
+	"encoding/hex"
+	"flag"
+	"fmt"
+	"io"
+	"log"
+	"net"
+	"os"
+	"strconv"
+	"strings"
+	"sync/atomic"
+
+	"github.com/strickyak/doing_os9/gomar/sym"
+)
+
+var FlagGdb = flag.String("gdb", "", "Wait for a gdb remote connection on this host:port or unix socket path")
+
+var GdbAttached bool
+
+var gdbConn net.Conn
+var gdbPackets chan string
+var gdbStepping bool
+var gdbInterrupt int32 // Set to 1 by the reader on ^C.
+var gdbWatchHit = -1   // Logical address, after a Z2 hit.
+
+const gdbTargetXml = `<?xml version="1.0"?>
+<!DOCTYPE target SYSTEM "gdb-target.dtd">
+<target version="1.0">
+<feature name="org.gnu.gdb.m6809.core">
+<reg name="cc" bitsize="8" regnum="0"/>
+<reg name="a" bitsize="8"/>
+<reg name="b" bitsize="8"/>
+<reg name="dp" bitsize="8"/>
+<reg name="x" bitsize="16" type="data_ptr"/>
+<reg name="y" bitsize="16" type="data_ptr"/>
+<reg name="u" bitsize="16" type="data_ptr"/>
+<reg name="s" bitsize="16" type="data_ptr"/>
+<reg name="pc" bitsize="16" type="code_ptr"/>
+</feature>
+</target>
+`
+
+func InitGdb() {
+	if *FlagGdb == "" {
+		return
+	}
+	network := "tcp"
+	if strings.HasPrefix(*FlagGdb, "/") || !strings.Contains(*FlagGdb, ":") {
+		network = "unix"
+		os.Remove(*FlagGdb)
+	}
+	ln, err := net.Listen(network, *FlagGdb)
+	if err != nil {
+		log.Fatalf("gdb: cannot listen: %v", err)
+	}
+	log.Printf("gdb: waiting on %s %s", network, *FlagGdb)
+	conn, err := ln.Accept()
+	if err != nil {
+		log.Fatalf("gdb: cannot accept: %v", err)
+	}
+	ln.Close()
+	log.Printf("gdb: attached from %v", conn.RemoteAddr())
+
+	gdbConn = conn
+	gdbPackets = make(chan string)
+	go gdbReader(bufio.NewReader(conn), gdbPackets)
+	GdbAttached = true
+	Breakpoints = true // So BreakCheck runs every step.
+	gdbStepping = true // Stop before the first step.
+}
+
+// gdbReader sends packets from r to ch, and notes ^C.
+func gdbReader(r *bufio.Reader, ch chan string) {
+	defer close(ch)
+	for {
+		c, err := r.ReadByte()
+		if err != nil {
+			if err != io.EOF {
+				log.Printf("gdb: %v", err)
+			}
+			return
+		}
+		switch c {
+		case 3:
+			atomic.StoreInt32(&gdbInterrupt, 1)
+		case '$':
+			body, err := r.ReadString('#')
+			if err != nil {
+				return
+			}
+			var sum [2]byte
+			if _, err := io.ReadFull(r, sum[:]); err != nil {
+				return
+			}
+			body = body[:len(body)-1]
+			want, _ := strconv.ParseUint(string(sum[:]), 16, 8)
+			if byte(want) != gdbChecksum(body) {
+				gdbConn.Write([]byte("-"))
+				continue
+			}
+			gdbConn.Write([]byte("+"))
+			ch <- body
+		}
+	}
+}
+
+func gdbChecksum(s string) byte {
+	var sum byte
+	for i := 0; i < len(s); i++ {
+		sum += s[i]
+	}
+	return sum
+}
+
+func gdbSend(s string) {
+	if _, err := fmt.Fprintf(gdbConn, "$%s#%02x", s, gdbChecksum(s)); err != nil {
+		log.Printf("gdb: %v", err)
+	}
+}
+
+// GdbCheck is called by BreakCheck before each step; hit says
+// the PC is at a gdb breakpoint.
+func GdbCheck(hit bool) {
+	switch {
+	case atomic.SwapInt32(&gdbInterrupt, 0) != 0:
+		gdbStop(2) // SIGINT
+	case hit || gdbStepping || gdbWatchHit >= 0:
+		gdbStop(5) // SIGTRAP
+	}
+}
+
+// gdbStop reports a stop and serves the debugger until it resumes.
+func gdbStop(signal int) {
+	gdbStepping = false
+	reply := F("T%02x", signal)
+	if gdbWatchHit >= 0 {
+		reply += F("watch:%x;", gdbWatchHit)
+		gdbWatchHit = -1
+	}
+	gdbSend(reply)
+
+	for body := range gdbPackets {
+		if body == "" {
+			gdbSend("")
+			continue
+		}
+		switch body[0] {
+		case 'c':
+			gdbResumeAt(body[1:])
+			return
+		case 's':
+			gdbResumeAt(body[1:])
+			gdbStepping = true
+			return
+		case 'D':
+			gdbSend("OK")
+			gdbDetach()
+			return
+		case 'k':
+			log.Printf("gdb: killed")
+			Done()
+		default:
+			gdbSend(gdbCommand(body))
+		}
+	}
+	log.Printf("gdb: connection closed")
+	gdbDetach()
+}
+
+func gdbResumeAt(addr string) {
+	if addr != "" {
+		if x, err := strconv.ParseUint(addr, 16, 16); err == nil {
+			pcreg = Word(x)
+		}
+	}
+}
+
+func gdbDetach() {
+	gdbConn.Close()
+	GdbAttached = false
+	var kept []*place
+	for _, p := range breakPlaces {
+		if !p.Gdb {
+			kept = append(kept, p)
+		}
+	}
+	breakPlaces = kept
+	kept = nil
+	for _, p := range watchPlaces {
+		if !p.Gdb {
+			kept = append(kept, p)
+		}
+	}
+	watchPlaces = kept
+	rebuildBits()
+	Breakpoints = len(breakPlaces) > 0
+	Watchpoints = len(watchPlaces) > 0
+}
+
+// gdbCommand answers every packet but c, s, D, and k.
+func gdbCommand(body string) string {
+	switch body[0] {
+	case '?':
+		return "S05"
+	case 'g':
+		return gdbRegs()
+	case 'G':
+		bb, err := hex.DecodeString(body[1:])
+		if err != nil || len(bb) < 14 {
+			return "E01"
+		}
+		SetCC(bb[0])
+		dreg = HiLo(bb[1], bb[2])
+		dpreg = bb[3]
+		for i, r := range []*Word{&xreg, &yreg, &ureg, &sreg, &pcreg} {
+			*r = HiLo(bb[4+2*i], bb[5+2*i])
+		}
+		return "OK"
+	case 'p':
+		n, err := strconv.ParseUint(body[1:], 16, 8)
+		if err != nil || n > 8 {
+			return "E01"
+		}
+		regs := gdbRegs()
+		if n < 4 {
+			return regs[2*n : 2*n+2]
+		}
+		return regs[8+4*(n-4) : 12+4*(n-4)]
+	case 'P':
+		var n int
+		var v uint64
+		if _, err := fmt.Sscanf(body[1:], "%x=%x", &n, &v); err != nil {
+			return "E01"
+		}
+		switch n {
+		case 0:
+			SetCC(byte(v))
+		case 1:
+			PutAReg(byte(v))
+		case 2:
+			PutBReg(byte(v))
+		case 3:
+			dpreg = byte(v)
+		case 4, 5, 6, 7, 8:
+			*[]*Word{&xreg, &yreg, &ureg, &sreg, &pcreg}[n-4] = Word(v)
+		default:
+			return "E01"
+		}
+		return "OK"
+	case 'm':
+		var addr, n int
+		if _, err := fmt.Sscanf(body[1:], "%x,%x", &addr, &n); err != nil {
+			return "E01"
+		}
+		var bb bytes.Buffer
+		for i := 0; i < n; i++ {
+			fmt.Fprintf(&bb, "%02x", PeekB(Word(addr+i)))
+		}
+		return bb.String()
+	case 'M':
+		var addr, n int
+		colon := strings.IndexByte(body, ':')
+		if colon < 0 {
+			return "E01"
+		}
+		if _, err := fmt.Sscanf(body[1:colon], "%x,%x", &addr, &n); err != nil {
+			return "E01"
+		}
+		bb, err := hex.DecodeString(body[colon+1:])
+		if err != nil || len(bb) != n {
+			return "E01"
+		}
+		for i, b := range bb {
+			PokeB(Word(addr+i), b)
+		}
+		return "OK"
+	case 'Z', 'z':
+		var kind, addr, size int
+		if _, err := fmt.Sscanf(body[1:], "%d,%x,%x", &kind, &addr, &size); err != nil {
+			return "E01"
+		}
+		if kind > 2 {
+			return "" // No read or access watchpoints.
+		}
+		gdbPoint(body[0] == 'Z', kind, Word(addr))
+		return "OK"
+	case 'q':
+		return gdbQuery(body)
+	}
+	return ""
+}
+
+func gdbRegs() string {
+	return F("%02x%02x%02x%02x%04x%04x%04x%04x%04x", CC(), GetAReg(), GetBReg(), dpreg, xreg, yreg, ureg, sreg, pcreg)
+}
+
+// gdbPoint inserts or removes a breakpoint (kinds 0, 1) or a write
+// watchpoint (kind 2) at logical addr.
+func gdbPoint(insert bool, kind int, addr Word) {
+	places, spec := &breakPlaces, F("gdb:%04x", addr)
+	if kind == 2 {
+		places = &watchPlaces
+	}
+	if insert {
+		*places = append(*places, &place{Spec: spec, Phys: []int{MapAddr(addr, true)}, Gdb: true})
+	} else {
+		for i, p := range *places {
+			if p.Gdb && p.Spec == spec {
+				*places = append((*places)[:i:i], (*places)[i+1:]...)
+				break
+			}
+		}
+	}
+	rebuildBits()
+	Watchpoints = len(watchPlaces) > 0
+}
+
+func gdbQuery(body string) string {
+	switch {
+	case strings.HasPrefix(body, "qSupported"):
+		return "PacketSize=1000;qXfer:features:read+"
+	case body == "qAttached":
+		return "1"
+	case strings.HasPrefix(body, "qXfer:features:read:target.xml:"):
+		var off, n int
+		if _, err := fmt.Sscanf(body[len("qXfer:features:read:target.xml:"):], "%x,%x", &off, &n); err != nil {
+			return "E01"
+		}
+		if off >= len(gdbTargetXml) {
+			return "l"
+		}
+		if off+n >= len(gdbTargetXml) {
+			return "l" + gdbTargetXml[off:]
+		}
+		return "m" + gdbTargetXml[off:off+n]
+	case strings.HasPrefix(body, "qRcmd,"):
+		cmd, err := hex.DecodeString(body[len("qRcmd,"):])
+		if err != nil {
+			return "E01"
+		}
+		out := gdbMonitor(strings.TrimSpace(string(cmd)))
+		return hex.EncodeToString([]byte(out))
+	}
+	return ""
+}
+
+// gdbMonitor runs a "monitor" command, returning what it logs.
+func gdbMonitor(cmd string) (out string) {
+	var bb bytes.Buffer
+	log.SetOutput(&bb)
+	defer func() {
+		log.SetOutput(os.Stderr)
+		if r := recover(); r != nil {
+			fmt.Fprintf(&bb, "monitor %s: %v\n", cmd, r)
+		}
+		out = bb.String()
+	}()
+	switch cmd {
+	case "mmu":
+		log.Printf("%s", ExplainMMU())
+	case "procs":
+		if SysMemW(sym.D_PrcDBT) == 0 {
+			log.Printf("no process table yet")
+			break
+		}
+		DoDumpProcesses()
+	case "paths":
+		DoDumpAllPathDescs()
+	case "regs":
+		log.Printf("pc=%04x d=%04x %s", pcreg, dreg, Regs())
+	default:
+		log.Printf("monitor commands: mmu procs paths regs")
+	}
+	return
+}
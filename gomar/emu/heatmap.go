@@ -0,0 +1,134 @@
+package emu
+
+// Memory heatmap.  With -heatmap=FILE, B and PutB count reads and
+// writes per physical 256-byte page and per MMU task, and W and PutW
+// count word accesses that straddle two 8K logical blocks.  At exit
+// FILE gets a report: the totals, each 8K physical block with its
+// counts, its OS9 block map flags and MMU slots (see BlockLabel), and
+// the modules in it, then the hottest pages.
+
+import (
+	"bufio"
+	"flag"
+	"fmt"
+	"log"
+	"os"
+	"sort"
+	"strings"
+)
+
+var FlagHeatmap = flag.String("heatmap", "", "Write memory reads and writes by physical block and page to this file")
+var FlagHeatmapPages = flag.Int("heatmap_pages", 40, "How many of the hottest pages to list in the -heatmap report")
+
+var Heatmap bool // Counting memory accesses.
+
+var heatReads, heatWrites [len(mem) / 256]uint64
+var heatTask [2][2]uint64 // [MmuTask][write]
+var heatStraddle [2]uint64
+
+func InitHeatmap() {
+	Heatmap = *FlagHeatmap != ""
+}
+
+func HeatRead(phys int) {
+	heatReads[(phys>>8)&(len(heatReads)-1)]++
+	heatTask[MmuTask&1][0]++
+}
+
+func HeatWrite(phys int) {
+	heatWrites[(phys>>8)&(len(heatWrites)-1)]++
+	heatTask[MmuTask&1][1]++
+}
+
+// HeatWord counts a word access at logical addr that straddles blocks.
+func HeatWord(addr Word) {
+	if (addr & 0x1FFF) == 0x1FFF {
+		heatStraddle[MmuTask&1]++
+	}
+}
+
+const heatPagesPerBlock = 0x2000 / 256
+
+func WriteHeatmap() {
+	if !Heatmap {
+		return
+	}
+	f, err := os.Create(*FlagHeatmap)
+	if err != nil {
+		log.Panicf("cannot create -heatmap file: %v", err)
+	}
+	defer f.Close()
+	w := bufio.NewWriter(f)
+
+	// Modules by 256-byte page.
+	pageMods := make(map[int][]string)
+	ModuleRegions(func(r ModRegion) bool {
+		id := strings.ToLower(r.Id())
+		for page := r.Phys >> 8; page <= (r.Phys+r.Size-1)>>8; page++ {
+			if mods := pageMods[page]; len(mods) == 0 || mods[len(mods)-1] != id {
+				pageMods[page] = append(mods, id)
+			}
+		}
+		return false
+	})
+
+	var total uint64
+	for i := range heatReads {
+		total += heatReads[i] + heatWrites[i]
+	}
+	for task, rw := range heatTask {
+		fmt.Fprintf(w, "task %d: %d reads, %d writes, %d words straddling 8K blocks\n", task, rw[0], rw[1], heatStraddle[task])
+	}
+
+	fmt.Fprintf(w, "\n%5s %12s %12s %6s  %s\n", "block", "reads", "writes", "%", "label; modules")
+	for block := 0; block < len(heatReads)/heatPagesPerBlock; block++ {
+		var reads, writes uint64
+		seen := make(map[string]bool)
+		var mods []string
+		for page := block * heatPagesPerBlock; page < (block+1)*heatPagesPerBlock; page++ {
+			reads += heatReads[page]
+			writes += heatWrites[page]
+			for _, m := range pageMods[page] {
+				if !seen[m] {
+					seen[m] = true
+					mods = append(mods, m)
+				}
+			}
+		}
+		if reads+writes == 0 && len(mods) == 0 {
+			continue
+		}
+		fmt.Fprintf(w, "  $%02x %12d %12d %6.2f  %s; %s\n", block, reads, writes, heatPercent(reads+writes, total), strings.TrimSpace(BlockLabel(block)), strings.Join(mods, " "))
+	}
+
+	pages := make([]int, len(heatReads))
+	for i := range pages {
+		pages[i] = i
+	}
+	sort.SliceStable(pages, func(i, j int) bool {
+		return heatReads[pages[i]]+heatWrites[pages[i]] > heatReads[pages[j]]+heatWrites[pages[j]]
+	})
+	fmt.Fprintf(w, "\n%7s %12s %12s %6s  %s\n", "page", "reads", "writes", "%", "modules")
+	if *FlagHeatmapPages < len(pages) {
+		pages = pages[:*FlagHeatmapPages]
+	}
+	for _, page := range pages {
+		n := heatReads[page] + heatWrites[page]
+		if n == 0 {
+			break
+		}
+		fmt.Fprintf(w, "$%06x %12d %12d %6.2f  %s\n", page<<8, heatReads[page], heatWrites[page], heatPercent(n, total), strings.Join(pageMods[page], " "))
+	}
+
+	if err := w.Flush(); err != nil {
+		log.Panicf("cannot write -heatmap file: %v", err)
+	}
+	log.Printf("heatmap: wrote %q", *FlagHeatmap)
+}
+
+func heatPercent(n, total uint64) float64 {
+	if total == 0 {
+		return 0
+	}
+	return 100 * float64(n) / float64(total)
+}
@@ -20,7 +20,7 @@ func Nice(ch byte) byte {
 func ShowRegs() {
 	if HyperPrinting {
 		fmt.Printf(" REGS{ cc:%02x dp:%02x d:%04x x:%04x y:%04x u:%04x s:%04x pc:%04x }\n",
-			ccreg, dpreg, dreg, xreg, yreg, ureg, sreg, pcreg)
+			CC(), dpreg, dreg, xreg, yreg, ureg, sreg, pcreg)
 	}
 }
 
@@ -83,6 +83,7 @@ func CheckWanted() {
 }
 
 func Done() {
+	ExitReports()
 	log.Printf("Done: Exiting 0.")
 	os.Exit(0)
 }
@@ -242,6 +243,7 @@ func HyperOp(hop byte) {
 		}
 
 	case 107: // Exit
+		ExitReports()
 		log.Printf("*** GOMAR Hyper Exit: %d", dreg)
 		fmt.Printf("*** GOMAR Hyper Exit: %d\n", dreg)
 		os.Exit(int(dreg))
@@ -303,6 +305,14 @@ func HyperOp(hop byte) {
 	case 131:
 		log_X_D()
 
+	case 140: // Snapshot screen (headless display)
+		if Disp != nil {
+			Disp.Snapshot()
+		}
+
+	case 141: // Write -stats counts so far
+		WriteStats()
+
 	default:
 		log.Printf("Unknown HyperOp $%x = $d.", hop, hop)
 	}
@@ -0,0 +1,306 @@
+package emu
+
+// Scripted keystrokes, for interactive-style regression runs.
+//
+// A -keys script has one command per line:
+//
+//	# comment
+//	type TEXT        press the keys of TEXT (Go escapes like \r allowed)
+//	line TEXT        type TEXT, then ENTER
+//	key CHORD ...    press chords: enter clear break up down left right
+//	                 f1 f2 space ctrl-X shift-X
+//	sleep DURATION   wait, in wall time, e.g. 250ms
+//	wait REGEXP      wait for terminal output matching REGEXP
+//	paste TEXT       queue TEXT as one line for the paste fast path
+//	pastefile FILE   queue every line of FILE for the paste fast path
+//	exit             end input, which stops the emulator
+//
+// Typed keys go through the keyboard matrix at one key per two IRQs,
+// as if someone were typing.  Pasted lines skip the keyboard: when the
+// guest calls I$ReadLn on a terminal path, the call is completed at once
+// from the paste queue (see PasteReadLn), so kilobytes go in quickly.
+// A ReadLn that was already waiting in SCF when the line was queued
+// never sees the queue, so if one is waiting and the queue makes no
+// progress for pasteStall, the line at its head is typed instead (see
+// pasteFeeder).
+// When the script ends, it waits up to -keys_timeout for the paste
+// queue to drain, then ends input, which stops the emulator as at the
+// end of stdin.
+
+import (
+	"bufio"
+	"bytes"
+	"flag"
+	"fmt"
+	"log"
+	"os"
+	"regexp"
+	"strconv"
+	"strings"
+	"sync"
+	"sync/atomic"
+	"time"
+)
+
+var FlagKeyScript = flag.String("keys", "", "Script of keystrokes, waits, and pastes to use instead of stdin")
+var FlagKeyScriptTimeout = flag.Duration("keys_timeout", 60*time.Second, "Give up if a -keys wait takes longer than this")
+
+var scriptMu sync.Mutex
+var scriptOutput bytes.Buffer // Terminal output not yet consumed by a wait.
+var scriptOutputCond = sync.NewCond(&scriptMu)
+var pasteQueue [][]byte
+var pasteTaken int // Lines or parts of lines taken by PasteReadLn.
+
+// readLnWaiting is 1 from a terminal I$ReadLn that PasteReadLn left
+// to SCF until an I$ReadLn returns (see PasteReadLnReturned).
+var readLnWaiting int32
+
+// keysMu keeps the script and pasteFeeder from typing at once.
+var keysMu sync.Mutex
+
+const pasteStall = 250 * time.Millisecond
+
+// TapOutput shows terminal output to a running -keys script.
+func TapOutput(s string) {
+	if *FlagKeyScript == "" {
+		return
+	}
+	scriptMu.Lock()
+	scriptOutput.WriteString(s)
+	scriptMu.Unlock()
+	scriptOutputCond.Broadcast()
+}
+
+// PasteReadLn completes an I$ReadLn on a terminal path from the paste
+// queue, bypassing SCF and the keyboard.  It returns false to let OS9
+// handle the call normally.
+func PasteReadLn() bool {
+	if *FlagKeyScript == "" || !IsTermPath(GetAReg()) {
+		return false
+	}
+	scriptMu.Lock()
+	if len(pasteQueue) == 0 || yreg == 0 {
+		scriptMu.Unlock()
+		atomic.StoreInt32(&readLnWaiting, 1) // SCF waits for keys.
+		return false
+	}
+	line := pasteQueue[0]
+	n := len(line)
+	if n > int(yreg) {
+		n = int(yreg)
+		pasteQueue[0] = line[n:]
+	} else {
+		pasteQueue = pasteQueue[1:]
+	}
+	pasteTaken++
+	scriptMu.Unlock()
+
+	for i := 0; i < n; i++ {
+		PutB(xreg+Word(i), line[i])
+	}
+	yreg = Word(n)
+	CLC() // carry bit indicates error
+
+	// Echo, as SCF would.
+	echo := strings.ReplaceAll(string(line[:n]), "\r", "\n")
+	fmt.Printf("%s", echo)
+	TapOutput(echo)
+	L("PasteReadLn: %q", line[:n])
+	return true
+}
+
+// PasteReadLnReturned is called by rti on return from an I$ReadLn.
+func PasteReadLnReturned() {
+	atomic.StoreInt32(&readLnWaiting, 0)
+}
+
+var chordNames = map[string]byte{
+	"enter": '\r',
+	"clear": 0200,
+	"break": 033,
+	"esc":   033,
+	"f1":    0201,
+	"f2":    0202,
+	"up":    0204,
+	"down":  0205,
+	"left":  0206,
+	"right": 0207,
+	"space": ' ',
+}
+
+func parseChord(chord string) byte {
+	if b, ok := chordNames[strings.ToLower(chord)]; ok {
+		return b
+	}
+	switch {
+	case len(chord) == 6 && strings.HasPrefix(strings.ToLower(chord), "ctrl-"):
+		return chord[5] & 31 // keypress holds CTRL for these.
+	case len(chord) == 7 && strings.HasPrefix(strings.ToLower(chord), "shift-"):
+		if i := strings.IndexByte(KB_NORMAL, chord[6]); i >= 0 && KB_SHIFT[i] != '.' {
+			return KB_SHIFT[i]
+		}
+	case len(chord) == 1:
+		return chord[0]
+	}
+	log.Fatalf("-keys: unknown key chord %q", chord)
+	panic(0)
+}
+
+func unescape(s string) string {
+	u, err := strconv.Unquote(`"` + strings.ReplaceAll(s, `"`, `\"`) + `"`)
+	if err != nil {
+		log.Fatalf("-keys: bad escapes in %q: %v", s, err)
+	}
+	return u
+}
+
+// scriptWait blocks until pattern matches the terminal output seen
+// since the last wait, then consumes the output through the match.
+func scriptWait(pattern *regexp.Regexp) {
+	deadline := time.Now().Add(*FlagKeyScriptTimeout)
+	timer := time.AfterFunc(*FlagKeyScriptTimeout, scriptOutputCond.Broadcast)
+	defer timer.Stop()
+
+	scriptMu.Lock()
+	defer scriptMu.Unlock()
+	for {
+		if loc := pattern.FindIndex(scriptOutput.Bytes()); loc != nil {
+			scriptOutput.Next(loc[1])
+			return
+		}
+		if time.Now().After(deadline) {
+			log.Fatalf("-keys: timed out waiting for %q; got %q", pattern, scriptOutput.String())
+		}
+		scriptOutputCond.Wait()
+	}
+}
+
+func pasteDrained() bool {
+	scriptMu.Lock()
+	defer scriptMu.Unlock()
+	return len(pasteQueue) == 0
+}
+
+// pasteFeeder types the line at the head of the paste queue when an
+// I$ReadLn is waiting in SCF and PasteReadLn has taken nothing for
+// pasteStall, as when the ReadLn began before the line was queued.
+// Later lines go by the fast path again, as the next ReadLn finds them.
+func pasteFeeder(keystrokes chan<- byte, stop <-chan struct{}) {
+	ticker := time.NewTicker(pasteStall)
+	defer ticker.Stop()
+	lastTaken, lastLen := -1, 0
+	for {
+		select {
+		case <-stop:
+			return
+		case <-ticker.C:
+		}
+		scriptMu.Lock()
+		if len(pasteQueue) == 0 || pasteTaken != lastTaken || len(pasteQueue) != lastLen ||
+			atomic.LoadInt32(&readLnWaiting) == 0 {
+			lastTaken, lastLen = pasteTaken, len(pasteQueue)
+			scriptMu.Unlock()
+			continue
+		}
+		line := pasteQueue[0]
+		pasteQueue = pasteQueue[1:]
+		lastLen = len(pasteQueue)
+		scriptMu.Unlock()
+
+		L("-keys: paste stalled; typing %q", line)
+		keysMu.Lock()
+		for _, ch := range line {
+			keystrokes <- ch
+		}
+		keysMu.Unlock()
+		atomic.StoreInt32(&readLnWaiting, 0) // That ReadLn is served.
+	}
+}
+
+func RunKeyScript(filename string, keystrokes chan<- byte) {
+	f, err := os.Open(filename)
+	if err != nil {
+		log.Fatalf("-keys: %v", err)
+	}
+	defer f.Close()
+
+	stop := make(chan struct{})
+	feederDone := make(chan struct{})
+	go func() {
+		pasteFeeder(keystrokes, stop)
+		close(feederDone)
+	}()
+	closeKeys := func() {
+		close(stop)
+		<-feederDone
+		close(keystrokes)
+	}
+
+	in := bufio.NewScanner(f)
+	for lineNum := 1; in.Scan(); lineNum++ {
+		text := strings.TrimSpace(in.Text())
+		if text == "" || text[0] == '#' {
+			continue
+		}
+		cmd, arg, _ := strings.Cut(text, " ")
+		arg = strings.TrimSpace(arg)
+		L("-keys %d: %s %q", lineNum, cmd, arg)
+
+		switch cmd {
+		case "type", "line":
+			keysMu.Lock()
+			for _, ch := range []byte(unescape(arg)) {
+				keystrokes <- ch
+			}
+			if cmd == "line" {
+				keystrokes <- '\r'
+			}
+			keysMu.Unlock()
+		case "key":
+			keysMu.Lock()
+			for _, chord := range strings.Fields(arg) {
+				keystrokes <- parseChord(chord)
+			}
+			keysMu.Unlock()
+		case "sleep":
+			d, err := time.ParseDuration(arg)
+			if err != nil {
+				log.Fatalf("-keys line %d: %v", lineNum, err)
+			}
+			time.Sleep(d)
+		case "wait":
+			scriptWait(regexp.MustCompile(arg))
+		case "paste":
+			scriptMu.Lock()
+			pasteQueue = append(pasteQueue, []byte(unescape(arg)+"\r"))
+			scriptMu.Unlock()
+		case "pastefile":
+			data, err := os.ReadFile(arg)
+			if err != nil {
+				log.Fatalf("-keys line %d: %v", lineNum, err)
+			}
+			scriptMu.Lock()
+			for _, s := range strings.SplitAfter(string(data), "\n") {
+				if s != "" {
+					pasteQueue = append(pasteQueue, []byte(strings.TrimRight(s, "\r\n")+"\r"))
+				}
+			}
+			scriptMu.Unlock()
+		case "exit":
+			log.Printf("-keys: exit at line %d", lineNum)
+			closeKeys()
+			return
+		default:
+			log.Fatalf("-keys line %d: unknown command %q", lineNum, cmd)
+		}
+	}
+	deadline := time.Now().Add(*FlagKeyScriptTimeout)
+	for !pasteDrained() {
+		if time.Now().After(deadline) {
+			scriptMu.Lock()
+			log.Fatalf("-keys: timed out with %d pasted lines not read", len(pasteQueue))
+		}
+		time.Sleep(10 * time.Millisecond)
+	}
+	closeKeys()
+}
@@ -12,6 +12,10 @@ import (
 var flagN = flag.Bool("n", false, "Disable reading keystrokes from stdin")
 
 func InputRoutine(keystrokes chan<- byte) {
+	if *FlagKeyScript != "" {
+		RunKeyScript(*FlagKeyScript, keystrokes)
+		return
+	}
 	if *flagN {
 		return
 	}
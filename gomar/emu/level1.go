@@ -27,31 +27,63 @@ func MemoryModuleOf(addr Word) (string, Word) {
 		return "NOTYET", addr
 	}
 
-	var buf bytes.Buffer
 	for i := start; i < limit; i += 4 {
 		mod := W(i)
 		if mod != 0 {
 			size := W(mod + 2)
 			if mod < addr && addr < mod+size {
-				cp := mod + W(mod+4)
-				for {
-					b := B(cp)
-					ch := 127 & b
-					if '!' <= ch && ch <= '~' {
-						buf.WriteByte(ch)
-					}
-					if (b & 128) != 0 {
-						h1, h2, h3 := B(mod+size-3), B(mod+size-2), B(mod+size-1)
-						return F("%s.%04x%02x%02x%02x", buf.String(), size, h1, h2, h3), addr - mod
-					}
-					cp++
-				}
+				return ModuleIdAt(mod), addr - mod
 			}
 		}
 	}
 	return "UNFOUND", addr
 }
 
+// ModuleIdAt is the name, size, and CRC of the module at mod.
+func ModuleIdAt(mod Word) string {
+	var buf bytes.Buffer
+	size := W(mod + 2)
+	cp := mod + W(mod+4)
+	for {
+		b := B(cp)
+		ch := 127 & b
+		if '!' <= ch && ch <= '~' {
+			buf.WriteByte(ch)
+		}
+		if (b & 128) != 0 {
+			h1, h2, h3 := B(mod+size-3), B(mod+size-2), B(mod+size-1)
+			return F("%s.%04x%02x%02x%02x", buf.String(), size, h1, h2, h3)
+		}
+		cp++
+	}
+}
+
+// BlockLabel describes a physical 8K block for the -heatmap report.
+// Level 1 has no block map.
+func BlockLabel(block int) string { return "" }
+
+// ModuleRegions calls fn on each module in the module directory,
+// until fn returns true.  Level 1 has no MMU, so each module is one
+// region.
+func ModuleRegions(fn func(r ModRegion) bool) string {
+	start := W(0x26)
+	limit := W(0x28)
+
+	if start != 0x300 || limit != 0x400 {
+		return "NOTYET"
+	}
+
+	for i := start; i < limit; i += 4 {
+		if mod := W(i); mod != 0 {
+			id := func() string { return ModuleIdAt(mod) }
+			if fn(ModRegion{Id: id, Phys: MapAddr(mod, true), Size: int(W(mod + 2))}) {
+				break
+			}
+		}
+	}
+	return ""
+}
+
 func ScanModDir() {
 	// In Level1, it is $300 to $400. ( pointed by DP+$26 and DP+$28 end )
 	// That's 64 entries, so 4 bytes per entry.
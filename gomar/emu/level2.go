@@ -4,6 +4,7 @@ package emu
 
 import (
 	"bytes"
+	"fmt"
 	"log"
 
 	"github.com/strickyak/doing_os9/gomar/sym"
@@ -62,6 +63,46 @@ func DoDumpSysMap() {
 	}
 }
 
+// BlockLabel describes physical 8K block for the -heatmap report:
+// its D.BlkMap flags, the task/slot pairs mapping it, and, when the
+// system task maps it, how many of its pages D.SysMem has in use.
+func BlockLabel(block int) string {
+	var bb bytes.Buffer
+	blkMap, blkEnd := SysMemW(sym.D_BlkMap), SysMemW(sym.D_BlkMap+2)
+	if blkMap != 0 && int(blkMap)+block < int(blkEnd) {
+		flags := SysMemB(blkMap + Word(block))
+		switch {
+		case flags == 0:
+			bb.WriteString("free")
+		case (flags & 0x80) != 0:
+			bb.WriteString("notram")
+		case (flags & 2) != 0:
+			bb.WriteString("module")
+		default:
+			bb.WriteString("used")
+		}
+	}
+	sysMem := SysMemW(sym.D_SysMem)
+	for task := range MmuMap {
+		for slot, phys := range MmuMap[task] {
+			if int(phys) != block {
+				continue
+			}
+			fmt.Fprintf(&bb, " t%ds%d", task, slot)
+			if task == 0 && sysMem != 0 {
+				used := 0
+				for i := Word(0); i < 32; i++ {
+					if SysMemB(sysMem+Word(slot)*32+i) != 0 {
+						used++
+					}
+				}
+				fmt.Fprintf(&bb, "(%d/32)", used)
+			}
+		}
+	}
+	return bb.String()
+}
+
 func DoDumpPageZero() {
 	saved_mmut := MmuTask
 	MmuTask = 0
@@ -231,19 +272,35 @@ func MemoryModuleOf(addr Word) (name string, offset Word) {
 	}
 
 	addrPhys := MapAddr(addr, true)
-	addr32 := uint32(addrPhys)
+	bad := ModuleRegions(func(r ModRegion) bool {
+		if r.Phys <= addrPhys && addrPhys < r.Phys+r.Size {
+			name, offset = r.Id(), r.Offset+Word(addrPhys-r.Phys)
+			return true
+		}
+		return false
+	})
+	if bad != "" {
+		return bad, addr
+	}
+	return name, offset // "", 0 if no module found for the addr.
+}
 
+// ModuleRegions calls fn on each region of each module in memory,
+// first the initial modules, then the module directory, until fn
+// returns true.  It returns a marker like "==" if it finds the module
+// directory unusable.
+func ModuleRegions(fn func(r ModRegion) bool) string {
 	// First scan for initial modules.
 	for _, m := range InitialModules {
-		if addr32 >= m.Addr && addr32 < (m.Addr+m.Len) {
-			return m.Id(), Word(addr32 - m.Addr)
+		if fn(ModRegion{Id: m.Id, Phys: int(m.Addr), Size: int(m.Len)}) {
+			return ""
 		}
 	}
 
 	modDirStart := SysMemW(sym.D_ModDir)
 	modDirLimit := SysMemW(sym.D_ModEnd)
 	if modDirStart == 0 || modDirLimit == 0 {
-		return "==", addr
+		return "=="
 	}
 	for i := modDirStart; i < modDirLimit; i += 8 {
 		datPtr := SysMemW(i + 0)
@@ -260,18 +317,13 @@ func MemoryModuleOf(addr Word) (name string, offset Word) {
 		m := GetMapping(datPtr)
 		magic := PeekWWithMapping(begin, m)
 		if magic != 0x87CD {
-			return "====", addr
+			return "===="
 		}
 		// log.Printf("DDT: TRY i=%x begin=%x %q .....", i, begin, ModuleId(begin, m))
 
 		// Module offset 2 is module size.
 		remaining := int(PeekWWithMapping(begin+2, m))
-		// Module offset 4 is offset to name string.
-		//unused// namePtr := begin + PeekWWithMapping(begin+4, m)
-		// log.Printf("DDT: len=%x remaining=%x trying=%q", usedBytes, remaining, Os9StringWithMapping(namePtr, m))
-
-		//-------------
-		// beginP := MapAddrWithMapping(begin, m)
+		id := func() string { return ModuleId(begin, m) }
 
 		region := begin
 		offset := Word(0) // offset into module.
@@ -285,27 +337,17 @@ func MemoryModuleOf(addr Word) (name string, offset Word) {
 				regionSize = endOfRegionBlockP - regionP
 			}
 
-			// log.Printf("DDT: try regionP=%x (phys=%x) regionEnds=%x remain=%x", regionP, addrPhys, regionP+int(regionSize), remaining)
-			if regionP <= addrPhys && addrPhys < regionP+int(regionSize) {
-				if links == 0 {
-					// return "unlinkedMod", addr
-					// log.Panicf("in unlinked module: i=%x addr=%x", i, addr)
-				}
-				id := ModuleId(begin, m)
-				delta := offset + Word(int(addrPhys)-regionP)
-				// log.Printf("DDT: [links=%x] FOUND %q+%x", links, id, delta)
-				return id, delta
+			if fn(ModRegion{Id: id, Offset: offset, Phys: regionP, Size: regionSize}) {
+				return ""
 			}
 			remaining -= regionSize
-			regionP += regionSize
 			region += Word(regionSize)
 			offset += Word(regionSize)
-			// log.Printf("DDT: advanced remaining=%x regionSize=%x", remaining, regionSize)
 		}
 	}
-	// log.Printf("DDT: NOT FOUND")
-	return "", 0 // No module found for the addr.
+	return ""
 }
+
 func MemoryModules() {
 	WithKernelTask(func() {
 
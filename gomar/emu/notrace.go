@@ -10,9 +10,11 @@ func Trace()                    {}
 func Finish() {
 	DoDumpAllMemoryPhys()
 }
-func Dis_inst(inst string, reg string, cyclecount int)   {}
-func Dis_inst_cat(inst string, cyclecount int)           {}
-func Dis_ops(part1 string, part2 string, cyclecount int) {}
+
+// Cycles are counted even without trace, for pacing.
+func Dis_inst(inst string, reg string, cyclecount int)   { cycles += cyclecount }
+func Dis_inst_cat(inst string, cyclecount int)           { cycles += cyclecount }
+func Dis_ops(part1 string, part2 string, cyclecount int) { cycles += cyclecount }
 func Dis_reg(b byte)                                     {}
 
 func DumpAllMemory()    {}
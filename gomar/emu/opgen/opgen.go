@@ -0,0 +1,290 @@
+//go:build main
+
+// Opgen writes ops_gen.go: one handler per 6809 opcode and addressing
+// mode, so each handler knows at compile time whether its operand is
+// in a register or in memory (immediate operands are memory at PC).
+// The handlers call the op cores (negOp, addOp, ...) in emu.go.
+//
+//	cd emu && go run --tags=main opgen/opgen.go
+package main
+
+import (
+	"bytes"
+	"fmt"
+	"go/format"
+	"log"
+	"os"
+	"strings"
+)
+
+type Mode struct {
+	Suffix string
+	Addr   string // Go expression for the operand address; "" for registers.
+	Cat    string // Dis_inst_cat adjustment, if any.
+	Get    string // For register modes.
+	Put    string
+}
+
+// Modes of NEG..CLR (opcodes $00-$0F, $40-$7F).
+var rmwModes = []Mode{
+	{Suffix: "dp", Addr: "zeropage()"},
+	{Suffix: "a", Cat: `Dis_inst_cat("a", -2)`, Get: "GetAReg()", Put: "PutAReg"},
+	{Suffix: "b", Cat: `Dis_inst_cat("b", -2)`, Get: "GetBReg()", Put: "PutBReg"},
+	{Suffix: "idx", Addr: "postbyte()", Cat: `Dis_inst_cat("", 2)`},
+	{Suffix: "ext", Addr: "direct()"},
+}
+
+// Modes of the 8-bit accumulator ops (opcodes $80-$FF).
+var acc8Modes = []Mode{
+	{Suffix: "imm", Addr: "immediate()"},
+	{Suffix: "dp", Addr: "zeropage()"},
+	{Suffix: "idx", Addr: "postbyte()", Cat: `Dis_inst_cat("", 2)`},
+	{Suffix: "ext", Addr: "direct()"},
+}
+
+// Modes of the 16-bit ops (opcodes $80-$FF).
+var acc16Modes = []Mode{
+	{Suffix: "imm", Addr: "immediate2()", Cat: `Dis_inst_cat("", -1)`},
+	{Suffix: "dp", Addr: "zeropage()", Cat: `Dis_inst_cat("", -1)`},
+	{Suffix: "idx", Addr: "postbyte()", Cat: `Dis_inst_cat("", 1)`},
+	{Suffix: "ext", Addr: "direct()", Cat: `Dis_inst_cat("", -1)`},
+}
+
+var out bytes.Buffer
+
+func P(format string, args ...any) {
+	fmt.Fprintf(&out, format, args...)
+	out.WriteByte('\n')
+}
+
+func head(name string, m Mode, inst string) {
+	P("func %s_%s() {", name, m.Suffix)
+	P("\t%s", inst)
+	if m.Cat != "" {
+		P("\t%s", m.Cat)
+	}
+}
+
+// rmw: NEG, COM, LSR, ROR, ASR, ASL, ROL, DEC, INC.
+func rmw(name string) {
+	for _, m := range rmwModes {
+		P("func %s_%s() {", name, m.Suffix)
+		if name == "neg" {
+			P("\tzeroInstCheck()") // Opcode $00 is NEG, so catch running off into zeros.
+		}
+		P(`	Dis_inst(%q, "", 4)`, name)
+		if m.Cat != "" {
+			P("\t%s", m.Cat)
+		}
+		if m.Addr == "" {
+			P("\t%s(%sOp(%s))", m.Put, name, m.Get)
+		} else {
+			P("\taddr := %s", m.Addr)
+			P("\tMemPutB(addr, %sOp(MemB(addr)))", name)
+		}
+		P("}\n")
+	}
+}
+
+func tst() {
+	for _, m := range rmwModes {
+		head("tst", m, `Dis_inst("tst", "", 4)`)
+		if m.Addr == "" {
+			P("\ttstOp(%s)", m.Get)
+		} else {
+			P("\ttstOp(MemB(%s))", m.Addr)
+		}
+		P("}\n")
+	}
+}
+
+func clr() {
+	for _, m := range rmwModes {
+		head("clr", m, `Dis_inst("clr", "", 4)`)
+		if m.Addr == "" {
+			P("\t%s(clrOp())", m.Put)
+		} else {
+			P("\taddr := %s", m.Addr)
+			P("\tMemPutB(addr, clrOp())")
+		}
+		P("}\n")
+	}
+}
+
+func jmp() {
+	for _, m := range rmwModes {
+		if m.Addr == "" {
+			continue
+		}
+		P("func jmp_%s() {", m.Suffix)
+		P("\tDis_len(-pcreg)")
+		P(`	Dis_inst("jmp", "", 1)`)
+		if m.Cat != "" {
+			P("\t%s", m.Cat)
+		}
+		P("\taddr := %s", m.Addr)
+		P("\tDis_len_incr(pcreg + 1)")
+		P("\tpcreg = addr")
+		P("}\n")
+	}
+}
+
+var accs = []struct{ Name, Get, Put string }{
+	{"a", "GetAReg()", "PutAReg"},
+	{"b", "GetBReg()", "PutBReg"},
+}
+
+// acc8: SUB, SBC, AND, EOR, ADC, OR, ADD (kind "op"),
+// CMP, BIT ("test"), LD ("ld"), ST ("st").
+func acc8(name, kind string) {
+	for _, r := range accs {
+		for _, m := range acc8Modes {
+			P("func %s%s_%s() {", name, r.Name, m.Suffix)
+			P("\tDis_inst(%q, %q, 2)", name, r.Name)
+			if m.Cat != "" {
+				P("\t%s", m.Cat)
+			}
+			switch kind {
+			case "op":
+				P("\t%s(%sOp(%s, MemB(%s)))", r.Put, name, r.Get, m.Addr)
+			case "test":
+				P("\t%sOp(%s, MemB(%s))", name, r.Get, m.Addr)
+			case "ld":
+				P("\t%s(ldOp(MemB(%s)))", r.Put, m.Addr)
+			case "st":
+				P("\taddr := %s", m.Addr)
+				P("\tMemPutB(addr, stOp(%s))", r.Get)
+			}
+			P("}\n")
+		}
+	}
+}
+
+// acc16 writes the handlers of a 16-bit op, or of JSR.  kind is
+// "op" (subd, addd), "cmp", "ld", "st", or "jsr".  Ops on pages 2 and 3
+// ($10 and $11 prebytes) have their own handlers, so none of these
+// need to look at the prebyte.
+func acc16(name string, cycles int, reg, kind string) {
+	modes := acc16Modes
+	if kind == "jsr" {
+		modes = acc8Modes[1:] // jsr decodes like the 8-bit ops.
+	}
+	for _, m := range modes {
+		P("func %s_%s() {", name, m.Suffix)
+		if kind == "cmp" {
+			P("\taop := %s", reg) // Before the addressing mode can change it.
+		}
+		P("\tDis_inst(%q, \"\", %d)", name, cycles)
+		if kind == "jsr" {
+			P("\tDis_len(-pcreg)")
+		}
+		if m.Cat != "" {
+			P("\t%s", m.Cat)
+		}
+		switch kind {
+		case "op":
+			P("\t%sOp(MemW(%s))", name, m.Addr)
+		case "cmp":
+			P("\tcmp16Op(aop, MemW(%s))", m.Addr)
+		case "ld":
+			P("\t%s = ld16Op(MemW(%s))", reg, m.Addr)
+		case "st":
+			P("\taddr := %s", m.Addr)
+			P("\tMemPutW(addr, st16Op(%s))", reg)
+		case "jsr":
+			P("\taddr := %s", m.Addr)
+			P("\tDis_len_incr(pcreg + 1)")
+			P("\tPushWord(pcreg)")
+			P("\tpcreg = addr")
+		}
+		P("}\n")
+	}
+}
+
+// Conditional branches, short (page 1) and long (page 2).
+var branches = []struct{ Name, Cond string }{
+	{"bhi", "0 == (CC() & 0x05)"},
+	{"bls", "0 != CC()&0x05"},
+	{"bcc", "0 == (CC() & 0x01)"},
+	{"bcs", "0 != CC()&0x01"},
+	{"bne", "0 == (CC() & 0x04)"},
+	{"beq", "0 != CC()&0x04"},
+	{"bvc", "0 == (CC() & 0x02)"},
+	{"bvs", "0 != CC()&0x02"},
+	{"bpl", "0 == (CC() & 0x08)"},
+	{"bmi", "0 != CC()&0x08"},
+	{"bge", "!NXORV()"},
+	{"blt", "NXORV()"},
+	{"bgt", "!(NXORV() || 0 != CC()&0x04)"},
+	{"ble", "NXORV() || 0 != CC()&0x04"},
+}
+
+func branch() {
+	for _, b := range branches {
+		P("func %s() {", b.Name)
+		P("\tDis_inst(\"\", %q, 3)", b.Name)
+		P("\tbr(%s)", b.Cond)
+		P("}\n")
+		P("func l%s() {", b.Name)
+		P("\tDis_inst(\"l\", %q, 5)", b.Name)
+		P("\tlbr(%s)", b.Cond)
+		P("}\n")
+	}
+}
+
+func main() {
+	P("// Code generated by opgen/opgen.go; DO NOT EDIT.\n")
+	P("package emu\n")
+
+	for _, name := range strings.Fields("neg com lsr ror asr asl rol dec inc") {
+		rmw(name)
+	}
+	tst()
+	clr()
+	jmp()
+
+	for _, name := range strings.Fields("sub sbc and eor adc or add") {
+		acc8(name, "op")
+	}
+	acc8("cmp", "test")
+	acc8("bit", "test")
+	acc8("ld", "ld")
+	acc8("st", "st")
+
+	for _, op := range []struct {
+		Name   string
+		Cycles int
+		Reg    string
+		Kind   string
+	}{
+		{"subd", 5, "dreg", "op"},
+		{"addd", 5, "dreg", "op"},
+		{"cmpd", 5, "dreg", "cmp"}, // Page 2.
+		{"cmpx", 5, "xreg", "cmp"},
+		{"cmpy", 5, "yreg", "cmp"}, // Page 2.
+		{"cmpu", 5, "ureg", "cmp"}, // Page 3.  The old subd charged 5 twice.
+		{"cmps", 5, "sreg", "cmp"}, // Page 3.
+		{"ldd", 4, "dreg", "ld"},
+		{"ldx", 4, "xreg", "ld"},
+		{"ldy", 4, "yreg", "ld"}, // Page 2.
+		{"ldu", 4, "ureg", "ld"},
+		{"lds", 4, "sreg", "ld"}, // Page 2.
+		{"std", 4, "dreg", "st"},
+		{"stx", 4, "xreg", "st"},
+		{"sty", 4, "yreg", "st"}, // Page 2.
+		{"stu", 4, "ureg", "st"},
+		{"sts", 4, "sreg", "st"}, // Page 2.
+		{"jsr", 5, "", "jsr"},
+	} {
+		acc16(op.Name, op.Cycles, op.Reg, op.Kind)
+	}
+	branch()
+
+	src, err := format.Source(out.Bytes())
+	if err != nil {
+		log.Fatalf("format: %v\n%s", err, out.Bytes())
+	}
+	if err := os.WriteFile("ops_gen.go", src, 0644); err != nil {
+		log.Fatal(err)
+	}
+}
@@ -0,0 +1,1457 @@
+// Code generated by opgen/opgen.go; DO NOT EDIT.
+
+package emu
+
+func neg_dp() {
+	zeroInstCheck()
+	Dis_inst("neg", "", 4)
+	addr := zeropage()
+	MemPutB(addr, negOp(MemB(addr)))
+}
+
+func neg_a() {
+	zeroInstCheck()
+	Dis_inst("neg", "", 4)
+	Dis_inst_cat("a", -2)
+	PutAReg(negOp(GetAReg()))
+}
+
+func neg_b() {
+	zeroInstCheck()
+	Dis_inst("neg", "", 4)
+	Dis_inst_cat("b", -2)
+	PutBReg(negOp(GetBReg()))
+}
+
+func neg_idx() {
+	zeroInstCheck()
+	Dis_inst("neg", "", 4)
+	Dis_inst_cat("", 2)
+	addr := postbyte()
+	MemPutB(addr, negOp(MemB(addr)))
+}
+
+func neg_ext() {
+	zeroInstCheck()
+	Dis_inst("neg", "", 4)
+	addr := direct()
+	MemPutB(addr, negOp(MemB(addr)))
+}
+
+func com_dp() {
+	Dis_inst("com", "", 4)
+	addr := zeropage()
+	MemPutB(addr, comOp(MemB(addr)))
+}
+
+func com_a() {
+	Dis_inst("com", "", 4)
+	Dis_inst_cat("a", -2)
+	PutAReg(comOp(GetAReg()))
+}
+
+func com_b() {
+	Dis_inst("com", "", 4)
+	Dis_inst_cat("b", -2)
+	PutBReg(comOp(GetBReg()))
+}
+
+func com_idx() {
+	Dis_inst("com", "", 4)
+	Dis_inst_cat("", 2)
+	addr := postbyte()
+	MemPutB(addr, comOp(MemB(addr)))
+}
+
+func com_ext() {
+	Dis_inst("com", "", 4)
+	addr := direct()
+	MemPutB(addr, comOp(MemB(addr)))
+}
+
+func lsr_dp() {
+	Dis_inst("lsr", "", 4)
+	addr := zeropage()
+	MemPutB(addr, lsrOp(MemB(addr)))
+}
+
+func lsr_a() {
+	Dis_inst("lsr", "", 4)
+	Dis_inst_cat("a", -2)
+	PutAReg(lsrOp(GetAReg()))
+}
+
+func lsr_b() {
+	Dis_inst("lsr", "", 4)
+	Dis_inst_cat("b", -2)
+	PutBReg(lsrOp(GetBReg()))
+}
+
+func lsr_idx() {
+	Dis_inst("lsr", "", 4)
+	Dis_inst_cat("", 2)
+	addr := postbyte()
+	MemPutB(addr, lsrOp(MemB(addr)))
+}
+
+func lsr_ext() {
+	Dis_inst("lsr", "", 4)
+	addr := direct()
+	MemPutB(addr, lsrOp(MemB(addr)))
+}
+
+func ror_dp() {
+	Dis_inst("ror", "", 4)
+	addr := zeropage()
+	MemPutB(addr, rorOp(MemB(addr)))
+}
+
+func ror_a() {
+	Dis_inst("ror", "", 4)
+	Dis_inst_cat("a", -2)
+	PutAReg(rorOp(GetAReg()))
+}
+
+func ror_b() {
+	Dis_inst("ror", "", 4)
+	Dis_inst_cat("b", -2)
+	PutBReg(rorOp(GetBReg()))
+}
+
+func ror_idx() {
+	Dis_inst("ror", "", 4)
+	Dis_inst_cat("", 2)
+	addr := postbyte()
+	MemPutB(addr, rorOp(MemB(addr)))
+}
+
+func ror_ext() {
+	Dis_inst("ror", "", 4)
+	addr := direct()
+	MemPutB(addr, rorOp(MemB(addr)))
+}
+
+func asr_dp() {
+	Dis_inst("asr", "", 4)
+	addr := zeropage()
+	MemPutB(addr, asrOp(MemB(addr)))
+}
+
+func asr_a() {
+	Dis_inst("asr", "", 4)
+	Dis_inst_cat("a", -2)
+	PutAReg(asrOp(GetAReg()))
+}
+
+func asr_b() {
+	Dis_inst("asr", "", 4)
+	Dis_inst_cat("b", -2)
+	PutBReg(asrOp(GetBReg()))
+}
+
+func asr_idx() {
+	Dis_inst("asr", "", 4)
+	Dis_inst_cat("", 2)
+	addr := postbyte()
+	MemPutB(addr, asrOp(MemB(addr)))
+}
+
+func asr_ext() {
+	Dis_inst("asr", "", 4)
+	addr := direct()
+	MemPutB(addr, asrOp(MemB(addr)))
+}
+
+func asl_dp() {
+	Dis_inst("asl", "", 4)
+	addr := zeropage()
+	MemPutB(addr, aslOp(MemB(addr)))
+}
+
+func asl_a() {
+	Dis_inst("asl", "", 4)
+	Dis_inst_cat("a", -2)
+	PutAReg(aslOp(GetAReg()))
+}
+
+func asl_b() {
+	Dis_inst("asl", "", 4)
+	Dis_inst_cat("b", -2)
+	PutBReg(aslOp(GetBReg()))
+}
+
+func asl_idx() {
+	Dis_inst("asl", "", 4)
+	Dis_inst_cat("", 2)
+	addr := postbyte()
+	MemPutB(addr, aslOp(MemB(addr)))
+}
+
+func asl_ext() {
+	Dis_inst("asl", "", 4)
+	addr := direct()
+	MemPutB(addr, aslOp(MemB(addr)))
+}
+
+func rol_dp() {
+	Dis_inst("rol", "", 4)
+	addr := zeropage()
+	MemPutB(addr, rolOp(MemB(addr)))
+}
+
+func rol_a() {
+	Dis_inst("rol", "", 4)
+	Dis_inst_cat("a", -2)
+	PutAReg(rolOp(GetAReg()))
+}
+
+func rol_b() {
+	Dis_inst("rol", "", 4)
+	Dis_inst_cat("b", -2)
+	PutBReg(rolOp(GetBReg()))
+}
+
+func rol_idx() {
+	Dis_inst("rol", "", 4)
+	Dis_inst_cat("", 2)
+	addr := postbyte()
+	MemPutB(addr, rolOp(MemB(addr)))
+}
+
+func rol_ext() {
+	Dis_inst("rol", "", 4)
+	addr := direct()
+	MemPutB(addr, rolOp(MemB(addr)))
+}
+
+func dec_dp() {
+	Dis_inst("dec", "", 4)
+	addr := zeropage()
+	MemPutB(addr, decOp(MemB(addr)))
+}
+
+func dec_a() {
+	Dis_inst("dec", "", 4)
+	Dis_inst_cat("a", -2)
+	PutAReg(decOp(GetAReg()))
+}
+
+func dec_b() {
+	Dis_inst("dec", "", 4)
+	Dis_inst_cat("b", -2)
+	PutBReg(decOp(GetBReg()))
+}
+
+func dec_idx() {
+	Dis_inst("dec", "", 4)
+	Dis_inst_cat("", 2)
+	addr := postbyte()
+	MemPutB(addr, decOp(MemB(addr)))
+}
+
+func dec_ext() {
+	Dis_inst("dec", "", 4)
+	addr := direct()
+	MemPutB(addr, decOp(MemB(addr)))
+}
+
+func inc_dp() {
+	Dis_inst("inc", "", 4)
+	addr := zeropage()
+	MemPutB(addr, incOp(MemB(addr)))
+}
+
+func inc_a() {
+	Dis_inst("inc", "", 4)
+	Dis_inst_cat("a", -2)
+	PutAReg(incOp(GetAReg()))
+}
+
+func inc_b() {
+	Dis_inst("inc", "", 4)
+	Dis_inst_cat("b", -2)
+	PutBReg(incOp(GetBReg()))
+}
+
+func inc_idx() {
+	Dis_inst("inc", "", 4)
+	Dis_inst_cat("", 2)
+	addr := postbyte()
+	MemPutB(addr, incOp(MemB(addr)))
+}
+
+func inc_ext() {
+	Dis_inst("inc", "", 4)
+	addr := direct()
+	MemPutB(addr, incOp(MemB(addr)))
+}
+
+func tst_dp() {
+	Dis_inst("tst", "", 4)
+	tstOp(MemB(zeropage()))
+}
+
+func tst_a() {
+	Dis_inst("tst", "", 4)
+	Dis_inst_cat("a", -2)
+	tstOp(GetAReg())
+}
+
+func tst_b() {
+	Dis_inst("tst", "", 4)
+	Dis_inst_cat("b", -2)
+	tstOp(GetBReg())
+}
+
+func tst_idx() {
+	Dis_inst("tst", "", 4)
+	Dis_inst_cat("", 2)
+	tstOp(MemB(postbyte()))
+}
+
+func tst_ext() {
+	Dis_inst("tst", "", 4)
+	tstOp(MemB(direct()))
+}
+
+func clr_dp() {
+	Dis_inst("clr", "", 4)
+	addr := zeropage()
+	MemPutB(addr, clrOp())
+}
+
+func clr_a() {
+	Dis_inst("clr", "", 4)
+	Dis_inst_cat("a", -2)
+	PutAReg(clrOp())
+}
+
+func clr_b() {
+	Dis_inst("clr", "", 4)
+	Dis_inst_cat("b", -2)
+	PutBReg(clrOp())
+}
+
+func clr_idx() {
+	Dis_inst("clr", "", 4)
+	Dis_inst_cat("", 2)
+	addr := postbyte()
+	MemPutB(addr, clrOp())
+}
+
+func clr_ext() {
+	Dis_inst("clr", "", 4)
+	addr := direct()
+	MemPutB(addr, clrOp())
+}
+
+func jmp_dp() {
+	Dis_len(-pcreg)
+	Dis_inst("jmp", "", 1)
+	addr := zeropage()
+	Dis_len_incr(pcreg + 1)
+	pcreg = addr
+}
+
+func jmp_idx() {
+	Dis_len(-pcreg)
+	Dis_inst("jmp", "", 1)
+	Dis_inst_cat("", 2)
+	addr := postbyte()
+	Dis_len_incr(pcreg + 1)
+	pcreg = addr
+}
+
+func jmp_ext() {
+	Dis_len(-pcreg)
+	Dis_inst("jmp", "", 1)
+	addr := direct()
+	Dis_len_incr(pcreg + 1)
+	pcreg = addr
+}
+
+func suba_imm() {
+	Dis_inst("sub", "a", 2)
+	PutAReg(subOp(GetAReg(), MemB(immediate())))
+}
+
+func suba_dp() {
+	Dis_inst("sub", "a", 2)
+	PutAReg(subOp(GetAReg(), MemB(zeropage())))
+}
+
+func suba_idx() {
+	Dis_inst("sub", "a", 2)
+	Dis_inst_cat("", 2)
+	PutAReg(subOp(GetAReg(), MemB(postbyte())))
+}
+
+func suba_ext() {
+	Dis_inst("sub", "a", 2)
+	PutAReg(subOp(GetAReg(), MemB(direct())))
+}
+
+func subb_imm() {
+	Dis_inst("sub", "b", 2)
+	PutBReg(subOp(GetBReg(), MemB(immediate())))
+}
+
+func subb_dp() {
+	Dis_inst("sub", "b", 2)
+	PutBReg(subOp(GetBReg(), MemB(zeropage())))
+}
+
+func subb_idx() {
+	Dis_inst("sub", "b", 2)
+	Dis_inst_cat("", 2)
+	PutBReg(subOp(GetBReg(), MemB(postbyte())))
+}
+
+func subb_ext() {
+	Dis_inst("sub", "b", 2)
+	PutBReg(subOp(GetBReg(), MemB(direct())))
+}
+
+func sbca_imm() {
+	Dis_inst("sbc", "a", 2)
+	PutAReg(sbcOp(GetAReg(), MemB(immediate())))
+}
+
+func sbca_dp() {
+	Dis_inst("sbc", "a", 2)
+	PutAReg(sbcOp(GetAReg(), MemB(zeropage())))
+}
+
+func sbca_idx() {
+	Dis_inst("sbc", "a", 2)
+	Dis_inst_cat("", 2)
+	PutAReg(sbcOp(GetAReg(), MemB(postbyte())))
+}
+
+func sbca_ext() {
+	Dis_inst("sbc", "a", 2)
+	PutAReg(sbcOp(GetAReg(), MemB(direct())))
+}
+
+func sbcb_imm() {
+	Dis_inst("sbc", "b", 2)
+	PutBReg(sbcOp(GetBReg(), MemB(immediate())))
+}
+
+func sbcb_dp() {
+	Dis_inst("sbc", "b", 2)
+	PutBReg(sbcOp(GetBReg(), MemB(zeropage())))
+}
+
+func sbcb_idx() {
+	Dis_inst("sbc", "b", 2)
+	Dis_inst_cat("", 2)
+	PutBReg(sbcOp(GetBReg(), MemB(postbyte())))
+}
+
+func sbcb_ext() {
+	Dis_inst("sbc", "b", 2)
+	PutBReg(sbcOp(GetBReg(), MemB(direct())))
+}
+
+func anda_imm() {
+	Dis_inst("and", "a", 2)
+	PutAReg(andOp(GetAReg(), MemB(immediate())))
+}
+
+func anda_dp() {
+	Dis_inst("and", "a", 2)
+	PutAReg(andOp(GetAReg(), MemB(zeropage())))
+}
+
+func anda_idx() {
+	Dis_inst("and", "a", 2)
+	Dis_inst_cat("", 2)
+	PutAReg(andOp(GetAReg(), MemB(postbyte())))
+}
+
+func anda_ext() {
+	Dis_inst("and", "a", 2)
+	PutAReg(andOp(GetAReg(), MemB(direct())))
+}
+
+func andb_imm() {
+	Dis_inst("and", "b", 2)
+	PutBReg(andOp(GetBReg(), MemB(immediate())))
+}
+
+func andb_dp() {
+	Dis_inst("and", "b", 2)
+	PutBReg(andOp(GetBReg(), MemB(zeropage())))
+}
+
+func andb_idx() {
+	Dis_inst("and", "b", 2)
+	Dis_inst_cat("", 2)
+	PutBReg(andOp(GetBReg(), MemB(postbyte())))
+}
+
+func andb_ext() {
+	Dis_inst("and", "b", 2)
+	PutBReg(andOp(GetBReg(), MemB(direct())))
+}
+
+func eora_imm() {
+	Dis_inst("eor", "a", 2)
+	PutAReg(eorOp(GetAReg(), MemB(immediate())))
+}
+
+func eora_dp() {
+	Dis_inst("eor", "a", 2)
+	PutAReg(eorOp(GetAReg(), MemB(zeropage())))
+}
+
+func eora_idx() {
+	Dis_inst("eor", "a", 2)
+	Dis_inst_cat("", 2)
+	PutAReg(eorOp(GetAReg(), MemB(postbyte())))
+}
+
+func eora_ext() {
+	Dis_inst("eor", "a", 2)
+	PutAReg(eorOp(GetAReg(), MemB(direct())))
+}
+
+func eorb_imm() {
+	Dis_inst("eor", "b", 2)
+	PutBReg(eorOp(GetBReg(), MemB(immediate())))
+}
+
+func eorb_dp() {
+	Dis_inst("eor", "b", 2)
+	PutBReg(eorOp(GetBReg(), MemB(zeropage())))
+}
+
+func eorb_idx() {
+	Dis_inst("eor", "b", 2)
+	Dis_inst_cat("", 2)
+	PutBReg(eorOp(GetBReg(), MemB(postbyte())))
+}
+
+func eorb_ext() {
+	Dis_inst("eor", "b", 2)
+	PutBReg(eorOp(GetBReg(), MemB(direct())))
+}
+
+func adca_imm() {
+	Dis_inst("adc", "a", 2)
+	PutAReg(adcOp(GetAReg(), MemB(immediate())))
+}
+
+func adca_dp() {
+	Dis_inst("adc", "a", 2)
+	PutAReg(adcOp(GetAReg(), MemB(zeropage())))
+}
+
+func adca_idx() {
+	Dis_inst("adc", "a", 2)
+	Dis_inst_cat("", 2)
+	PutAReg(adcOp(GetAReg(), MemB(postbyte())))
+}
+
+func adca_ext() {
+	Dis_inst("adc", "a", 2)
+	PutAReg(adcOp(GetAReg(), MemB(direct())))
+}
+
+func adcb_imm() {
+	Dis_inst("adc", "b", 2)
+	PutBReg(adcOp(GetBReg(), MemB(immediate())))
+}
+
+func adcb_dp() {
+	Dis_inst("adc", "b", 2)
+	PutBReg(adcOp(GetBReg(), MemB(zeropage())))
+}
+
+func adcb_idx() {
+	Dis_inst("adc", "b", 2)
+	Dis_inst_cat("", 2)
+	PutBReg(adcOp(GetBReg(), MemB(postbyte())))
+}
+
+func adcb_ext() {
+	Dis_inst("adc", "b", 2)
+	PutBReg(adcOp(GetBReg(), MemB(direct())))
+}
+
+func ora_imm() {
+	Dis_inst("or", "a", 2)
+	PutAReg(orOp(GetAReg(), MemB(immediate())))
+}
+
+func ora_dp() {
+	Dis_inst("or", "a", 2)
+	PutAReg(orOp(GetAReg(), MemB(zeropage())))
+}
+
+func ora_idx() {
+	Dis_inst("or", "a", 2)
+	Dis_inst_cat("", 2)
+	PutAReg(orOp(GetAReg(), MemB(postbyte())))
+}
+
+func ora_ext() {
+	Dis_inst("or", "a", 2)
+	PutAReg(orOp(GetAReg(), MemB(direct())))
+}
+
+func orb_imm() {
+	Dis_inst("or", "b", 2)
+	PutBReg(orOp(GetBReg(), MemB(immediate())))
+}
+
+func orb_dp() {
+	Dis_inst("or", "b", 2)
+	PutBReg(orOp(GetBReg(), MemB(zeropage())))
+}
+
+func orb_idx() {
+	Dis_inst("or", "b", 2)
+	Dis_inst_cat("", 2)
+	PutBReg(orOp(GetBReg(), MemB(postbyte())))
+}
+
+func orb_ext() {
+	Dis_inst("or", "b", 2)
+	PutBReg(orOp(GetBReg(), MemB(direct())))
+}
+
+func adda_imm() {
+	Dis_inst("add", "a", 2)
+	PutAReg(addOp(GetAReg(), MemB(immediate())))
+}
+
+func adda_dp() {
+	Dis_inst("add", "a", 2)
+	PutAReg(addOp(GetAReg(), MemB(zeropage())))
+}
+
+func adda_idx() {
+	Dis_inst("add", "a", 2)
+	Dis_inst_cat("", 2)
+	PutAReg(addOp(GetAReg(), MemB(postbyte())))
+}
+
+func adda_ext() {
+	Dis_inst("add", "a", 2)
+	PutAReg(addOp(GetAReg(), MemB(direct())))
+}
+
+func addb_imm() {
+	Dis_inst("add", "b", 2)
+	PutBReg(addOp(GetBReg(), MemB(immediate())))
+}
+
+func addb_dp() {
+	Dis_inst("add", "b", 2)
+	PutBReg(addOp(GetBReg(), MemB(zeropage())))
+}
+
+func addb_idx() {
+	Dis_inst("add", "b", 2)
+	Dis_inst_cat("", 2)
+	PutBReg(addOp(GetBReg(), MemB(postbyte())))
+}
+
+func addb_ext() {
+	Dis_inst("add", "b", 2)
+	PutBReg(addOp(GetBReg(), MemB(direct())))
+}
+
+func cmpa_imm() {
+	Dis_inst("cmp", "a", 2)
+	cmpOp(GetAReg(), MemB(immediate()))
+}
+
+func cmpa_dp() {
+	Dis_inst("cmp", "a", 2)
+	cmpOp(GetAReg(), MemB(zeropage()))
+}
+
+func cmpa_idx() {
+	Dis_inst("cmp", "a", 2)
+	Dis_inst_cat("", 2)
+	cmpOp(GetAReg(), MemB(postbyte()))
+}
+
+func cmpa_ext() {
+	Dis_inst("cmp", "a", 2)
+	cmpOp(GetAReg(), MemB(direct()))
+}
+
+func cmpb_imm() {
+	Dis_inst("cmp", "b", 2)
+	cmpOp(GetBReg(), MemB(immediate()))
+}
+
+func cmpb_dp() {
+	Dis_inst("cmp", "b", 2)
+	cmpOp(GetBReg(), MemB(zeropage()))
+}
+
+func cmpb_idx() {
+	Dis_inst("cmp", "b", 2)
+	Dis_inst_cat("", 2)
+	cmpOp(GetBReg(), MemB(postbyte()))
+}
+
+func cmpb_ext() {
+	Dis_inst("cmp", "b", 2)
+	cmpOp(GetBReg(), MemB(direct()))
+}
+
+func bita_imm() {
+	Dis_inst("bit", "a", 2)
+	bitOp(GetAReg(), MemB(immediate()))
+}
+
+func bita_dp() {
+	Dis_inst("bit", "a", 2)
+	bitOp(GetAReg(), MemB(zeropage()))
+}
+
+func bita_idx() {
+	Dis_inst("bit", "a", 2)
+	Dis_inst_cat("", 2)
+	bitOp(GetAReg(), MemB(postbyte()))
+}
+
+func bita_ext() {
+	Dis_inst("bit", "a", 2)
+	bitOp(GetAReg(), MemB(direct()))
+}
+
+func bitb_imm() {
+	Dis_inst("bit", "b", 2)
+	bitOp(GetBReg(), MemB(immediate()))
+}
+
+func bitb_dp() {
+	Dis_inst("bit", "b", 2)
+	bitOp(GetBReg(), MemB(zeropage()))
+}
+
+func bitb_idx() {
+	Dis_inst("bit", "b", 2)
+	Dis_inst_cat("", 2)
+	bitOp(GetBReg(), MemB(postbyte()))
+}
+
+func bitb_ext() {
+	Dis_inst("bit", "b", 2)
+	bitOp(GetBReg(), MemB(direct()))
+}
+
+func lda_imm() {
+	Dis_inst("ld", "a", 2)
+	PutAReg(ldOp(MemB(immediate())))
+}
+
+func lda_dp() {
+	Dis_inst("ld", "a", 2)
+	PutAReg(ldOp(MemB(zeropage())))
+}
+
+func lda_idx() {
+	Dis_inst("ld", "a", 2)
+	Dis_inst_cat("", 2)
+	PutAReg(ldOp(MemB(postbyte())))
+}
+
+func lda_ext() {
+	Dis_inst("ld", "a", 2)
+	PutAReg(ldOp(MemB(direct())))
+}
+
+func ldb_imm() {
+	Dis_inst("ld", "b", 2)
+	PutBReg(ldOp(MemB(immediate())))
+}
+
+func ldb_dp() {
+	Dis_inst("ld", "b", 2)
+	PutBReg(ldOp(MemB(zeropage())))
+}
+
+func ldb_idx() {
+	Dis_inst("ld", "b", 2)
+	Dis_inst_cat("", 2)
+	PutBReg(ldOp(MemB(postbyte())))
+}
+
+func ldb_ext() {
+	Dis_inst("ld", "b", 2)
+	PutBReg(ldOp(MemB(direct())))
+}
+
+func sta_imm() {
+	Dis_inst("st", "a", 2)
+	addr := immediate()
+	MemPutB(addr, stOp(GetAReg()))
+}
+
+func sta_dp() {
+	Dis_inst("st", "a", 2)
+	addr := zeropage()
+	MemPutB(addr, stOp(GetAReg()))
+}
+
+func sta_idx() {
+	Dis_inst("st", "a", 2)
+	Dis_inst_cat("", 2)
+	addr := postbyte()
+	MemPutB(addr, stOp(GetAReg()))
+}
+
+func sta_ext() {
+	Dis_inst("st", "a", 2)
+	addr := direct()
+	MemPutB(addr, stOp(GetAReg()))
+}
+
+func stb_imm() {
+	Dis_inst("st", "b", 2)
+	addr := immediate()
+	MemPutB(addr, stOp(GetBReg()))
+}
+
+func stb_dp() {
+	Dis_inst("st", "b", 2)
+	addr := zeropage()
+	MemPutB(addr, stOp(GetBReg()))
+}
+
+func stb_idx() {
+	Dis_inst("st", "b", 2)
+	Dis_inst_cat("", 2)
+	addr := postbyte()
+	MemPutB(addr, stOp(GetBReg()))
+}
+
+func stb_ext() {
+	Dis_inst("st", "b", 2)
+	addr := direct()
+	MemPutB(addr, stOp(GetBReg()))
+}
+
+func subd_imm() {
+	Dis_inst("subd", "", 5)
+	Dis_inst_cat("", -1)
+	subdOp(MemW(immediate2()))
+}
+
+func subd_dp() {
+	Dis_inst("subd", "", 5)
+	Dis_inst_cat("", -1)
+	subdOp(MemW(zeropage()))
+}
+
+func subd_idx() {
+	Dis_inst("subd", "", 5)
+	Dis_inst_cat("", 1)
+	subdOp(MemW(postbyte()))
+}
+
+func subd_ext() {
+	Dis_inst("subd", "", 5)
+	Dis_inst_cat("", -1)
+	subdOp(MemW(direct()))
+}
+
+func addd_imm() {
+	Dis_inst("addd", "", 5)
+	Dis_inst_cat("", -1)
+	adddOp(MemW(immediate2()))
+}
+
+func addd_dp() {
+	Dis_inst("addd", "", 5)
+	Dis_inst_cat("", -1)
+	adddOp(MemW(zeropage()))
+}
+
+func addd_idx() {
+	Dis_inst("addd", "", 5)
+	Dis_inst_cat("", 1)
+	adddOp(MemW(postbyte()))
+}
+
+func addd_ext() {
+	Dis_inst("addd", "", 5)
+	Dis_inst_cat("", -1)
+	adddOp(MemW(direct()))
+}
+
+func cmpd_imm() {
+	aop := dreg
+	Dis_inst("cmpd", "", 5)
+	Dis_inst_cat("", -1)
+	cmp16Op(aop, MemW(immediate2()))
+}
+
+func cmpd_dp() {
+	aop := dreg
+	Dis_inst("cmpd", "", 5)
+	Dis_inst_cat("", -1)
+	cmp16Op(aop, MemW(zeropage()))
+}
+
+func cmpd_idx() {
+	aop := dreg
+	Dis_inst("cmpd", "", 5)
+	Dis_inst_cat("", 1)
+	cmp16Op(aop, MemW(postbyte()))
+}
+
+func cmpd_ext() {
+	aop := dreg
+	Dis_inst("cmpd", "", 5)
+	Dis_inst_cat("", -1)
+	cmp16Op(aop, MemW(direct()))
+}
+
+func cmpx_imm() {
+	aop := xreg
+	Dis_inst("cmpx", "", 5)
+	Dis_inst_cat("", -1)
+	cmp16Op(aop, MemW(immediate2()))
+}
+
+func cmpx_dp() {
+	aop := xreg
+	Dis_inst("cmpx", "", 5)
+	Dis_inst_cat("", -1)
+	cmp16Op(aop, MemW(zeropage()))
+}
+
+func cmpx_idx() {
+	aop := xreg
+	Dis_inst("cmpx", "", 5)
+	Dis_inst_cat("", 1)
+	cmp16Op(aop, MemW(postbyte()))
+}
+
+func cmpx_ext() {
+	aop := xreg
+	Dis_inst("cmpx", "", 5)
+	Dis_inst_cat("", -1)
+	cmp16Op(aop, MemW(direct()))
+}
+
+func cmpy_imm() {
+	aop := yreg
+	Dis_inst("cmpy", "", 5)
+	Dis_inst_cat("", -1)
+	cmp16Op(aop, MemW(immediate2()))
+}
+
+func cmpy_dp() {
+	aop := yreg
+	Dis_inst("cmpy", "", 5)
+	Dis_inst_cat("", -1)
+	cmp16Op(aop, MemW(zeropage()))
+}
+
+func cmpy_idx() {
+	aop := yreg
+	Dis_inst("cmpy", "", 5)
+	Dis_inst_cat("", 1)
+	cmp16Op(aop, MemW(postbyte()))
+}
+
+func cmpy_ext() {
+	aop := yreg
+	Dis_inst("cmpy", "", 5)
+	Dis_inst_cat("", -1)
+	cmp16Op(aop, MemW(direct()))
+}
+
+func cmpu_imm() {
+	aop := ureg
+	Dis_inst("cmpu", "", 5)
+	Dis_inst_cat("", -1)
+	cmp16Op(aop, MemW(immediate2()))
+}
+
+func cmpu_dp() {
+	aop := ureg
+	Dis_inst("cmpu", "", 5)
+	Dis_inst_cat("", -1)
+	cmp16Op(aop, MemW(zeropage()))
+}
+
+func cmpu_idx() {
+	aop := ureg
+	Dis_inst("cmpu", "", 5)
+	Dis_inst_cat("", 1)
+	cmp16Op(aop, MemW(postbyte()))
+}
+
+func cmpu_ext() {
+	aop := ureg
+	Dis_inst("cmpu", "", 5)
+	Dis_inst_cat("", -1)
+	cmp16Op(aop, MemW(direct()))
+}
+
+func cmps_imm() {
+	aop := sreg
+	Dis_inst("cmps", "", 5)
+	Dis_inst_cat("", -1)
+	cmp16Op(aop, MemW(immediate2()))
+}
+
+func cmps_dp() {
+	aop := sreg
+	Dis_inst("cmps", "", 5)
+	Dis_inst_cat("", -1)
+	cmp16Op(aop, MemW(zeropage()))
+}
+
+func cmps_idx() {
+	aop := sreg
+	Dis_inst("cmps", "", 5)
+	Dis_inst_cat("", 1)
+	cmp16Op(aop, MemW(postbyte()))
+}
+
+func cmps_ext() {
+	aop := sreg
+	Dis_inst("cmps", "", 5)
+	Dis_inst_cat("", -1)
+	cmp16Op(aop, MemW(direct()))
+}
+
+func ldd_imm() {
+	Dis_inst("ldd", "", 4)
+	Dis_inst_cat("", -1)
+	dreg = ld16Op(MemW(immediate2()))
+}
+
+func ldd_dp() {
+	Dis_inst("ldd", "", 4)
+	Dis_inst_cat("", -1)
+	dreg = ld16Op(MemW(zeropage()))
+}
+
+func ldd_idx() {
+	Dis_inst("ldd", "", 4)
+	Dis_inst_cat("", 1)
+	dreg = ld16Op(MemW(postbyte()))
+}
+
+func ldd_ext() {
+	Dis_inst("ldd", "", 4)
+	Dis_inst_cat("", -1)
+	dreg = ld16Op(MemW(direct()))
+}
+
+func ldx_imm() {
+	Dis_inst("ldx", "", 4)
+	Dis_inst_cat("", -1)
+	xreg = ld16Op(MemW(immediate2()))
+}
+
+func ldx_dp() {
+	Dis_inst("ldx", "", 4)
+	Dis_inst_cat("", -1)
+	xreg = ld16Op(MemW(zeropage()))
+}
+
+func ldx_idx() {
+	Dis_inst("ldx", "", 4)
+	Dis_inst_cat("", 1)
+	xreg = ld16Op(MemW(postbyte()))
+}
+
+func ldx_ext() {
+	Dis_inst("ldx", "", 4)
+	Dis_inst_cat("", -1)
+	xreg = ld16Op(MemW(direct()))
+}
+
+func ldy_imm() {
+	Dis_inst("ldy", "", 4)
+	Dis_inst_cat("", -1)
+	yreg = ld16Op(MemW(immediate2()))
+}
+
+func ldy_dp() {
+	Dis_inst("ldy", "", 4)
+	Dis_inst_cat("", -1)
+	yreg = ld16Op(MemW(zeropage()))
+}
+
+func ldy_idx() {
+	Dis_inst("ldy", "", 4)
+	Dis_inst_cat("", 1)
+	yreg = ld16Op(MemW(postbyte()))
+}
+
+func ldy_ext() {
+	Dis_inst("ldy", "", 4)
+	Dis_inst_cat("", -1)
+	yreg = ld16Op(MemW(direct()))
+}
+
+func ldu_imm() {
+	Dis_inst("ldu", "", 4)
+	Dis_inst_cat("", -1)
+	ureg = ld16Op(MemW(immediate2()))
+}
+
+func ldu_dp() {
+	Dis_inst("ldu", "", 4)
+	Dis_inst_cat("", -1)
+	ureg = ld16Op(MemW(zeropage()))
+}
+
+func ldu_idx() {
+	Dis_inst("ldu", "", 4)
+	Dis_inst_cat("", 1)
+	ureg = ld16Op(MemW(postbyte()))
+}
+
+func ldu_ext() {
+	Dis_inst("ldu", "", 4)
+	Dis_inst_cat("", -1)
+	ureg = ld16Op(MemW(direct()))
+}
+
+func lds_imm() {
+	Dis_inst("lds", "", 4)
+	Dis_inst_cat("", -1)
+	sreg = ld16Op(MemW(immediate2()))
+}
+
+func lds_dp() {
+	Dis_inst("lds", "", 4)
+	Dis_inst_cat("", -1)
+	sreg = ld16Op(MemW(zeropage()))
+}
+
+func lds_idx() {
+	Dis_inst("lds", "", 4)
+	Dis_inst_cat("", 1)
+	sreg = ld16Op(MemW(postbyte()))
+}
+
+func lds_ext() {
+	Dis_inst("lds", "", 4)
+	Dis_inst_cat("", -1)
+	sreg = ld16Op(MemW(direct()))
+}
+
+func std_imm() {
+	Dis_inst("std", "", 4)
+	Dis_inst_cat("", -1)
+	addr := immediate2()
+	MemPutW(addr, st16Op(dreg))
+}
+
+func std_dp() {
+	Dis_inst("std", "", 4)
+	Dis_inst_cat("", -1)
+	addr := zeropage()
+	MemPutW(addr, st16Op(dreg))
+}
+
+func std_idx() {
+	Dis_inst("std", "", 4)
+	Dis_inst_cat("", 1)
+	addr := postbyte()
+	MemPutW(addr, st16Op(dreg))
+}
+
+func std_ext() {
+	Dis_inst("std", "", 4)
+	Dis_inst_cat("", -1)
+	addr := direct()
+	MemPutW(addr, st16Op(dreg))
+}
+
+func stx_imm() {
+	Dis_inst("stx", "", 4)
+	Dis_inst_cat("", -1)
+	addr := immediate2()
+	MemPutW(addr, st16Op(xreg))
+}
+
+func stx_dp() {
+	Dis_inst("stx", "", 4)
+	Dis_inst_cat("", -1)
+	addr := zeropage()
+	MemPutW(addr, st16Op(xreg))
+}
+
+func stx_idx() {
+	Dis_inst("stx", "", 4)
+	Dis_inst_cat("", 1)
+	addr := postbyte()
+	MemPutW(addr, st16Op(xreg))
+}
+
+func stx_ext() {
+	Dis_inst("stx", "", 4)
+	Dis_inst_cat("", -1)
+	addr := direct()
+	MemPutW(addr, st16Op(xreg))
+}
+
+func sty_imm() {
+	Dis_inst("sty", "", 4)
+	Dis_inst_cat("", -1)
+	addr := immediate2()
+	MemPutW(addr, st16Op(yreg))
+}
+
+func sty_dp() {
+	Dis_inst("sty", "", 4)
+	Dis_inst_cat("", -1)
+	addr := zeropage()
+	MemPutW(addr, st16Op(yreg))
+}
+
+func sty_idx() {
+	Dis_inst("sty", "", 4)
+	Dis_inst_cat("", 1)
+	addr := postbyte()
+	MemPutW(addr, st16Op(yreg))
+}
+
+func sty_ext() {
+	Dis_inst("sty", "", 4)
+	Dis_inst_cat("", -1)
+	addr := direct()
+	MemPutW(addr, st16Op(yreg))
+}
+
+func stu_imm() {
+	Dis_inst("stu", "", 4)
+	Dis_inst_cat("", -1)
+	addr := immediate2()
+	MemPutW(addr, st16Op(ureg))
+}
+
+func stu_dp() {
+	Dis_inst("stu", "", 4)
+	Dis_inst_cat("", -1)
+	addr := zeropage()
+	MemPutW(addr, st16Op(ureg))
+}
+
+func stu_idx() {
+	Dis_inst("stu", "", 4)
+	Dis_inst_cat("", 1)
+	addr := postbyte()
+	MemPutW(addr, st16Op(ureg))
+}
+
+func stu_ext() {
+	Dis_inst("stu", "", 4)
+	Dis_inst_cat("", -1)
+	addr := direct()
+	MemPutW(addr, st16Op(ureg))
+}
+
+func sts_imm() {
+	Dis_inst("sts", "", 4)
+	Dis_inst_cat("", -1)
+	addr := immediate2()
+	MemPutW(addr, st16Op(sreg))
+}
+
+func sts_dp() {
+	Dis_inst("sts", "", 4)
+	Dis_inst_cat("", -1)
+	addr := zeropage()
+	MemPutW(addr, st16Op(sreg))
+}
+
+func sts_idx() {
+	Dis_inst("sts", "", 4)
+	Dis_inst_cat("", 1)
+	addr := postbyte()
+	MemPutW(addr, st16Op(sreg))
+}
+
+func sts_ext() {
+	Dis_inst("sts", "", 4)
+	Dis_inst_cat("", -1)
+	addr := direct()
+	MemPutW(addr, st16Op(sreg))
+}
+
+func jsr_dp() {
+	Dis_inst("jsr", "", 5)
+	Dis_len(-pcreg)
+	addr := zeropage()
+	Dis_len_incr(pcreg + 1)
+	PushWord(pcreg)
+	pcreg = addr
+}
+
+func jsr_idx() {
+	Dis_inst("jsr", "", 5)
+	Dis_len(-pcreg)
+	Dis_inst_cat("", 2)
+	addr := postbyte()
+	Dis_len_incr(pcreg + 1)
+	PushWord(pcreg)
+	pcreg = addr
+}
+
+func jsr_ext() {
+	Dis_inst("jsr", "", 5)
+	Dis_len(-pcreg)
+	addr := direct()
+	Dis_len_incr(pcreg + 1)
+	PushWord(pcreg)
+	pcreg = addr
+}
+
+func bhi() {
+	Dis_inst("", "bhi", 3)
+	br(0 == (CC() & 0x05))
+}
+
+func lbhi() {
+	Dis_inst("l", "bhi", 5)
+	lbr(0 == (CC() & 0x05))
+}
+
+func bls() {
+	Dis_inst("", "bls", 3)
+	br(0 != CC()&0x05)
+}
+
+func lbls() {
+	Dis_inst("l", "bls", 5)
+	lbr(0 != CC()&0x05)
+}
+
+func bcc() {
+	Dis_inst("", "bcc", 3)
+	br(0 == (CC() & 0x01))
+}
+
+func lbcc() {
+	Dis_inst("l", "bcc", 5)
+	lbr(0 == (CC() & 0x01))
+}
+
+func bcs() {
+	Dis_inst("", "bcs", 3)
+	br(0 != CC()&0x01)
+}
+
+func lbcs() {
+	Dis_inst("l", "bcs", 5)
+	lbr(0 != CC()&0x01)
+}
+
+func bne() {
+	Dis_inst("", "bne", 3)
+	br(0 == (CC() & 0x04))
+}
+
+func lbne() {
+	Dis_inst("l", "bne", 5)
+	lbr(0 == (CC() & 0x04))
+}
+
+func beq() {
+	Dis_inst("", "beq", 3)
+	br(0 != CC()&0x04)
+}
+
+func lbeq() {
+	Dis_inst("l", "beq", 5)
+	lbr(0 != CC()&0x04)
+}
+
+func bvc() {
+	Dis_inst("", "bvc", 3)
+	br(0 == (CC() & 0x02))
+}
+
+func lbvc() {
+	Dis_inst("l", "bvc", 5)
+	lbr(0 == (CC() & 0x02))
+}
+
+func bvs() {
+	Dis_inst("", "bvs", 3)
+	br(0 != CC()&0x02)
+}
+
+func lbvs() {
+	Dis_inst("l", "bvs", 5)
+	lbr(0 != CC()&0x02)
+}
+
+func bpl() {
+	Dis_inst("", "bpl", 3)
+	br(0 == (CC() & 0x08))
+}
+
+func lbpl() {
+	Dis_inst("l", "bpl", 5)
+	lbr(0 == (CC() & 0x08))
+}
+
+func bmi() {
+	Dis_inst("", "bmi", 3)
+	br(0 != CC()&0x08)
+}
+
+func lbmi() {
+	Dis_inst("l", "bmi", 5)
+	lbr(0 != CC()&0x08)
+}
+
+func bge() {
+	Dis_inst("", "bge", 3)
+	br(!NXORV())
+}
+
+func lbge() {
+	Dis_inst("l", "bge", 5)
+	lbr(!NXORV())
+}
+
+func blt() {
+	Dis_inst("", "blt", 3)
+	br(NXORV())
+}
+
+func lblt() {
+	Dis_inst("l", "blt", 5)
+	lbr(NXORV())
+}
+
+func bgt() {
+	Dis_inst("", "bgt", 3)
+	br(!(NXORV() || 0 != CC()&0x04))
+}
+
+func lbgt() {
+	Dis_inst("l", "bgt", 5)
+	lbr(!(NXORV() || 0 != CC()&0x04))
+}
+
+func ble() {
+	Dis_inst("", "ble", 3)
+	br(NXORV() || 0 != CC()&0x04)
+}
+
+func lble() {
+	Dis_inst("l", "ble", 5)
+	lbr(NXORV() || 0 != CC()&0x04)
+}
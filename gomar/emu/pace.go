@@ -0,0 +1,125 @@
+package emu
+
+// Pacing: run at the real speed of the machine, or flat out.
+//
+// With -pace=real, emulated time is cycles_sum divided by the clock rate
+// the guest selected with the SAM rate bits (poke FFD8 for 0.89 MHz,
+// FFD9 for 1.78 MHz), and the timer interrupt fires at 60 Hz of emulated
+// time instead of every -clock steps.  Every PaceCheckSteps steps, if
+// emulated time is ahead of the host's monotonic clock, we sleep off the
+// difference in slices of at least PaceSlice.  If we fall far behind
+// (a slow host, or a stop in a debugger) we do not try to catch up.
+//
+// -pace=warp (the default) never sleeps.  A number like -pace=2.5 paces
+// at that many MHz regardless of the SAM.
+//
+// Either way the achieved speed is reported in effective MHz,
+// every -pace_report and at the end of the run.
+
+import (
+	"flag"
+	"log"
+	"strconv"
+	"time"
+)
+
+var FlagPace = flag.String("pace", "warp", "warp: unthrottled; real: 0.89/1.78 MHz by the SAM rate bits; or fixed MHz like 2.5")
+var FlagPaceReport = flag.Duration("pace_report", 0, "Log effective MHz this often (0: only at the end)")
+
+const PaceCheckSteps = 1024 // Power of 2.
+const PaceSlice = 5 * time.Millisecond
+const PaceMaxLag = 250 * time.Millisecond
+const PaceIdleCycles = 8 // Emulated cycles per step spent Waiting (CWAI, SYNC).
+const PaceTimerHz = 60
+
+const SlowMHz = 14.31818 / 16
+const FastMHz = 14.31818 / 8
+
+var Pacing bool          // Sleep to keep emulated time at host time.
+var PaceFixedMHz float64 // If nonzero, ignore the SAM rate.
+var PaceTimerDue bool    // Set when 1/60 sec of emulated time has passed.
+
+var paceStart, paceBase, paceLastReport time.Time
+var paceEmulated time.Duration // Emulated time since paceBase.
+var paceCycles int64           // cycles_sum at last PaceCheck.
+var paceTickCycles float64     // Cycles toward the next timer tick.
+var paceReportCycles int64
+
+// TimerSteps is the number of steps between timer interrupts,
+// unless Pacing decides by emulated time.
+func TimerSteps() uint64 {
+	if Pacing {
+		return MaxUint64
+	}
+	return *FlagClock
+}
+
+func InitPace() {
+	switch *FlagPace {
+	case "warp", "":
+	case "real":
+		Pacing = true
+	default:
+		mhz, err := strconv.ParseFloat(*FlagPace, 64)
+		if err != nil || mhz <= 0 {
+			log.Fatalf("bad -pace %q: want warp, real, or MHz", *FlagPace)
+		}
+		Pacing, PaceFixedMHz = true, mhz
+	}
+	paceStart = time.Now()
+	paceBase, paceLastReport = paceStart, paceStart
+}
+
+// PaceMHz is the emulated clock rate.
+func PaceMHz() float64 {
+	switch {
+	case PaceFixedMHz != 0:
+		return PaceFixedMHz
+	case sam.Rx != 0:
+		return FastMHz
+	default:
+		return SlowMHz
+	}
+}
+
+// PaceCheck is called every PaceCheckSteps steps.
+func PaceCheck() {
+	delta := cycles_sum - paceCycles
+	paceCycles = cycles_sum
+
+	if Pacing {
+		mhz := PaceMHz()
+		paceEmulated += time.Duration(float64(delta) / mhz * 1000)
+		paceTickCycles += float64(delta)
+		if perTick := mhz * 1e6 / PaceTimerHz; paceTickCycles >= perTick {
+			paceTickCycles -= perTick
+			PaceTimerDue = true
+		}
+
+		ahead := paceEmulated - time.Since(paceBase)
+		if ahead >= PaceSlice {
+			time.Sleep(ahead)
+		} else if ahead < -PaceMaxLag {
+			paceBase, paceEmulated = time.Now(), 0 // Give up catching up.
+		}
+	}
+
+	if *FlagPaceReport > 0 {
+		if now := time.Now(); now.Sub(paceLastReport) >= *FlagPaceReport {
+			log.Printf("pace: %.3f effective MHz", EffectiveMHz(cycles_sum-paceReportCycles, now.Sub(paceLastReport)))
+			paceLastReport, paceReportCycles = now, cycles_sum
+		}
+	}
+}
+
+func EffectiveMHz(cycles int64, d time.Duration) float64 {
+	if d <= 0 {
+		return 0
+	}
+	return float64(cycles) / d.Seconds() / 1e6
+}
+
+func PaceFinalReport() {
+	d := time.Since(paceStart)
+	log.Printf("pace: %d cycles, %d steps in %v: %.3f effective MHz", cycles_sum, Steps, d.Round(time.Millisecond), EffectiveMHz(cycles_sum, d))
+}
@@ -0,0 +1,211 @@
+package emu
+
+// Per-process accounting.  OS9 switches processes by changing D.Proc
+// and returning with RTI, so after every RTI (and at every SWI2) we
+// look at D.Proc, and charge the cycles since the last change to the
+// process that was running.  -proc_cycles logs the totals at exit.
+//
+// -proc_trace=FILE also writes a timeline in Chrome's trace-event JSON,
+// for https://ui.perfetto.dev or chrome://tracing: one track per OS9
+// process, with a slice for each time it ran, and instant events for
+// its system calls and for interrupts.  Timestamps are cycles, so one
+// microsecond on the timeline is one 6809 cycle.
+
+import (
+	"bufio"
+	"bytes"
+	"encoding/json"
+	"flag"
+	"log"
+	"os"
+	"sort"
+	"strings"
+
+	"github.com/strickyak/doing_os9/gomar/sym"
+)
+
+var FlagProcCycles = flag.Bool("proc_cycles", false, "Log the cycles used by each OS9 process at exit")
+var FlagProcTrace = flag.String("proc_trace", "", "Write a Chrome trace-event timeline of OS9 processes to this .json file")
+
+var ProcTracing bool // Watching D.Proc.
+
+type procAcct struct {
+	Pid      byte
+	Name     string
+	Cycles   int64
+	Slices   int
+	Syscalls int
+}
+
+var procs = make(map[byte]*procAcct)
+var procCurrent *procAcct
+var procSince int64 // cycles_sum when procCurrent started running.
+var procTraceW *bufio.Writer
+var procTraceFile *os.File
+var procTraceSep = "[\n"
+
+type traceEvent struct {
+	Name string            `json:"name"`
+	Cat  string            `json:"cat,omitempty"`
+	Ph   string            `json:"ph"`
+	Ts   int64             `json:"ts"`
+	Dur  int64             `json:"dur,omitempty"`
+	Pid  int               `json:"pid"`
+	Tid  int               `json:"tid"`
+	S    string            `json:"s,omitempty"`
+	Args map[string]string `json:"args,omitempty"`
+}
+
+func InitProcs() {
+	ProcTracing = *FlagProcCycles || *FlagProcTrace != ""
+	if *FlagProcTrace != "" {
+		f, err := os.Create(*FlagProcTrace)
+		if err != nil {
+			log.Fatalf("cannot create -proc_trace file: %v", err)
+		}
+		procTraceFile, procTraceW = f, bufio.NewWriter(f)
+	}
+}
+
+func procEmit(e traceEvent) {
+	if procTraceW == nil {
+		return
+	}
+	bb, err := json.Marshal(e)
+	if err != nil {
+		log.Panicf("proc_trace: %v", err)
+	}
+	procTraceW.WriteString(procTraceSep)
+	procTraceW.Write(bb)
+	procTraceSep = ",\n"
+}
+
+// procOf finds the accounting for the process descriptor at proc.
+func procOf(proc Word) *procAcct {
+	var pid byte
+	if proc != 0 {
+		pid = PeekBWithTask(proc+sym.P_ID, 0)
+	}
+	p, ok := procs[pid]
+	if !ok {
+		p = &procAcct{Pid: pid, Name: "?"}
+		if proc == 0 {
+			p.Name = "(none)"
+		}
+		procs[pid] = p
+	}
+	return p
+}
+
+// ProcCheck charges cycles to the process that was running
+// if D.Proc has changed.
+func ProcCheck() {
+	proc := PeekWWithTask(sym.D_Proc, 0)
+	p := procOf(proc)
+	if p == procCurrent {
+		return
+	}
+	if p.Name == "?" {
+		// As in swi2: after RTI, the process's own map is in use.
+		if pmodul := PeekWWithTask(proc+sym.P_PModul, 0); pmodul != 0 {
+			p.Name = procName(pmodul + PeekW(pmodul+4))
+		}
+	}
+	procSwitch(p)
+}
+
+// procName reads a module name as Os9String does, but always with
+// PeekB, so ProcCheck stays off the I/O hooks whatever Os9String uses.
+func procName(addr Word) string {
+	var buf bytes.Buffer
+	for i := 0; i < 64; i++ {
+		b := PeekB(addr + Word(i))
+		if ch := b & 0x7F; ch < '!' || '~' < ch {
+			break
+		}
+		buf.WriteByte(b & 0x7F)
+		if b&0x80 != 0 {
+			break
+		}
+	}
+	return buf.String()
+}
+
+func procSwitch(p *procAcct) {
+	if procCurrent != nil {
+		dur := cycles_sum - procSince
+		procCurrent.Cycles += dur
+		procCurrent.Slices++
+		procEmit(traceEvent{Name: procCurrent.Name, Cat: "run", Ph: "X", Ts: procSince, Dur: dur, Pid: 1, Tid: int(procCurrent.Pid)})
+	}
+	procCurrent, procSince = p, cycles_sum
+}
+
+// ProcSyscall notes an OS9 system call, with its description from
+// DecodeOs9Opcode, by the process at proc running module name.
+func ProcSyscall(proc Word, name string, describe string) {
+	p := procOf(proc)
+	if name != "" {
+		p.Name = name
+	}
+	if p != procCurrent {
+		procSwitch(p)
+	}
+	p.Syscalls++
+	call := strings.Fields(describe + " ?")[0]
+	procEmit(traceEvent{Name: call, Cat: "syscall", Ph: "i", Ts: cycles_sum, Pid: 1, Tid: int(p.Pid), S: "t", Args: map[string]string{"call": describe}})
+}
+
+// ProcInterrupt notes an interrupt through vector.
+func ProcInterrupt(vector Word) {
+	name := "IRQ"
+	switch vector {
+	case VECTOR_FIRQ:
+		name = "FIRQ"
+	case VECTOR_NMI:
+		name = "NMI"
+	}
+	tid := 0
+	if procCurrent != nil {
+		tid = int(procCurrent.Pid)
+	}
+	procEmit(traceEvent{Name: name, Cat: "interrupt", Ph: "i", Ts: cycles_sum, Pid: 1, Tid: tid, S: "t"})
+}
+
+// ProcFinalReport closes the last slice, logs the totals,
+// and finishes the trace.
+func ProcFinalReport() {
+	if !ProcTracing {
+		return
+	}
+	if procCurrent != nil {
+		procSwitch(procCurrent)
+	}
+
+	var all []*procAcct
+	var total int64
+	for _, p := range procs {
+		all = append(all, p)
+		total += p.Cycles
+	}
+	sort.Slice(all, func(i, j int) bool { return all[i].Cycles > all[j].Cycles })
+	for _, p := range all {
+		pct := 0.0
+		if total > 0 {
+			pct = 100 * float64(p.Cycles) / float64(total)
+		}
+		log.Printf("proc %3d %-12s %12d cycles %5.1f%% %6d slices %6d syscalls", p.Pid, p.Name, p.Cycles, pct, p.Slices, p.Syscalls)
+		procEmit(traceEvent{Name: "thread_name", Ph: "M", Pid: 1, Tid: int(p.Pid), Args: map[string]string{"name": F("%d %s", p.Pid, p.Name)}})
+	}
+
+	if procTraceW != nil {
+		procEmit(traceEvent{Name: "process_name", Ph: "M", Pid: 1, Args: map[string]string{"name": "gomar"}})
+		procTraceW.WriteString("\n]\n")
+		if err := procTraceW.Flush(); err != nil {
+			log.Panicf("cannot write -proc_trace: %v", err)
+		}
+		procTraceFile.Close()
+		procTraceW = nil
+		log.Printf("proc_trace: wrote %q", *FlagProcTrace)
+	}
+}
@@ -0,0 +1,158 @@
+package emu
+
+// Execution statistics, for deciding which emulator and compiler
+// work will pay off.  With -stats=FILE, gomar counts every opcode
+// (by page), every indexed postbyte, steps run in each MMU task, and
+// branches taken and not taken, and writes them to FILE at exit and
+// on HyperOp 141.  FILE is JSON if it ends in .json, otherwise CSV
+// with lines "kind,name,count".
+//
+// Counting is an array increment behind a bool, cheap enough
+// for full boots.
+
+import (
+	"encoding/json"
+	"flag"
+	"fmt"
+	"log"
+	"os"
+	"sort"
+	"strings"
+)
+
+var FlagStats = flag.String("stats", "", "Write opcode, postbyte, MMU task, and branch counts to this .json or .csv file")
+
+var Stats bool // Counting is on.
+
+var statOps [3][256]uint64 // By page: 1, 2 ($10), and 3 ($11).
+var statPostbyte [256]uint64
+var statTask [2]uint64
+var statBranch [2][16][2]uint64 // [long][condition][taken]
+
+func InitStats() {
+	Stats = *FlagStats != ""
+}
+
+var branchNames = strings.Fields("bra brn bhi bls bcc bcs bne beq bvc bvs bpl bmi bge blt bgt ble")
+
+// CountBranch is called by br and lbr, with ireg the branch opcode.
+func CountBranch(long bool, taken bool) {
+	i, j := 0, 0
+	if long {
+		i = 1
+	}
+	if taken {
+		j = 1
+	}
+	statBranch[i][ireg&15][j]++
+}
+
+var postbyteModes = []string{
+	",r+", ",r++", ",-r", ",--r", ",r", "b,r", "a,r", "illegal",
+	"n8,r", "n16,r", "illegal", "d,r", "n8,pcr", "n16,pcr", "illegal", "n16",
+}
+
+// PostbyteMode names the indexed addressing mode of postbyte pb.
+func PostbyteMode(pb byte) string {
+	if (pb & 0x80) == 0 {
+		return "n5,r"
+	}
+	mode := postbyteModes[pb&0x0f]
+	if (pb & 0x10) != 0 {
+		return "[" + mode + "]"
+	}
+	return mode
+}
+
+type statRow struct {
+	Kind, Name string
+	Count      uint64
+}
+
+func statRows() []statRow {
+	var rows []statRow
+	prefix := []string{"", "10", "11"}
+	for page := range statOps {
+		for op, n := range statOps[page] {
+			if n != 0 {
+				rows = append(rows, statRow{"op", F("$%s%02X", prefix[page], op), n})
+			}
+		}
+	}
+	modes := make(map[string]uint64)
+	for pb, n := range statPostbyte {
+		if n != 0 {
+			modes[PostbyteMode(byte(pb))] += n
+		}
+	}
+	var names []string
+	for name := range modes {
+		names = append(names, name)
+	}
+	sort.Strings(names)
+	for _, name := range names {
+		rows = append(rows, statRow{"postbyte", name, modes[name]})
+	}
+	for task, n := range statTask {
+		rows = append(rows, statRow{"task", F("%d", task), n})
+	}
+	for long := range statBranch {
+		for cond, counts := range statBranch[long] {
+			if counts[0]+counts[1] == 0 {
+				continue
+			}
+			name := CondS(long == 1, "l", "") + branchNames[cond]
+			rows = append(rows, statRow{"branch_taken", name, counts[1]})
+			rows = append(rows, statRow{"branch_not_taken", name, counts[0]})
+		}
+	}
+	return rows
+}
+
+// WriteStats writes the counts so far to the -stats file.
+func WriteStats() {
+	if !Stats {
+		return
+	}
+	rows := statRows()
+	f, err := os.Create(*FlagStats)
+	if err != nil {
+		log.Panicf("cannot create -stats file: %v", err)
+	}
+	defer f.Close()
+
+	if strings.HasSuffix(*FlagStats, ".json") {
+		m := make(map[string]map[string]uint64)
+		for _, r := range rows {
+			if m[r.Kind] == nil {
+				m[r.Kind] = make(map[string]uint64)
+			}
+			m[r.Kind][r.Name] = r.Count
+		}
+		enc := json.NewEncoder(f)
+		enc.SetIndent("", "  ")
+		err = enc.Encode(m)
+	} else {
+		for _, r := range rows {
+			if _, err = fmt.Fprintf(f, "%s,%s,%d\n", r.Kind, r.Name, r.Count); err != nil {
+				break
+			}
+		}
+	}
+	if err != nil {
+		log.Panicf("cannot write -stats file: %v", err)
+	}
+
+	var taken, all uint64
+	for long := range statBranch {
+		for _, counts := range statBranch[long] {
+			taken += counts[1]
+			all += counts[0] + counts[1]
+		}
+	}
+	if all > 0 {
+		log.Printf("stats: wrote %q; %d branches, %.1f%% taken", *FlagStats, all, 100*float64(taken)/float64(all))
+	} else {
+		log.Printf("stats: wrote %q", *FlagStats)
+	}
+}
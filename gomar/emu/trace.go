@@ -105,17 +105,6 @@ func Trace() {
 		log.Printf("")
 	}
 
-	wh = strings.Trim(wh, " ")
-	for _, w := range Watches {
-		if wh == w.Where {
-			var val Word
-			switch w.Register {
-			case "d":
-				val = dreg
-			}
-			log.Printf("@WATCH@ %s == %04x == %q", w.Where, val, w.Message)
-		}
-	}
 	effAddr = kNoEffAddr
 	effByte = -1
 	effWord = -1
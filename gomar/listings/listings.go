@@ -16,10 +16,17 @@ var FlagTraceOnModule = flag.String("trace_on_module", "", "start tracing when l
 
 type ModSrc struct {
 	Src      map[uint]string
+	Lines    map[uint]SrcLine // Where Src came from.
 	Filename string
 	Err      error
 }
 
+// SrcLine is a line of a source file.
+type SrcLine struct {
+	File string
+	Line int
+}
+
 var Listings = make(map[string]*ModSrc)
 
 func Lookup(module string, offset uint, startTrace func()) string {
@@ -32,9 +39,7 @@ func Lookup(module string, offset uint, startTrace func()) string {
 
 	m, ok := Listings[module]
 	if !ok {
-		filename := filepath.Join(*Borges, module)
-		m = LoadFile(filename)
-		Listings[module] = m
+		m = Load(module)
 
 		words := strings.Split(module, ".")
 		if words[0] == strings.ToLower(*FlagTraceOnModule) {
@@ -49,12 +54,24 @@ func Lookup(module string, offset uint, startTrace func()) string {
 	return s // Empty if offset not found.
 }
 
-var parse = regexp.MustCompile(`^([[:xdigit:]]{4}) [[:xdigit:]]+ +[(].*?[)]:[0-9]{5}         (.*)$`)
+// Load returns the listing of module from the -borges dir,
+// reading it the first time.
+func Load(module string) *ModSrc {
+	m, ok := Listings[module]
+	if !ok {
+		m = LoadFile(filepath.Join(*Borges, module))
+		Listings[module] = m
+	}
+	return m
+}
+
+var parse = regexp.MustCompile(`^([[:xdigit:]]{4}) [[:xdigit:]]+ +[(](.*?)[)]:([0-9]{5})         (.*)$`)
 var parseSection = regexp.MustCompile(`^ +[(].*?[)]:[[:digit:]]{5} +(?i:section) +([[:word:]]+)`)
 var parseEndSection = regexp.MustCompile(`^ +[(].*?[)]:[[:digit:]]{5} +(?i:endsection)`)
 
 func LoadFile(filename string) *ModSrc {
 	d := make(map[uint]string)
+	lines := make(map[uint]SrcLine)
 	// Try overriding filename with ".mod" instead of version suffix.
 	fd, err := os.Open(filename[:len(filename)-11] + ".mod")
 	if err != nil {
@@ -76,12 +93,14 @@ func LoadFile(filename string) *ModSrc {
 		text := r.Text()
 		m := parse.FindStringSubmatch(text)
 		if m != nil && !inOtherSection {
-			hexaddr, line := m[1], m[2]
+			hexaddr, file, lineNum, line := m[1], m[2], m[3], m[4]
 			addr, err := strconv.ParseUint(hexaddr, 16, 16)
 			if err != nil {
 				log.Panicf("Should have been a hex integer: %q: %v", hexaddr, err)
 			}
 			d[uint(addr)] = line
+			n, _ := strconv.Atoi(lineNum)
+			lines[uint(addr)] = SrcLine{strings.TrimSpace(file), n}
 			//log.Printf("FILE %s ADDR %x LINE %q", filename, addr, line)
 		}
 		m = parseSection.FindStringSubmatch(text)
@@ -97,6 +116,7 @@ func LoadFile(filename string) *ModSrc {
 	log.Printf("BORGES: Loaded Source: %q (%d)", filename, len(d))
 	return &ModSrc{
 		Src:      d,
+		Lines:    lines,
 		Filename: filename,
 		Err:      nil,
 	}
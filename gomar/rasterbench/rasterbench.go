@@ -0,0 +1,81 @@
+//go:build main
+
+// Rasterbench measures headless display frames per second, per video mode,
+// both redrawing every row and redrawing only one dirty row per frame.
+//
+//	go run --tags=main rasterbench/rasterbench.go -frames=500
+package main
+
+import (
+	"flag"
+	"fmt"
+	"math/rand"
+	"time"
+
+	"github.com/strickyak/doing_os9/gomar/display"
+)
+
+var Frames = flag.Int("frames", 300, "frames to render per mode")
+var Scale = flag.Int("scale", 1, "pixels per coco pixel")
+
+type Mode struct {
+	Name   string
+	Params display.CocoDisplayParams
+}
+
+func graphics(name string, bytesPerRow, colorBits, lines int) Mode {
+	return Mode{name, display.CocoDisplayParams{
+		Gime: true, Graphics: true, LinesPerField: lines,
+		GraphicsBytesPerRow: bytesPerRow, GraphicsColorBits: colorBits,
+	}}
+}
+
+func alpha(name string, cols int, attrs bool) Mode {
+	return Mode{name, display.CocoDisplayParams{
+		Gime: true, LinesPerField: 192, LinesPerCharRow: 8,
+		AlphaCharsPerRow: cols, AlphaHasAttrs: attrs,
+	}}
+}
+
+var Modes = []Mode{
+	{"basic 32x16", display.CocoDisplayParams{BasicText: true}},
+	alpha("alpha 40x24", 40, false),
+	alpha("alpha 80x24 attrs", 80, true),
+	graphics("pmode4 256x192x2", 32, 1, 192),
+	graphics("gime 320x200x4", 80, 2, 200),
+	graphics("gime 320x200x16", 160, 4, 200),
+	graphics("gime 640x200x4", 160, 2, 200),
+	graphics("gime 640x225x4", 160, 2, 225),
+}
+
+func main() {
+	flag.Parse()
+	mem := make([]byte, 0x40*0x2000)
+	rand.New(rand.NewSource(1)).Read(mem)
+	sam := &display.Sam{Fx: 2} // Basic text at $0400.
+	peekb := func(addr int) byte { return mem[addr&0xFFFF] }
+
+	fmt.Printf("%-20s %12s %12s\n", "mode", "full fps", "1-row fps")
+	for _, m := range Modes {
+		coco := m.Params
+		for i := range coco.ColorMap {
+			coco.ColorMap[i] = byte(i * 4)
+		}
+		var fps [2]float64
+		for k, everyRow := range []bool{true, false} {
+			var dirty display.DirtyRows
+			r := display.NewRaster(*Scale)
+			start := time.Now()
+			for i := 0; i < *Frames; i++ {
+				if everyRow {
+					dirty.MarkAll()
+				} else {
+					dirty.Mark(i % 16)
+				}
+				r.Render(mem, &coco, sam, peekb, &dirty)
+			}
+			fps[k] = float64(*Frames) / time.Since(start).Seconds()
+		}
+		fmt.Printf("%-20s %12.0f %12.0f\n", m.Name, fps[0], fps[1])
+	}
+}
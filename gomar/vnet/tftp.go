@@ -0,0 +1,157 @@
+package vnet
+
+import (
+	"bytes"
+	"encoding/binary"
+	"log"
+	"os"
+	"path/filepath"
+	"strings"
+	"time"
+)
+
+// TFTP (RFC 1350) stand-in server, so frobio's tftp client can be
+// exercised on a vnet Switch with no real network.
+
+const (
+	tftpRRQ   = 1
+	tftpWRQ   = 2
+	tftpDATA  = 3
+	tftpACK   = 4
+	tftpERROR = 5
+
+	tftpBlockSize = 512
+	tftpRetries   = 5
+	tftpTimeout   = 2 * time.Second
+)
+
+// ServeTFTP serves files in dir on UDP port 69 of host, in the background.
+// Reads and writes are confined to dir.
+func ServeTFTP(host *Host, dir string) {
+	conn, err := host.ListenUDP(69)
+	if err != nil {
+		log.Panicf("ServeTFTP: %v", err)
+	}
+	go func() {
+		buf := make([]byte, 1500)
+		for {
+			n, peer, err := conn.ReadFrom(buf)
+			if err != nil {
+				return
+			}
+			req := append([]byte(nil), buf[:n]...)
+			go tftpHandle(host, dir, peer, req)
+		}
+	}()
+}
+
+func tftpHandle(host *Host, dir string, peer Addr, req []byte) {
+	if len(req) < 4 {
+		return
+	}
+	op := binary.BigEndian.Uint16(req)
+	fields := bytes.Split(req[2:], []byte{0})
+	if len(fields) < 2 {
+		return
+	}
+	name := string(fields[0])
+
+	conn, err := host.ListenUDP(host.EphemeralPort())
+	if err != nil {
+		log.Printf("TFTP: %v", err)
+		return
+	}
+	defer conn.Close()
+
+	path := filepath.Join(dir, filepath.Clean("/"+name))
+	host.sw.logf("tftp op %d %q from %v", op, name, peer)
+	switch op {
+	case tftpRRQ:
+		tftpSend(conn, peer, path)
+	case tftpWRQ:
+		tftpReceive(conn, peer, path)
+	default:
+		tftpError(conn, peer, 4, "illegal operation")
+	}
+}
+
+func tftpError(conn *UDPConn, peer Addr, code uint16, msg string) {
+	pkt := []byte{0, tftpERROR, byte(code >> 8), byte(code)}
+	pkt = append(pkt, msg...)
+	pkt = append(pkt, 0)
+	conn.WriteTo(pkt, peer)
+}
+
+// tftpExchange sends pkt until a reply of kind want with the given
+// block number arrives from peer.
+func tftpExchange(conn *UDPConn, peer Addr, pkt []byte, want uint16, block uint16) ([]byte, bool) {
+	buf := make([]byte, 1500)
+	for try := 0; try < tftpRetries; try++ {
+		conn.WriteTo(pkt, peer)
+		deadline := time.Now().Add(tftpTimeout)
+		for time.Now().Before(deadline) {
+			n, from, err := conn.ReadFromTimeout(buf, time.Until(deadline))
+			if err != nil {
+				break
+			}
+			if from != peer || n < 4 {
+				continue
+			}
+			op := binary.BigEndian.Uint16(buf)
+			if op == tftpERROR {
+				return nil, false
+			}
+			if op == want && binary.BigEndian.Uint16(buf[2:]) == block {
+				return append([]byte(nil), buf[4:n]...), true
+			}
+		}
+	}
+	return nil, false
+}
+
+func tftpSend(conn *UDPConn, peer Addr, path string) {
+	data, err := os.ReadFile(path)
+	if err != nil {
+		tftpError(conn, peer, 1, "file not found")
+		return
+	}
+	for block := uint16(1); ; block++ {
+		start := int(block-1) * tftpBlockSize
+		end := start + tftpBlockSize
+		if end > len(data) {
+			end = len(data)
+		}
+		pkt := []byte{0, tftpDATA, byte(block >> 8), byte(block)}
+		pkt = append(pkt, data[start:end]...)
+		if _, ok := tftpExchange(conn, peer, pkt, tftpACK, block); !ok {
+			return
+		}
+		if end-start < tftpBlockSize {
+			return
+		}
+	}
+}
+
+func tftpReceive(conn *UDPConn, peer Addr, path string) {
+	if strings.HasSuffix(path, string(filepath.Separator)) {
+		tftpError(conn, peer, 2, "access violation")
+		return
+	}
+	var data []byte
+	ack := []byte{0, tftpACK, 0, 0}
+	for block := uint16(1); ; block++ {
+		chunk, ok := tftpExchange(conn, peer, ack, tftpDATA, block)
+		if !ok {
+			return
+		}
+		data = append(data, chunk...)
+		ack = []byte{0, tftpACK, byte(block >> 8), byte(block)}
+		if len(chunk) < tftpBlockSize {
+			break
+		}
+	}
+	conn.WriteTo(ack, peer)
+	if err := os.WriteFile(path, data, 0644); err != nil {
+		log.Printf("TFTP: cannot write %q: %v", path, err)
+	}
+}
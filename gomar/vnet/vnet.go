@@ -0,0 +1,463 @@
+// Package vnet is an in-process virtual network switch.
+//
+// Emulated CocoIO (Wiznet W5100S) cards and Go stand-in services
+// (like the TFTP server in tftp.go) attach to a Switch as Hosts,
+// each with its own IPv4 address.  UDP datagrams and TCP streams
+// are delivered between Hosts without touching the host network stack.
+//
+// Every link has a latency and a loss probability.  Loss decisions come
+// from a seeded random source, so a run with the same seed and the same
+// traffic drops the same packets.
+package vnet
+
+import (
+	"errors"
+	"fmt"
+	"io"
+	"log"
+	"math/rand"
+	"net"
+	"sync"
+	"time"
+)
+
+type IP [4]byte
+
+func (ip IP) String() string {
+	return fmt.Sprintf("%d.%d.%d.%d", ip[0], ip[1], ip[2], ip[3])
+}
+
+func ParseIP(s string) IP {
+	var ip IP
+	n, err := fmt.Sscanf(s, "%d.%d.%d.%d", &ip[0], &ip[1], &ip[2], &ip[3])
+	if err != nil || n != 4 {
+		log.Panicf("vnet: bad IPv4 address %q: %v", s, err)
+	}
+	return ip
+}
+
+type Addr struct {
+	IP   IP
+	Port uint16
+}
+
+func (a Addr) String() string {
+	return fmt.Sprintf("%v:%d", a.IP, a.Port)
+}
+
+type Packet struct {
+	Src     Addr
+	Dst     Addr
+	Payload []byte
+}
+
+// Link describes the path from one Host to another.
+type Link struct {
+	Latency time.Duration
+	Loss    float64 // Probability 0.0 to 1.0 that a datagram is dropped.
+}
+
+var ErrClosed = errors.New("vnet: closed")
+var ErrNoRoute = errors.New("vnet: no host at that address")
+var ErrRefused = errors.New("vnet: connection refused")
+
+type Switch struct {
+	mu          sync.Mutex
+	hosts       map[IP]*Host
+	links       map[[2]IP]Link
+	DefaultLink Link
+	rng         *rand.Rand
+	Verbose     bool
+
+	Sent, Dropped, Delivered int64
+}
+
+func NewSwitch(seed int64) *Switch {
+	return &Switch{
+		hosts: make(map[IP]*Host),
+		links: make(map[[2]IP]Link),
+		rng:   rand.New(rand.NewSource(seed)),
+	}
+}
+
+// SetLink sets the link parameters for traffic from a to b.
+func (s *Switch) SetLink(a, b IP, link Link) {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	s.links[[2]IP{a, b}] = link
+}
+
+func (s *Switch) linkLocked(a, b IP) Link {
+	if link, ok := s.links[[2]IP{a, b}]; ok {
+		return link
+	}
+	return s.DefaultLink
+}
+
+// Attach returns the Host with address ip, creating it if needed.
+func (s *Switch) Attach(ip IP) *Host {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	if h, ok := s.hosts[ip]; ok {
+		return h
+	}
+	h := &Host{
+		sw:        s,
+		IP:        ip,
+		udp:       make(map[uint16]*UDPConn),
+		listeners: make(map[uint16]func(net.Conn)),
+	}
+	s.hosts[ip] = h
+	s.logf("attach %v", ip)
+	return h
+}
+
+func (s *Switch) logf(format string, args ...any) {
+	if s.Verbose {
+		log.Printf("vnet| "+format, args...)
+	}
+}
+
+func (s *Switch) send(p *Packet) error {
+	s.mu.Lock()
+	s.Sent++
+	dst, ok := s.hosts[p.Dst.IP]
+	if !ok {
+		s.Dropped++
+		s.mu.Unlock()
+		s.logf("no route %v -> %v", p.Src, p.Dst)
+		return nil // Like real UDP, sending into the void succeeds.
+	}
+	link := s.linkLocked(p.Src.IP, p.Dst.IP)
+	if link.Loss > 0 && s.rng.Float64() < link.Loss {
+		s.Dropped++
+		s.mu.Unlock()
+		s.logf("lost %v -> %v len %d", p.Src, p.Dst, len(p.Payload))
+		return nil
+	}
+	s.mu.Unlock()
+
+	if link.Latency > 0 {
+		time.AfterFunc(link.Latency, func() { dst.deliver(p) })
+	} else {
+		dst.deliver(p)
+	}
+	return nil
+}
+
+type Host struct {
+	sw        *Switch
+	IP        IP
+	mu        sync.Mutex
+	udp       map[uint16]*UDPConn
+	listeners map[uint16]func(net.Conn)
+	nextPort  uint16
+}
+
+func (h *Host) Switch() *Switch { return h.sw }
+
+func (h *Host) deliver(p *Packet) {
+	h.mu.Lock()
+	c, ok := h.udp[p.Dst.Port]
+	h.mu.Unlock()
+	h.sw.mu.Lock()
+	if ok {
+		h.sw.Delivered++
+	} else {
+		h.sw.Dropped++
+	}
+	h.sw.mu.Unlock()
+	if !ok {
+		h.sw.logf("port unreachable %v -> %v", p.Src, p.Dst)
+		return
+	}
+	select {
+	case c.queue <- p:
+		h.sw.logf("deliver %v -> %v len %d", p.Src, p.Dst, len(p.Payload))
+	case <-c.done:
+	default:
+		h.sw.mu.Lock()
+		h.sw.Dropped++
+		h.sw.mu.Unlock()
+		h.sw.logf("queue full %v -> %v", p.Src, p.Dst)
+	}
+}
+
+// EphemeralPort picks an unused local port, for services that reply
+// from a fresh port (as TFTP does).
+func (h *Host) EphemeralPort() uint16 {
+	h.mu.Lock()
+	defer h.mu.Unlock()
+	for {
+		h.nextPort++
+		port := 49152 + h.nextPort%16384
+		if _, busy := h.udp[port]; !busy {
+			return port
+		}
+	}
+}
+
+const kUDPQueueLen = 64
+
+type UDPConn struct {
+	host  *Host
+	Local Addr
+	queue chan *Packet
+	done  chan struct{}
+	once  sync.Once
+}
+
+func (h *Host) ListenUDP(port uint16) (*UDPConn, error) {
+	h.mu.Lock()
+	defer h.mu.Unlock()
+	if _, busy := h.udp[port]; busy {
+		return nil, fmt.Errorf("vnet: udp port %v:%d already in use", h.IP, port)
+	}
+	c := &UDPConn{
+		host:  h,
+		Local: Addr{h.IP, port},
+		queue: make(chan *Packet, kUDPQueueLen),
+		done:  make(chan struct{}),
+	}
+	h.udp[port] = c
+	return c, nil
+}
+
+func (c *UDPConn) WriteTo(payload []byte, dst Addr) (int, error) {
+	select {
+	case <-c.done:
+		return 0, ErrClosed
+	default:
+	}
+	buf := make([]byte, len(payload))
+	copy(buf, payload)
+	return len(buf), c.host.sw.send(&Packet{Src: c.Local, Dst: dst, Payload: buf})
+}
+
+// ReadFrom blocks until a datagram arrives or the conn is closed.
+func (c *UDPConn) ReadFrom(buf []byte) (int, Addr, error) {
+	select {
+	case p := <-c.queue:
+		return copy(buf, p.Payload), p.Src, nil
+	case <-c.done:
+		return 0, Addr{}, ErrClosed
+	}
+}
+
+// TryReadFrom returns ok=false at once if nothing is queued.
+func (c *UDPConn) TryReadFrom(buf []byte) (n int, src Addr, ok bool) {
+	select {
+	case p := <-c.queue:
+		return copy(buf, p.Payload), p.Src, true
+	default:
+		return 0, Addr{}, false
+	}
+}
+
+// ReadFromTimeout is ReadFrom giving up after d.
+func (c *UDPConn) ReadFromTimeout(buf []byte, d time.Duration) (int, Addr, error) {
+	timer := time.NewTimer(d)
+	defer timer.Stop()
+	select {
+	case p := <-c.queue:
+		return copy(buf, p.Payload), p.Src, nil
+	case <-c.done:
+		return 0, Addr{}, ErrClosed
+	case <-timer.C:
+		return 0, Addr{}, errors.New("vnet: timeout")
+	}
+}
+
+func (c *UDPConn) Close() error {
+	c.once.Do(func() {
+		close(c.done)
+		h := c.host
+		h.mu.Lock()
+		if h.udp[c.Local.Port] == c {
+			delete(h.udp, c.Local.Port)
+		}
+		h.mu.Unlock()
+	})
+	return nil
+}
+
+// ListenTCP registers accept to be called (in its own goroutine)
+// with the server end of each new connection to port.
+func (h *Host) ListenTCP(port uint16, accept func(net.Conn)) {
+	h.mu.Lock()
+	defer h.mu.Unlock()
+	h.listeners[port] = accept
+}
+
+// DialTCP connects to a listener on another Host.  The stream is reliable
+// (no loss), but what is written toward either end arrives after the
+// link latency.  Writes are buffered and return at once.
+func (h *Host) DialTCP(localPort uint16, remote Addr) (net.Conn, error) {
+	sw := h.sw
+	sw.mu.Lock()
+	dst, ok := sw.hosts[remote.IP]
+	var there, back Link
+	if ok {
+		there = sw.linkLocked(h.IP, remote.IP)
+		back = sw.linkLocked(remote.IP, h.IP)
+	}
+	sw.mu.Unlock()
+	if !ok {
+		return nil, ErrNoRoute
+	}
+	dst.mu.Lock()
+	accept, ok := dst.listeners[remote.Port]
+	dst.mu.Unlock()
+	if !ok {
+		return nil, ErrRefused
+	}
+
+	toDst, toSrc := newStream(there.Latency), newStream(back.Latency)
+	local := Addr{h.IP, localPort}
+	sw.logf("tcp connect %v -> %v", local, remote)
+	go accept(&streamConn{in: toDst, out: toSrc, local: remote, remote: local})
+	return &streamConn{in: toSrc, out: toDst, local: local, remote: remote}, nil
+}
+
+// A stream is one direction of a TCP link.  Write queues a copy of
+// the bytes, stamped with when they are due, and never blocks or
+// sleeps, so an emulated card can send from the CPU goroutine.  The
+// stream's own goroutine moves due bytes to ready, for Read.
+type stream struct {
+	mu       sync.Mutex
+	cond     *sync.Cond
+	delay    time.Duration
+	pending  []chunk
+	ready    []byte
+	closed   bool // No more writes; Read gets EOF after ready.
+	dead     bool // Reader closed; writes fail.
+	deadline time.Time
+}
+
+type chunk struct {
+	due time.Time
+	b   []byte
+}
+
+var errTimeout = timeoutError{}
+
+type timeoutError struct{}
+
+func (timeoutError) Error() string   { return "vnet: i/o timeout" }
+func (timeoutError) Timeout() bool   { return true }
+func (timeoutError) Temporary() bool { return true }
+
+func newStream(delay time.Duration) *stream {
+	s := &stream{delay: delay}
+	s.cond = sync.NewCond(&s.mu)
+	go s.deliver()
+	return s
+}
+
+func (s *stream) deliver() {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	for {
+		for len(s.pending) == 0 && !s.closed && !s.dead {
+			s.cond.Wait()
+		}
+		if s.dead || len(s.pending) == 0 {
+			s.cond.Broadcast() // closed, and everything delivered.
+			return
+		}
+		c := s.pending[0]
+		if wait := time.Until(c.due); wait > 0 {
+			s.mu.Unlock()
+			time.Sleep(wait)
+			s.mu.Lock()
+		}
+		s.pending = s.pending[1:]
+		s.ready = append(s.ready, c.b...)
+		s.cond.Broadcast()
+	}
+}
+
+func (s *stream) write(b []byte) (int, error) {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	if s.closed || s.dead {
+		return 0, ErrClosed
+	}
+	if len(b) > 0 {
+		s.pending = append(s.pending, chunk{time.Now().Add(s.delay), append([]byte(nil), b...)})
+		s.cond.Broadcast()
+	}
+	return len(b), nil
+}
+
+func (s *stream) read(b []byte) (int, error) {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	for len(s.ready) == 0 {
+		switch {
+		case s.dead:
+			return 0, ErrClosed
+		case s.closed && len(s.pending) == 0:
+			return 0, io.EOF
+		case !s.deadline.IsZero() && !time.Now().Before(s.deadline):
+			return 0, errTimeout
+		}
+		s.cond.Wait()
+	}
+	n := copy(b, s.ready)
+	s.ready = s.ready[n:]
+	return n, nil
+}
+
+func (s *stream) setDeadline(t time.Time) {
+	s.mu.Lock()
+	s.deadline = t
+	s.mu.Unlock()
+	if !t.IsZero() {
+		time.AfterFunc(time.Until(t), func() {
+			s.mu.Lock()
+			s.cond.Broadcast()
+			s.mu.Unlock()
+		})
+	}
+}
+
+// close ends writing (the reader gets what was sent, then EOF), or
+// with reader set, ends reading.
+func (s *stream) close(reader bool) {
+	s.mu.Lock()
+	if reader {
+		s.dead = true
+	} else {
+		s.closed = true
+	}
+	s.cond.Broadcast()
+	s.mu.Unlock()
+}
+
+// streamConn is one end of a TCP link, with vnet addresses.
+type streamConn struct {
+	in, out       *stream
+	local, remote Addr
+}
+
+func (c *streamConn) Read(b []byte) (int, error)  { return c.in.read(b) }
+func (c *streamConn) Write(b []byte) (int, error) { return c.out.write(b) }
+
+func (c *streamConn) Close() error {
+	c.out.close(false)
+	c.in.close(true)
+	return nil
+}
+
+func (c *streamConn) SetDeadline(t time.Time) error      { c.in.setDeadline(t); return nil }
+func (c *streamConn) SetReadDeadline(t time.Time) error  { c.in.setDeadline(t); return nil }
+func (c *streamConn) SetWriteDeadline(t time.Time) error { return nil } // Writes never block.
+
+func (c *streamConn) LocalAddr() net.Addr  { return vaddr(c.local) }
+func (c *streamConn) RemoteAddr() net.Addr { return vaddr(c.remote) }
+
+type vaddr Addr
+
+func (a vaddr) Network() string { return "vnet" }
+func (a vaddr) String() string  { return Addr(a).String() }